@@ -0,0 +1,733 @@
+/* fork, pipe, getrusage, clock_gettime and scandir are POSIX */
+#define _POSIX_C_SOURCE 200809L
+#include "../inc/assembler.h"
+#include "../../simulator/inc/sim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <dirent.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#define BENCH_MAX_SHAPES 16
+#define BENCH_NAME_LEN 32
+#define BENCH_PATH_LEN 512
+/* a corpus program that runs longer than this in the simulator fails its check. */
+#define BENCH_RUN_INSTRUCTIONS 1000000UL
+
+/**
+ * @brief the shape of a generated program.
+ * @param name
+ * @param lines source lines, macro bodies and calls included.
+ * @param label_percent share of the lines that define a label.
+ * @param forward_percent share of the label operands that refer to a label defined further down.
+ * @param externs amount of .extern symbols, a tenth of the instructions use one when there are any.
+ * @param entries amount of .entry declarations, at most the amount of labels.
+ * @param macros amount of macros, each is called every 50 lines in turn.
+ * @param fanout lines in the body of a macro, every call expands to that many lines.
+ * @param data_percent share of the lines that are .data or .string.
+ */
+struct bench_shape {
+    char            name[BENCH_NAME_LEN];
+    unsigned long   lines;
+    int             label_percent;
+    int             forward_percent;
+    int             externs;
+    int             entries;
+    int             macros;
+    int             fanout;
+    int             data_percent;
+};
+
+/* the shapes a run measures when none is given, huge is only run when asked for. */
+static const struct bench_shape bench_shapes[] = {
+    {"tiny",    1000UL,     20, 50, 4,  4,   2, 4, 20},
+    {"small",   10000UL,    20, 50, 8,  16,  4, 4, 20},
+    {"medium",  100000UL,   20, 50, 16, 64,  8, 4, 20},
+    {"labels",  100000UL,   60, 90, 16, 512, 0, 0, 10},
+    {"macros",  100000UL,   10, 50, 4,  8,   64, 16, 10},
+    {"data",    100000UL,   20, 50, 4,  8,   2, 4, 80},
+    {"externs", 100000UL,   20, 50, 256, 8,  2, 4, 20},
+    {"large",   1000000UL,  20, 50, 32, 256, 16, 4, 20},
+    {"huge",    10000000UL, 20, 50, 64, 1024, 32, 4, 20}
+};
+#define BENCH_DEFAULT_SHAPES 8
+
+/* the outputs compared against the golden files, a missing output must be missing from the golden files too. */
+static const char *const bench_outputs[] = {".am",".ob",".ent",".ext"};
+
+/* what a program prints when the simulator runs its .ob file, compared only when the corpus has a golden one. */
+#define BENCH_RUN_OUTPUT ".run"
+
+/**
+ * @brief the measurement of a shape.
+ * @param seconds the fastest of the repeats.
+ * @param bytes size of the .as file.
+ * @param max_rss_kb peak resident set size of the process that assembled it.
+ */
+struct bench_result {
+    double          seconds;
+    unsigned long   bytes;
+    long            max_rss_kb;
+    unsigned long   words_saved;
+};
+
+/* The state of the generator, deterministic for a given seed. */
+static unsigned long bench_random_state = 1;
+
+/**
+ * @brief returns the next pseudo random number, xorshift.
+ */
+static unsigned long bench_random(void) {
+    bench_random_state ^= (bench_random_state << 13) & 0xffffffffUL;
+    bench_random_state ^= bench_random_state >> 17;
+    bench_random_state ^= (bench_random_state << 5) & 0xffffffffUL;
+    return bench_random_state & 0xffffffffUL;
+}
+
+/**
+ * @brief returns a random number below n, n must not be 0.
+ */
+static unsigned long bench_below(unsigned long n) {
+    return bench_random() % n;
+}
+
+/**
+ * @brief returns the seconds of the monotonic clock.
+ */
+static double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief returns the amount of labels defined before a line, line n defines label_percent * n / 100 of them.
+ */
+static unsigned long bench_labels_before(const struct bench_shape *shape,unsigned long line) {
+    return line * shape->label_percent / 100;
+}
+
+/**
+ * @brief prints a label operand, a label further down or one already defined.
+ *
+ * @param out
+ * @param shape
+ * @param line the current line
+ * @param label_count
+ */
+static void bench_print_label(FILE *out,const struct bench_shape *shape,unsigned long line,unsigned long label_count) {
+    unsigned long defined = bench_labels_before(shape,line + 1);
+    if(defined == 0)
+        defined = 1;
+    if(defined < label_count && (int)bench_below(100) < shape->forward_percent)
+        fprintf(out,"L%lu",defined + bench_below(label_count - defined));
+    else
+        fprintf(out,"L%lu",bench_below(defined));
+}
+
+/**
+ * @brief generates the .as file of a shape.
+ *
+ * @param base_name the file is base_name.as
+ * @param shape
+ * @param seed
+ * @return long the size of the file, -1 if it cannot be written.
+ */
+static long bench_generate(const char *base_name,const struct bench_shape *shape,unsigned long seed) {
+    char file_name[BENCH_PATH_LEN];
+    FILE *out;
+    unsigned long line, body, label_count, entries, macro_calls = 0;
+    unsigned long header = shape->externs + (unsigned long)shape->macros * (shape->fanout + 2) + shape->entries;
+    long size;
+    int i, k, kind, labeled;
+    sprintf(file_name,"%.*s.as",BENCH_PATH_LEN - 4,base_name);
+    out = fopen(file_name,"w");
+    if(!out)
+        return -1;
+    bench_random_state = seed ? seed : 1;
+    /* the declarations and macro definitions come first, the body makes up the rest of the lines */
+    body = shape->lines > header ? shape->lines - header : 1;
+    label_count = bench_labels_before(shape,body);
+    entries = (unsigned long)shape->entries < label_count ? (unsigned long)shape->entries : label_count;
+    for(i=0;i<shape->externs;i++)
+        fprintf(out,".extern X%d\n",i);
+    for(i=0;(unsigned long)i<entries;i++)
+        fprintf(out,".entry L%lu\n",label_count - 1 - (unsigned long)i * label_count / entries);
+    for(i=0;i<shape->macros;i++) {
+        fprintf(out,"mcr M%d\n",i);
+        for(k=0;k<shape->fanout;k++)
+            fprintf(out," %s r%d, r%d\n",k % 2 ? "add" : "sub",(i + k) % 8,k % 8);
+        fprintf(out,"endmcr\n");
+    }
+    for(line=0;line<body;line++) {
+        /* a line that defines a label is never a macro call */
+        labeled = bench_labels_before(shape,line + 1) > bench_labels_before(shape,line);
+        if(labeled) {
+            fprintf(out,"L%lu: ",bench_labels_before(shape,line));
+        }else if(shape->macros > 0 && line % 50 == 25) {
+            fprintf(out,"M%lu\n",macro_calls++ % shape->macros);
+            continue;
+        }
+        if((int)bench_below(100) < shape->data_percent) {
+            /* data gets a label of its own, the assembler warns about data nothing points to */
+            if(!labeled)
+                fprintf(out,"D%lu: ",line);
+            if(bench_below(2))
+                fprintf(out,".data %lu, -%lu, %lu\n",bench_below(500),bench_below(500),bench_below(500));
+            else
+                fprintf(out,".string \"s%lu\"\n",line);
+            continue;
+        }
+        kind = (int)bench_below(10);
+        if(kind == 0 && shape->externs > 0) {
+            fprintf(out,"%s X%lu\n",bench_below(2) ? "prn" : "jsr",bench_below(shape->externs));
+        }else if(kind <= 3 && label_count > 0) {
+            fprintf(out,"mov r%lu, ",bench_below(8));
+            bench_print_label(out,shape,line,label_count);
+            fputc('\n',out);
+        }else if(kind <= 5 && label_count > 0) {
+            fprintf(out,"jmp ");
+            bench_print_label(out,shape,line,label_count);
+            fprintf(out,"(#%lu,r%lu)\n",bench_below(100),bench_below(8));
+        }else if(kind <= 7) {
+            fprintf(out,"cmp #%lu, r%lu\n",bench_below(500),bench_below(8));
+        }else if(kind == 8) {
+            fprintf(out,"inc r%lu\n",bench_below(8));
+        }else {
+            fprintf(out,"rts\n");
+        }
+    }
+    size = ftell(out);
+    if(fclose(out))
+        return -1;
+    return size;
+}
+
+/**
+ * @brief assembles a file repeats times in a child process, so its peak memory is its own.
+ *
+ * @param base_name
+ * @param options
+ * @param repeats
+ * @param result receives the fastest time and the peak memory.
+ * @return int 0 on success, -1 otherwise.
+ */
+static int bench_measure(char *base_name,const struct assembler_options *options,int repeats,struct bench_result *result) {
+    struct assembler_options child_options;
+    struct rusage usage;
+    double start, seconds;
+    pid_t pid;
+    int fds[2], status, i;
+    if(pipe(fds))
+        return -1;
+    fflush(NULL);
+    pid = fork();
+    if(pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return -1;
+    }
+    if(pid == 0) {
+        close(fds[0]);
+        child_options = *options;
+        child_options.words_saved = &result->words_saved;
+        result->seconds = 0;
+        for(i=0;i<repeats;i++) {
+            /* the stats of the last repeat are printed, once the files are in the page cache */
+            child_options.stats = i == repeats - 1 ? options->stats : NULL;
+            start = bench_now();
+            assemble_with_options(&base_name,1,&child_options);
+            seconds = bench_now() - start;
+            if(i == 0 || seconds < result->seconds)
+                result->seconds = seconds;
+        }
+        getrusage(RUSAGE_SELF,&usage);
+        result->max_rss_kb = usage.ru_maxrss;
+        i = write(fds[1],result,sizeof(struct bench_result)) != sizeof(struct bench_result);
+        fflush(NULL);
+        _exit(i);
+    }
+    close(fds[1]);
+    i = read(fds[0],result,sizeof(struct bench_result)) == sizeof(struct bench_result);
+    close(fds[0]);
+    return waitpid(pid,&status,0) == pid && i && WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : -1;
+}
+
+/**
+ * @brief looks the time of a shape up in a baseline file.
+ *
+ * @param baseline lines of name and seconds, as -w writes them.
+ * @param name
+ * @return double the seconds, 0 if the shape is not in it.
+ */
+static double bench_baseline(FILE *baseline,const char *name) {
+    char line_name[BENCH_NAME_LEN];
+    double seconds;
+    rewind(baseline);
+    while(fscanf(baseline,"%31s %lf",line_name,&seconds) == 2) {
+        if(strcmp(line_name,name) == 0)
+            return seconds;
+    }
+    return 0;
+}
+
+/**
+ * @brief prints the measurement of a program, against its baseline if there is one.
+ *
+ * @param name
+ * @param lines lines of the program
+ * @param result
+ * @param baseline lines of name and seconds, NULL for none.
+ * @param save receives the name and seconds, NULL for none.
+ * @param threshold percent of throughput the program may lose against its baseline, negative for no limit.
+ * @return int 1 if the program lost more throughput than threshold, 0 otherwise.
+ */
+static int bench_report(const char *name,unsigned long lines,const struct bench_result *result,FILE *baseline,FILE *save,double threshold) {
+    double before = baseline ? bench_baseline(baseline,name) : 0, loss;
+    int slower = 0;
+    printf("%-8s lines=%-9lu %9.4f s %12.0f lines/s %8.2f MB/s rss=%ld KB",name,lines,result->seconds,
+           lines / result->seconds,result->bytes / result->seconds / (1024.0 * 1024.0),result->max_rss_kb);
+    if(result->words_saved)
+        printf(" saved=%lu words",result->words_saved);
+    if(before > 0) {
+        printf(" baseline %9.4f s %+7.1f%%",before,(result->seconds - before) * 100.0 / before);
+        /* throughput is lines per second, so it drops by the share of the time the run grew by */
+        loss = (1 - before / result->seconds) * 100.0;
+        if(threshold >= 0 && loss > threshold) {
+            printf(" throughput -%.1f%% over %.1f%%",loss,threshold);
+            slower = 1;
+        }
+    }
+    printf("\n");
+    if(save)
+        fprintf(save,"%s %.6f\n",name,result->seconds);
+    return slower;
+}
+
+/**
+ * @brief copies a file, a missing source removes the destination.
+ *
+ * @param from
+ * @param to
+ * @param lines if not NULL, receives the amount of lines copied.
+ * @return long the size of the file, 0 if it is missing, -1 if it cannot be copied.
+ */
+static long bench_copy(const char *from,const char *to,unsigned long *lines) {
+    char buffer[BUFSIZ];
+    FILE *in, *out;
+    size_t n, i;
+    long size = 0;
+    if(lines)
+        *lines = 0;
+    in = fopen(from,"rb");
+    if(!in)
+        return remove(to) == 0 || errno == ENOENT ? 0 : -1;
+    out = fopen(to,"wb");
+    if(!out) {
+        fclose(in);
+        return -1;
+    }
+    while((n = fread(buffer,1,sizeof(buffer),in)) > 0) {
+        if(fwrite(buffer,1,n,out) != n)
+            size = -1;
+        for(i=0;lines && i<n;i++)
+            *lines += buffer[i] == '\n';
+        if(size >= 0)
+            size += n;
+    }
+    if(ferror(in))
+        size = -1;
+    fclose(in);
+    if(fclose(out))
+        size = -1;
+    return size;
+}
+
+/**
+ * @brief compares two files byte by byte.
+ *
+ * @param name
+ * @param golden
+ * @return int 0 if both have the same bytes or both are missing, 1 otherwise.
+ */
+static int bench_compare(const char *name,const char *golden) {
+    FILE *a = fopen(name,"rb"), *b = fopen(golden,"rb");
+    int ca, cb, differ;
+    if(!a || !b) {
+        differ = a != b;
+    }else {
+        do {
+            ca = getc(a);
+            cb = getc(b);
+        } while(ca == cb && ca != EOF);
+        differ = ca != cb;
+    }
+    if(a)
+        fclose(a);
+    if(b)
+        fclose(b);
+    return differ;
+}
+
+/**
+ * @brief runs an assembled program in the simulator, what it prints goes to a file.
+ *
+ * @param base_name the program, base_name.ob and base_name.ext are loaded.
+ * @param run_name receives what the program prints.
+ * @return int 0 if the program ran until stop, 1 otherwise.
+ */
+static int bench_simulate(const char *base_name,const char *run_name) {
+    struct sim_options sim_options = {0};
+    struct sim_result result;
+    simulator sim;
+    int failed = 1;
+    sim_options.out = fopen(run_name,"w");
+    sim_options.max_instructions = BENCH_RUN_INSTRUCTIONS;
+    if(!sim_options.out)
+        return 1;
+    sim = sim_create(&sim_options);
+    if(sim && sim_load_ob(sim,base_name) == 0) {
+        sim_run(sim,&result);
+        failed = result.status != sim_status_stopped;
+        if(failed)
+            fprintf(stderr,"%s: the simulator did not reach stop, at %u%s%s\n",base_name,result.pc,
+                    result.fault ? ": " : "",result.fault ? result.fault : "");
+    }
+    if(sim)
+        sim_destroy(sim);
+    if(fclose(sim_options.out))
+        failed = 1;
+    return failed;
+}
+
+/**
+ * @brief selects the .as files of a corpus directory.
+ */
+static int bench_is_source(const struct dirent *entry) {
+    size_t len = strlen(entry->d_name);
+    return len > 3 && strcmp(entry->d_name + len - 3,".as") == 0;
+}
+
+/**
+ * @brief selects the files the programs of a corpus directory include, they are named .inc so they are not programs themselves,
+ * and the directories that may hold more of them.
+ */
+static int bench_is_include(const struct dirent *entry) {
+    size_t len = strlen(entry->d_name);
+    return entry->d_name[0] != '.' && (strchr(entry->d_name,'.') == NULL || (len > 4 && strcmp(entry->d_name + len - 4,".inc") == 0));
+}
+
+/**
+ * @brief copies the included files of a corpus to dir, next to the programs that include them.
+ * a directory of the corpus is copied with the included files in it, so programs can include a path through it and back with ../
+ *
+ * @param corpus
+ * @param dir
+ * @return int 0 on success, 1 otherwise.
+ */
+static int bench_copy_includes(const char *corpus,const char *dir) {
+    char from[BENCH_PATH_LEN], to[BENCH_PATH_LEN];
+    struct dirent **entries;
+    struct stat st;
+    int count, i, failed = 0;
+    count = scandir(corpus,&entries,bench_is_include,alphasort);
+    if(count < 0) {
+        fprintf(stderr,"cannot read %s\n",corpus);
+        return 1;
+    }
+    for(i=0;i<count;i++) {
+        sprintf(from,"%.*s/%.*s",BENCH_PATH_LEN / 2 - 8,corpus,BENCH_PATH_LEN / 2 - 8,entries[i]->d_name);
+        sprintf(to,"%.*s/%.*s",BENCH_PATH_LEN / 2 - 8,dir,BENCH_PATH_LEN / 2 - 8,entries[i]->d_name);
+        if(failed || stat(from,&st) != 0) {
+            /* an entry that went away is not copied */
+        }else if(S_ISDIR(st.st_mode)) {
+            if(mkdir(to,0777) != 0 && errno != EEXIST) {
+                fprintf(stderr,"%s: cannot create\n",to);
+                failed = 1;
+            }else {
+                failed = bench_copy_includes(from,to);
+            }
+        }else if(strchr(entries[i]->d_name,'.') && bench_copy(from,to,NULL) < 0) {
+            fprintf(stderr,"%s: cannot copy to %s\n",from,to);
+            failed = 1;
+        }
+        free(entries[i]);
+    }
+    free(entries);
+    return failed;
+}
+
+/**
+ * @brief reads the options of a program of a corpus from the .opt file next to it, -O optimizes and -D deduplicates data.
+ * -O and -D of the run are not applied, they change the outputs, and the golden files of a program hold the outputs of its own options.
+ *
+ * @param golden the base name of the program in the corpus.
+ * @param options receives the options, on top of those of the run.
+ * @return int 0 on success, 1 if the .opt file has an unknown option.
+ */
+static int bench_case_options(const char *golden,struct assembler_options *options) {
+    char file_name[BENCH_PATH_LEN], option[BENCH_NAME_LEN];
+    FILE *in;
+    int failed = 0;
+    options->optimize   = 0;
+    options->dedup_data = 0;
+    sprintf(file_name,"%.*s.opt",BENCH_PATH_LEN - 5,golden);
+    in = fopen(file_name,"r");
+    if(!in)
+        return 0;
+    while(!failed && fscanf(in,"%31s",option) == 1) {
+        if(strcmp(option,"-O") == 0)
+            options->optimize = 1;
+        else if(strcmp(option,"-D") == 0)
+            options->dedup_data = 1;
+        else {
+            fprintf(stderr,"%s: unknown option %s\n",file_name,option);
+            failed = 1;
+        }
+    }
+    fclose(in);
+    return failed;
+}
+
+/**
+ * @brief assembles every .as file of a corpus in dir, compares the outputs with the golden files next to it, then times it.
+ *
+ * @param corpus directory of .as files, the .inc files they include, their .opt files and their golden outputs.
+ * @param dir where the files are assembled.
+ * @param options
+ * @param repeats
+ * @param write non zero writes the golden files of the programs that have none, instead of comparing against them.
+ * the golden files of a program are never rewritten, they hold the outputs of a build trusted before the one under test.
+ * @param baseline lines of name and seconds, NULL for none.
+ * @param save receives the name and seconds of every program, NULL for none.
+ * @param threshold percent of throughput a program may lose against its baseline, negative for no limit.
+ * @return int 0 if every output matched and no program got slower than threshold, 1 otherwise.
+ */
+static int bench_regress(const char *corpus,const char *dir,const struct assembler_options *options,int repeats,int write,
+                         FILE *baseline,FILE *save,double threshold) {
+    char golden[BENCH_PATH_LEN], output[BENCH_PATH_LEN], base_name[BENCH_PATH_LEN], name[BENCH_NAME_LEN];
+    char *base = base_name;
+    struct dirent **entries;
+    struct bench_result result;
+    struct assembler_options case_options = *options, timed_options;
+    FILE *quiet;
+    unsigned long lines;
+    size_t k;
+    int count, i, len, failed = 0, differ, has_golden;
+    if(bench_copy_includes(corpus,dir))
+        return 1;
+    count = scandir(corpus,&entries,bench_is_source,alphasort);
+    if(count < 0) {
+        fprintf(stderr,"cannot read %s\n",corpus);
+        return 1;
+    }
+    quiet = fopen("/dev/null","w");
+    if(count == 0)
+        fprintf(stderr,"%s: no .as files\n",corpus);
+    for(i=0;i<count;i++) {
+        len = (int)strlen(entries[i]->d_name) - 3;
+        sprintf(name,"%.*s",len < BENCH_NAME_LEN - 1 ? len : BENCH_NAME_LEN - 1,entries[i]->d_name);
+        sprintf(base_name,"%.*s/%.*s",BENCH_PATH_LEN / 2 - 8,dir,len < BENCH_PATH_LEN / 2 - 8 ? len : BENCH_PATH_LEN / 2 - 8,entries[i]->d_name);
+        sprintf(golden,"%.*s/%.*s",BENCH_PATH_LEN / 2 - 8,corpus,len < BENCH_PATH_LEN / 2 - 8 ? len : BENCH_PATH_LEN / 2 - 8,entries[i]->d_name);
+        if(bench_case_options(golden,&case_options)) {
+            failed = 1;
+            continue;
+        }
+        /* a program with golden files of its own is only compared, -G adds the golden files of a new program */
+        has_golden = 0;
+        for(k=0;k<sizeof(bench_outputs)/sizeof(bench_outputs[0]);k++) {
+            sprintf(output,"%.*s%s",BENCH_PATH_LEN - 8,golden,bench_outputs[k]);
+            has_golden |= access(output,F_OK) == 0;
+        }
+        if(write && has_golden)
+            continue;
+        sprintf(golden,"%.*s/%.*s",BENCH_PATH_LEN / 2 - 8,corpus,BENCH_PATH_LEN / 2 - 8,entries[i]->d_name);
+        /* a stale output of a previous run must not pass for the output of this one */
+        for(k=0;k<sizeof(bench_outputs)/sizeof(bench_outputs[0]);k++) {
+            sprintf(output,"%s%s",base_name,bench_outputs[k]);
+            remove(output);
+        }
+        sprintf(output,"%.*s.as",BENCH_PATH_LEN - 4,base_name);
+        result.bytes = bench_copy(golden,output,&lines);
+        if(result.bytes == (unsigned long)-1) {
+            fprintf(stderr,"%s: cannot copy to %s\n",golden,output);
+            failed = 1;
+            continue;
+        }
+        assemble_with_options(&base,1,&case_options);
+        differ = 0;
+        for(k=0;k<sizeof(bench_outputs)/sizeof(bench_outputs[0]);k++) {
+            sprintf(output,"%s%s",base_name,bench_outputs[k]);
+            sprintf(golden,"%.*s/%.*s%s",BENCH_PATH_LEN / 2 - 8,corpus,len < BENCH_PATH_LEN / 2 - 8 ? len : BENCH_PATH_LEN / 2 - 8,
+                    entries[i]->d_name,bench_outputs[k]);
+            if(write) {
+                if(bench_copy(output,golden,NULL) < 0) {
+                    fprintf(stderr,"%s: cannot write\n",golden);
+                    failed = 1;
+                }
+            }else if(bench_compare(output,golden)) {
+                fprintf(stderr,"%s: %s differs from %s\n",name,output,golden);
+                differ = 1;
+            }
+        }
+        /* a program with a golden .run file is also run, what it prints shows the outputs mean what the source says */
+        sprintf(golden,"%.*s/%.*s%s",BENCH_PATH_LEN / 2 - 8,corpus,len < BENCH_PATH_LEN / 2 - 8 ? len : BENCH_PATH_LEN / 2 - 8,
+                entries[i]->d_name,BENCH_RUN_OUTPUT);
+        if(!write && !differ && access(golden,F_OK) == 0) {
+            sprintf(output,"%.*s%s",BENCH_PATH_LEN - 8,base_name,BENCH_RUN_OUTPUT);
+            if(bench_simulate(base_name,output) || bench_compare(output,golden)) {
+                fprintf(stderr,"%s: %s differs from %s\n",name,output,golden);
+                differ = 1;
+            }
+        }
+        failed |= differ;
+        /* the timing of a program with wrong outputs means nothing */
+        if(!differ) {
+            /* the diagnostics of a program were printed by the run that was compared, the timed runs would only repeat them */
+            timed_options = case_options;
+            if(quiet)
+                timed_options.diagnostics = quiet;
+            if(bench_measure(base_name,&timed_options,repeats,&result)) {
+                fprintf(stderr,"%s: failed\n",name);
+                failed = 1;
+            }else {
+                failed |= bench_report(name,lines,&result,baseline,save,threshold);
+            }
+        }
+    }
+    for(i=0;i<count;i++)
+        free(entries[i]);
+    free(entries);
+    if(quiet)
+        fclose(quiet);
+    return failed;
+}
+
+/**
+ * @brief prints the usage.
+ */
+static void bench_usage(const char *program) {
+    fprintf(stderr,"usage: %s [-s shape]... [-l lines] [-r repeats] [-t threads] [-p] [-O] [-D] [-d dir] [-b baseline] [-w baseline] [-T percent] [-S seed]\n"
+                   "       %s -g base_name [-s shape] [-l lines] [-S seed]\n"
+                   "       %s -C corpus [-r repeats] [-t threads] [-p] [-d dir] [-b baseline] [-w baseline] [-T percent]\n"
+                   "       %s -G corpus [-t threads] [-p] [-d dir]\n",program,program,program,program);
+    fprintf(stderr,"-C checks the programs of a corpus against their golden files, -O and -D come from the .opt file of a program,\n"
+                   "a program with a golden .run file is run in the simulator and what it prints is checked too.\n"
+                   "-G writes the golden files of the programs that have none, existing ones are never rewritten.\n"
+                   "shapes:");
+    {
+        size_t i;
+        for(i=0;i<sizeof(bench_shapes)/sizeof(bench_shapes[0]);i++)
+            fprintf(stderr," %s",bench_shapes[i].name);
+    }
+    fprintf(stderr,"\n");
+}
+
+int main(int argc,char **argv) {
+    struct bench_shape shapes[BENCH_MAX_SHAPES];
+    struct assembler_options options = {0};
+    struct bench_result result;
+    char base_name[BENCH_PATH_LEN];
+    const char *dir = "/tmp", *generate = NULL, *baseline_name = NULL, *save_name = NULL, *corpus = NULL;
+    FILE *baseline = NULL, *save = NULL;
+    unsigned long lines = 0, seed = 1;
+    double threshold = -1;
+    int shape_count = 0, repeats = 3, i, failed = 0, write_golden = 0;
+    size_t k;
+    options.parse_threads = 1;
+    for(i=1;i<argc;i++) {
+        if(strcmp(argv[i],"-p") == 0) {
+            options.pipeline = 1;
+        }else if(strcmp(argv[i],"-O") == 0) {
+            options.optimize = 1;
+        }else if(strcmp(argv[i],"-D") == 0) {
+            options.dedup_data = 1;
+        }else if(i + 1 < argc && strcmp(argv[i],"-s") == 0 && shape_count < BENCH_MAX_SHAPES) {
+            for(k=0;k<sizeof(bench_shapes)/sizeof(bench_shapes[0]) && strcmp(bench_shapes[k].name,argv[i + 1]);k++)
+                ;
+            if(k == sizeof(bench_shapes)/sizeof(bench_shapes[0])) {
+                bench_usage(argv[0]);
+                return 1;
+            }
+            shapes[shape_count++] = bench_shapes[k];
+            i++;
+        }else if(i + 1 < argc && strcmp(argv[i],"-l") == 0) {
+            lines = strtoul(argv[++i],NULL,10);
+        }else if(i + 1 < argc && strcmp(argv[i],"-r") == 0) {
+            repeats = atoi(argv[++i]);
+        }else if(i + 1 < argc && strcmp(argv[i],"-t") == 0) {
+            options.parse_threads = atoi(argv[++i]);
+        }else if(i + 1 < argc && strcmp(argv[i],"-d") == 0) {
+            dir = argv[++i];
+        }else if(i + 1 < argc && strcmp(argv[i],"-b") == 0) {
+            baseline_name = argv[++i];
+        }else if(i + 1 < argc && strcmp(argv[i],"-w") == 0) {
+            save_name = argv[++i];
+        }else if(i + 1 < argc && strcmp(argv[i],"-g") == 0) {
+            generate = argv[++i];
+        }else if(i + 1 < argc && strcmp(argv[i],"-S") == 0) {
+            seed = strtoul(argv[++i],NULL,10);
+        }else if(i + 1 < argc && strcmp(argv[i],"-T") == 0) {
+            threshold = atof(argv[++i]);
+        }else if(i + 1 < argc && (strcmp(argv[i],"-C") == 0 || strcmp(argv[i],"-G") == 0)) {
+            write_golden = argv[i][1] == 'G';
+            corpus = argv[++i];
+        }else {
+            bench_usage(argv[0]);
+            return 1;
+        }
+    }
+    if(shape_count == 0) {
+        for(shape_count=0;shape_count<BENCH_DEFAULT_SHAPES;shape_count++)
+            shapes[shape_count] = bench_shapes[shape_count];
+    }
+    for(i=0;lines && i<shape_count;i++)
+        shapes[i].lines = lines;
+    if(generate)
+        return bench_generate(generate,&shapes[0],seed) < 0;
+    if(repeats < 1)
+        repeats = 1;
+#ifdef ASM_STATS
+    options.stats = stdout;
+#endif
+    if(baseline_name && !(baseline = fopen(baseline_name,"r"))) {
+        fprintf(stderr,"cannot read %s\n",baseline_name);
+        return 1;
+    }
+    if(save_name && !(save = fopen(save_name,"w"))) {
+        fprintf(stderr,"cannot write %s\n",save_name);
+        return 1;
+    }
+    /* the assembler prints its errors, the generated programs have none */
+    options.diagnostics = stderr;
+    if(corpus) {
+        /* the corpus is copied to dir to be assembled, so the golden files are never overwritten by a run */
+        if(strcmp(corpus,dir) == 0) {
+            fprintf(stderr,"the corpus and -d must be different directories\n");
+            failed = 1;
+        }
+        if(!failed)
+            failed = bench_regress(corpus,dir,&options,repeats,write_golden,baseline,save,threshold);
+        shape_count = 0;
+    }
+    for(i=0;i<shape_count;i++) {
+        sprintf(base_name,"%.*s/asm-bench-%.*s",BENCH_PATH_LEN - BENCH_NAME_LEN - 16,dir,BENCH_NAME_LEN - 1,shapes[i].name);
+        result.bytes = bench_generate(base_name,&shapes[i],seed);
+        if(result.bytes == (unsigned long)-1 || bench_measure(base_name,&options,repeats,&result)) {
+            fprintf(stderr,"%s: failed\n",shapes[i].name);
+            failed = 1;
+            continue;
+        }
+        failed |= bench_report(shapes[i].name,shapes[i].lines,&result,baseline,save,threshold);
+    }
+    if(baseline)
+        fclose(baseline);
+    if(save && fclose(save))
+        failed = 1;
+    return failed;
+}
@@ -3,26 +3,50 @@
 #include "../../lang-engine/inc/lang-engine.h"
 #include "../inc/translation_unit.h"
 #include "../../out/inc/out.h"
+#include "../../utilities/spsc-ring/inc/spsc-ring.h"
+#include "../../utilities/source-buffer/inc/source-buffer.h"
+#include "../../build-cache/inc/build-cache.h"
+#include "../../utilities/stats/inc/stats.h"
+#include "../../utilities/trace/inc/trace.h"
+#include "../../utilities/mem/inc/mem.h"
+#include "../../utilities/terminal/inc/terminal.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdarg.h>
+#include <pthread.h>
 
 
-#define TERMINAL_RED     "\x1b[31m"
-#define TERMINAL_YELLOW  "\x1b[33m"
-#define TERMINAL_RESET   "\x1b[0m"
 
 #define PROG_BASE_ADDR 100
+/* part of every build cache key, bump it whenever the same source may assemble to different outputs */
+#define ASSEMBLER_VERSION "1"
+/* chunks smaller than this are parsed together, a thread costs more than parsing them */
+#define FIRST_PASS_MIN_CHUNK_SIZE (64 * 1024)
+/* event texts that are not spans of the source are copied into blocks of this size */
+#define FIRST_PASS_TEXT_BLOCK_SIZE (4 * 1024)
+/* pre-asm hands the parser .am text in blocks of this size */
+#define PIPELINE_BLOCK_SIZE (16 * 1024)
+/* the parser hands the encoder this many parsed lines at once */
+#define PIPELINE_BATCH_LINES 64
+/* blocks or batches in flight between two stages */
+#define PIPELINE_RING_SIZE 16
+/* the first word of an incremental state file, the version of the assembler that wrote it follows */
+#define INCREMENTAL_MAGIC "maman14-incremental"
+/* the incremental state of a file is kept next to its .ob file, with this extension */
+#define INCREMENTAL_STATE_EXT ".ob.state"
+/* runs call as a phase of t_unit, timed into its stats and traced as a span named name */
+#define ASSEMBLER_PHASE(t_unit,phase,name,call) do { TRACE_BEGIN(name,NULL); STATS_PHASE(&(t_unit)->stats,phase,call); TRACE_END(); } while(0)
 
 /* String representations of symbol types. */
-static const char *sym_type_str[6] = {
+static const char *sym_type_str[7] = {
     "data symbol",
     "code symbol",
     "external symbol",
     "entry symbol",
     "code entry symbol",
-    "data entry symbol"
+    "data entry symbol",
+    "undefined symbol"
 };
 
 /**
@@ -31,17 +55,17 @@ static const char *sym_type_str[6] = {
  * @return Pointer to the newly created symbol table entry.
  */
 static void *symbol_table_ctor(const void * copy) {
-    return memcpy(malloc(sizeof(struct symbol)),copy,sizeof(struct symbol));
+    return memcpy(mem_malloc(mem_tag_symbols,sizeof(struct symbol)),copy,sizeof(struct symbol));
 }
 /**
  * @brief Destroys a symbol table entry.
  * @param copy Pointer to the symbol table entry to be destroyed.
  */
 static void symbol_table_dtor(void * copy) {
-    free(copy);
+    mem_free(copy);
 }
 /**
- * @brief Compares two symbol table entries based on their symbol names.
+ * @brief Compares two symbol table entries based on the ids of their interned names.
  * @param a Pointer to the first symbol table entry.
  * @param b Pointer to the second symbol table entry.
  * @return An integer representing the comparison result.
@@ -49,7 +73,23 @@ static void symbol_table_dtor(void * copy) {
 static int symbol_table_compar(const void *a , const void * b) {
     const struct symbol *ap = a;
     const struct symbol *bp = b;
-    return strcmp(ap->symbol_name,bp->symbol_name);
+    return (ap->symbol_name->id > bp->symbol_name->id) - (ap->symbol_name->id < bp->symbol_name->id);
+}
+/**
+ * @brief Constructs a new symbol id table entry by copying an existing symbol pointer.
+ * @param copy Pointer to the existing symbol pointer.
+ * @return Pointer to the newly created symbol id table entry.
+ */
+static void *symbol_ptr_ctor(const void * copy) {
+    return memcpy(mem_malloc(mem_tag_symbols,sizeof(struct symbol *)),copy,sizeof(struct symbol *));
+}
+/**
+ * @brief Constructs a new symbol reference entry by copying an existing symbol id.
+ * @param copy Pointer to the existing symbol id.
+ * @return Pointer to the newly created symbol reference entry.
+ */
+static void *symbol_ref_ctor(const void * copy) {
+    return memcpy(mem_malloc(mem_tag_symbols,sizeof(unsigned int)),copy,sizeof(unsigned int));
 }
 /**
  * @brief Constructs a new binary machine code entry by copying an existing one.
@@ -57,14 +97,14 @@ static int symbol_table_compar(const void *a , const void * b) {
  * @return Pointer to the newly created binary machine code entry.
  */
 static void * bmc_ctor(const void * copy) {
-    return memcpy(malloc(sizeof(unsigned short)),copy,sizeof(unsigned short));
+    return memcpy(mem_malloc(mem_tag_code,sizeof(unsigned short)),copy,sizeof(unsigned short));
 }
 /**
  * @brief Destroys an extern call entry.
  * @param copy Pointer to the extern call entry to be destroyed.
  */
 static void bmc_dtor(void * copy) {
-    free(copy);
+    mem_free(copy);
 }
 /**
  * @brief Constructs a new extern call entry by copying an existing one.
@@ -72,8 +112,8 @@ static void bmc_dtor(void * copy) {
  * @return Pointer to the newly created extern call entry.
  */
 static void * extern_call_ctor(const void * copy) {
-    struct extern_call * e_call =  malloc(sizeof(struct extern_call));
-    strcpy(e_call->symbol_name,((struct extern_call *)copy)->symbol_name);
+    struct extern_call * e_call =  mem_malloc(mem_tag_symbols,sizeof(struct extern_call));
+    e_call->symbol_name = ((struct extern_call *)copy)->symbol_name;
     e_call->addresses = ((struct extern_call *)copy)->addresses;
     return e_call;
 }
@@ -84,10 +124,10 @@ static void * extern_call_ctor(const void * copy) {
 static void extern_call_dtor(void * copy) {
     const struct extern_call * e_call = copy;
     gda_destroy(e_call->addresses);
-    free(copy);
+    mem_free(copy);
 }
 /**
- * @brief Compares two extern call entries based on their symbol names.
+ * @brief Compares two extern call entries based on the ids of their interned names.
  * @param a Pointer to the first extern call entry.
  * @param b Pointer to the second extern call entry.
  * @return An integer representing the comparison result.
@@ -95,7 +135,7 @@ static void extern_call_dtor(void * copy) {
 static int extern_call_compar(const void *a, const void * b) {
     const struct extern_call * e_call1 = a;
     const struct extern_call * e_call2 = b;
-    return strcmp(e_call1->symbol_name,e_call2->symbol_name);
+    return (e_call1->symbol_name->id > e_call2->symbol_name->id) - (e_call1->symbol_name->id < e_call2->symbol_name->id);
 }
 /**
  * @brief Creates a new translation unit with initialized data structures.
@@ -103,9 +143,15 @@ static int extern_call_compar(const void *a, const void * b) {
  */
 static struct translation_unit assembler_create_new_translation_unit() {
     struct translation_unit t_unit = {0};
+    t_unit.names    = str_pool_create();
     t_unit.bmc_code = gda_create(bmc_ctor,bmc_dtor,NULL);
     t_unit.bmc_data = gda_create(bmc_ctor,bmc_dtor,NULL);
     t_unit.symbol_table = gda_create(symbol_table_ctor,symbol_table_dtor,symbol_table_compar);
+    /* symbols are mostly inserted in id order, which keeps the table sorted, a late out of order insert is sorted once by the next search */
+    gda_set_bulk_load(t_unit.symbol_table,1);
+    t_unit.symbol_ids   = gda_create(symbol_ptr_ctor,symbol_table_dtor,NULL);
+    t_unit.symbol_refs  = gda_create(symbol_ref_ctor,symbol_table_dtor,NULL);
+    t_unit.symbol_fixups = gda_create(symbol_ref_ctor,symbol_table_dtor,NULL);
     t_unit.extern_usage = gda_create(extern_call_ctor,extern_call_dtor,extern_call_compar);
    return t_unit;
 }
@@ -117,501 +163,2308 @@ static void assembler_destroy_translation_unit(struct translation_unit * t_unit)
     gda_destroy(t_unit->bmc_code);
     gda_destroy(t_unit->bmc_data);    
     gda_destroy(t_unit->extern_usage);
+    gda_destroy(t_unit->symbol_refs);
+    gda_destroy(t_unit->symbol_fixups);
+    gda_destroy(t_unit->symbol_ids);
     gda_destroy(t_unit->symbol_table);
+    str_pool_destroy(t_unit->names);
 } 
+/**
+ * @brief Empties a translation unit for the next file, its tables and name pool keep the memory they grew to.
+ * @param t_unit Pointer to the translation unit to be emptied.
+ */
+static void assembler_reset_translation_unit(struct translation_unit * t_unit) {
+    gda_clear(t_unit->bmc_code);
+    gda_clear(t_unit->bmc_data);
+    gda_clear(t_unit->extern_usage);
+    gda_clear(t_unit->symbol_refs);
+    gda_clear(t_unit->symbol_fixups);
+    gda_clear(t_unit->symbol_ids);
+    gda_clear(t_unit->symbol_table);
+    str_pool_clear(t_unit->names);
+    memset(&t_unit->stats,0,sizeof(t_unit->stats));
+}
 /**
  * @brief Prints an error message with file name, line number, and a custom message.
+ * @param out Where the message is printed.
  * @param file_name The name of the file where the error occurred.
  * @param line The line number where the error occurred.
  * @param fmt A format string for the custom error message.
  * @param ... Variable arguments for the format string.
  */
-static void asm_error_printer(const char *file_name,int line, const char * fmt,... ) {
+static void asm_error_printer(FILE *out,const char *file_name,int line, const char * fmt,... ) {
     va_list arg;
-    printf("%s:%d: ",file_name,line);
-    printf(TERMINAL_RED "error: " TERMINAL_RESET);
+    fprintf(out,"%s:%d: ",file_name,line);
+    fprintf(out,TERMINAL_RED "error: " TERMINAL_RESET);
     va_start (arg, fmt);
     
-    vprintf(fmt, arg);
+    vfprintf(out,fmt, arg);
     va_end(arg);
 }
 /**
  * @brief Prints a warning message with file name, line number, and a custom message.
+ * @param out Where the message is printed.
  * @param file_name The name of the file where the warning occurred.
  * @param line The line number where the warning occurred.
  * @param fmt A format string for the custom warning message.
  * @param ... Variable arguments for the format string.
  */
-static void asm_warning_printer(const char *file_name,int line, const char * fmt,... ) {
+static void asm_warning_printer(FILE *out,const char *file_name,int line, const char * fmt,... ) {
     va_list arg;
-    printf("%s:%d: ",file_name,line);
-    printf(TERMINAL_YELLOW "warning: " TERMINAL_RESET);
+    fprintf(out,"%s:%d: ",file_name,line);
+    fprintf(out,TERMINAL_YELLOW "warning: " TERMINAL_RESET);
     va_start (arg, fmt);
     
-    vprintf(fmt, arg);
+    vfprintf(out,fmt, arg);
     va_end(arg);
 }
 /**
- * @brief Performs the first pass of the assembler to populate the symbol table.
- * @param symbol_table The gda symbol table to be populated.
- * @param am_file The input assembly file to be processed.
- * @param file_name The name of the input assembly file for error and warning messages.
- * @return Returns 0 if successful, -1 if a syntax error is found, or 1 if other errors are found.
+ * @brief Returns the symbol whose name is the first len characters of name, inserting it as unresolved with the next free id if it is not in the table yet.
+ * @param t_unit The translation unit that holds the symbol table.
+ * @param name The name of the symbol, does not have to be null terminated.
+ * @param len The length of the name.
+ * @param line The line in which the symbol is first seen.
+ * @return Pointer to the symbol inside the symbol table, NULL on allocation failure.
+ */
+static struct symbol * assembler_intern_symbol_n(struct translation_unit * t_unit,const char * name,size_t len,int line) {
+    struct symbol dummy = {0};
+    struct symbol * in_table;
+    dummy.symbol_name = str_pool_intern_n(t_unit->names,name,len);
+    if(dummy.symbol_name == NULL)
+        return NULL;
+    in_table = gda_search(t_unit->symbol_table,&dummy);
+    if(in_table == NULL) {
+        dummy.sym_type = sym_type_unresolved;
+        dummy.line_def = line;
+        dummy.id       = gda_size(t_unit->symbol_ids);
+        in_table = gda_insert(t_unit->symbol_table,&dummy);
+        /* a symbol without an id would make the ids of the symbols after it wrong */
+        if(in_table && gda_insert(t_unit->symbol_ids,&in_table) == NULL) {
+            gda_delete(t_unit->symbol_table,in_table);
+            in_table = NULL;
+        }
+    }
+    return in_table;
+}
+/**
+ * @brief Returns the symbol with the given name without inserting it, neither in the name pool nor in the symbol table.
+ * @param t_unit The translation unit that holds the symbol table.
+ * @param name The name of the symbol.
+ * @return Pointer to the symbol inside the symbol table, NULL if there is none.
+ */
+static struct symbol * assembler_find_symbol(struct translation_unit * t_unit,const char * name) {
+    struct symbol dummy = {0};
+    dummy.symbol_name = str_pool_find(t_unit->names,name);
+    if(dummy.symbol_name == NULL)
+        return NULL;
+    return gda_search(t_unit->symbol_table,&dummy);
+}
+/**
+ * @brief Collects the symbol operands of an instruction, in the order the second pass encodes them.
+ * @param s_struct The parsed instruction.
+ * @param symbols Output array of at most 3 symbol names.
+ * @return The number of symbol operands found.
+ */
+static int assembler_get_symbol_operands(const struct syntax_struct * s_struct,const char * symbols[3]) {
+    int i, count = 0;
+    if(is_i_tag_groupA(s_struct->asm_directive_and_cpu_inst.cpu_inst.i_tag)) {
+        for(i=0;i<2;i++)
+            if(s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_A.left_and_right_args[i] == tag_arg_tag_symbol)
+                symbols[count++] = s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_A.arg_option[i].symbol;
+    }else if(is_i_tag_groupB(s_struct->asm_directive_and_cpu_inst.cpu_inst.i_tag)) {
+        if(s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.arg_options == tag_arg_2_args_with_symbol) {
+            symbols[count++] = s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.sub_group_b.arg_2_symbol.symbol;
+            for(i=0;i<2;i++)
+                if(s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.sub_group_b.arg_2_symbol.left_and_right_args[i] == tag_arg_tag_symbol)
+                    symbols[count++] = s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.sub_group_b.arg_2_symbol.arg_2_args_options[i].symbol;
+        }else if(s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.sub_group_b.rest_of_group_b.arg_opt == tag_arg_tag_symbol) {
+            symbols[count++] = s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.sub_group_b.rest_of_group_b.arg_option.symbol;
+        }
+    }
+    return count;
+}
+/**
+ * @brief Returns the symbol operand an instruction writes to: the destination of mov, add, sub and lea, the operand of not, clr, inc, dec and red.
+ * @param s_struct The parsed instruction.
+ * @return The name of the symbol, NULL if the instruction writes no symbol.
+ */
+static const char * assembler_get_written_symbol(const struct syntax_struct * s_struct) {
+    enum inst_tag i_tag = s_struct->asm_directive_and_cpu_inst.cpu_inst.i_tag;
+    if(i_tag == tag_mov || i_tag == tag_add || i_tag == tag_sub || i_tag == tag_lea) {
+        if(s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_A.left_and_right_args[1] == tag_arg_tag_symbol)
+            return s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_A.arg_option[1].symbol;
+    }else if(i_tag == tag_not || i_tag == tag_clr || i_tag == tag_inc || i_tag == tag_dec || i_tag == tag_red) {
+        if(s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.arg_options == tag_1_arg &&
+           s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.sub_group_b.rest_of_group_b.arg_opt == tag_arg_tag_symbol)
+            return s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.sub_group_b.rest_of_group_b.arg_option.symbol;
+    }
+    return NULL;
+}
+/* A symbol table event of a single line, produced while parsing and applied to the symbol table in source order. */
+struct first_pass_event {
+    enum {
+        ev_syntax_error,
+        ev_code_label,
+        ev_data_label,
+        ev_data_no_label,
+        ev_extern,
+        ev_entry,
+        ev_reference
+    }kind;
+    int             line;   /* line number, relative to the chunk. */
+    unsigned int    offset; /* IC or DC of a label, relative to the chunk. */
+    const char     *text;   /* symbol name or syntax error, not null terminated, NULL if the event has none. */
+    unsigned int    len;    /* length of text. */
+};
+
+/* A block of event texts that could not point into the source. */
+struct first_pass_text {
+    struct first_pass_text *next;   /* the block filled before this one. */
+    size_t                  size;   /* capacity of text. */
+    size_t                  used;   /* characters of text in use. */
+    char                    text[1];
+};
+
+/**
+ * @brief The symbol table events of a part of a file.
+ * an event is stored by value, its text is a span of the source buffer the part was parsed from,
+ * only texts that are not in a buffer which outlives the events are copied, into blocks owned by the list.
+ * @param items the events in source order.
+ * @param count the amount of events.
+ * @param capacity the amount of events items has room for.
+ * @param texts the text blocks, newest first.
+ * @param failed set once an event could not be added, the list is incomplete and must not be applied.
+ */
+struct first_pass_events {
+    struct first_pass_event    *items;
+    unsigned int                count;
+    unsigned int                capacity;
+    struct first_pass_text     *texts;
+    int                         failed;
+};
+
+/**
+ * @brief A line aligned part of the .am file, parsed on its own.
+ * @param begin first character of the chunk.
+ * @param end one past the last character of the chunk.
+ * @param events the events of the chunk, their texts point into [begin,end) unless they had to be copied.
+ * @param ic_words the amount of code words of the chunk.
+ * @param dc_words the amount of data words of the chunk.
+ * @param line_count the amount of lines of the chunk.
+ */
+struct first_pass_chunk {
+    const char                 *begin;
+    const char                 *end;
+    struct first_pass_events    events;
+    unsigned int                ic_words;
+    unsigned int                dc_words;
+    int                         line_count;
+};
+
+/**
+ * @brief Frees the events and their copied texts, the list is left empty.
+ * @param events The events.
+ */
+static void first_pass_events_free(struct first_pass_events * events) {
+    struct first_pass_text * next;
+    while(events->texts) {
+        next = events->texts->next;
+        mem_free(events->texts);
+        events->texts = next;
+    }
+    mem_free(events->items);
+    memset(events,0,sizeof(struct first_pass_events));
+}
+/**
+ * @brief Appends an event.
+ * @param events The events.
+ * @param ev The event, copied by value, its text is not copied.
+ * @return 0 if successful, -1 on allocation failure, which also marks the list as failed.
+ */
+static int first_pass_events_add(struct first_pass_events * events,const struct first_pass_event * ev) {
+    struct first_pass_event * grown;
+    unsigned int capacity;
+    if(events->count == events->capacity) {
+        capacity = events->capacity ? events->capacity * 2 : 256;
+        grown = mem_realloc(mem_tag_first_pass,events->items,capacity * sizeof(struct first_pass_event));
+        if(grown == NULL) {
+            events->failed = 1;
+            return -1;
+        }
+        events->items = grown;
+        events->capacity = capacity;
+    }
+    events->items[events->count++] = *ev;
+    return 0;
+}
+/**
+ * @brief Copies a text into the text blocks of the events.
+ * @param events The events.
+ * @param text The text, does not have to be null terminated.
+ * @param len The length of text.
+ * @return The copy, NULL on allocation failure, which also marks the list as failed.
+ */
+static const char * first_pass_events_copy_text(struct first_pass_events * events,const char * text,size_t len) {
+    struct first_pass_text * block = events->texts;
+    size_t size;
+    char * copy;
+    if(block == NULL || block->size - block->used < len) {
+        size = len > FIRST_PASS_TEXT_BLOCK_SIZE ? len : FIRST_PASS_TEXT_BLOCK_SIZE;
+        block = mem_malloc(mem_tag_first_pass,sizeof(struct first_pass_text) + size);
+        if(block == NULL) {
+            events->failed = 1;
+            return NULL;
+        }
+        block->next = events->texts;
+        block->size = size;
+        block->used = 0;
+        events->texts = block;
+    }
+    copy = block->text + block->used;
+    memcpy(copy,text,len);
+    block->used += len;
+    return copy;
+}
+/**
+ * @brief Computes how many code and data words a parsed line takes.
+ * @param s_struct The parsed line.
+ * @param ic_words Output for the amount of code words.
+ * @param dc_words Output for the amount of data words.
  */
-static int assembler_first_pass_symbol_table(gda symbol_table, FILE * am_file,const char * file_name) {
+static void assembler_line_words(const struct syntax_struct * s_struct,unsigned int * ic_words,unsigned int * dc_words) {
+    *ic_words = 0;
+    *dc_words = 0;
+    if(s_struct->dir_or_inst_tag == tag_inst) {
+        *ic_words = 1;
+        /* Check if instruction belongs to group A */
+        if(is_i_tag_groupA(s_struct->asm_directive_and_cpu_inst.cpu_inst.i_tag)) {
+            if(s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_A.left_and_right_args[0] == tag_arg_tag_register && 
+                s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_A.left_and_right_args[1] == tag_arg_tag_register)
+                    *ic_words += 1;/* two registers*/
+            else {
+                *ic_words += 2;
+            }
+            /* Check if instruction belongs to group B */
+        }else if (is_i_tag_groupB(s_struct->asm_directive_and_cpu_inst.cpu_inst.i_tag)) {
+            if(s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.arg_options == tag_arg_2_args_with_symbol) {
+                    if(s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.sub_group_b.arg_2_symbol.left_and_right_args[0] == tag_arg_tag_register &&
+                        s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.sub_group_b.arg_2_symbol.left_and_right_args[1] == tag_arg_tag_register ) {
+                            *ic_words += 2;
+                        }
+                        else {
+                            *ic_words += 3;
+                        }
+            }else {
+                *ic_words += 1;
+            }
+        }
+    }else if(s_struct->dir_or_inst_tag == tag_dir) {
+        if(s_struct->asm_directive_and_cpu_inst.asm_directive.d_tag == tag_string)
+            *dc_words = strlen(s_struct->asm_directive_and_cpu_inst.asm_directive.directive_union.string) + 1;
+        else if(s_struct->asm_directive_and_cpu_inst.asm_directive.d_tag == tag_data)
+            *dc_words = s_struct->asm_directive_and_cpu_inst.asm_directive.directive_union.data_array.num_count;
+        else if(s_struct->asm_directive_and_cpu_inst.asm_directive.d_tag == tag_space || s_struct->asm_directive_and_cpu_inst.asm_directive.d_tag == tag_fill)
+            *dc_words = s_struct->asm_directive_and_cpu_inst.asm_directive.directive_union.fill.count;
+    }
+}
+/**
+ * @brief Adds an event to a chunk.
+ * the text is pointed to where it appears in source, it is copied only if it does not appear there.
+ * @param chunk The chunk.
+ * @param kind The kind of the event.
+ * @param offset The IC or DC of a label, relative to the chunk.
+ * @param text The symbol name or syntax error, NULL if the event has none.
+ * @param source The line text in a buffer that outlives the events, NULL if there is none.
+ * @param source_len The length of the line text.
+ */
+static void assembler_chunk_add_event(struct first_pass_chunk * chunk,int kind,unsigned int offset,const char * text,const char * source,size_t source_len) {
+    struct first_pass_event ev;
+    const char * match = NULL;
+    size_t i;
+    ev.kind   = kind;
+    ev.line   = chunk->line_count;
+    ev.offset = offset;
+    ev.text   = NULL;
+    ev.len    = text ? strlen(text) : 0;
+    if(ev.len > 0) {
+        for(i=0;source && match == NULL && i + ev.len <= source_len;i++) {
+            if(source[i] == text[0] && memcmp(source + i,text,ev.len) == 0)
+                match = source + i;
+        }
+        ev.text = match ? match : first_pass_events_copy_text(&chunk->events,text,ev.len);
+        if(ev.text == NULL)
+            return;
+    }
+    first_pass_events_add(&chunk->events,&ev);
+}
+/**
+ * @brief Parses and sizes the next line of a chunk, its symbol table events are added to the chunk.
+ * @param chunk The chunk the line belongs to.
+ * @param line The logical line.
+ * @param source The same line in a buffer that outlives the events of the chunk, they point into it. NULL copies the texts.
+ * @param s_struct Output for the parsed line.
+ */
+static void assembler_first_pass_parse_line(struct first_pass_chunk * chunk,char * line,const char * source,struct syntax_struct * s_struct) {
+    const char * operands[3];
+    int operand_count, i;
+    unsigned int ic_words, dc_words;
+    size_t line_len = strlen(line);
+    /* Create a syntax_struct from the logical line */
+    *s_struct = lang_engine_create_ss_from_logical_line(line);
+    switch (s_struct->dir_or_inst_tag)
+    {
+    case tag_syntax_error:
+        /* the message is not in the source */
+        assembler_chunk_add_event(chunk,ev_syntax_error,0,s_struct->syntax_error_buffer,NULL,0);
+        break;
+    case tag_inst:
+        if(s_struct->symbol[0] !='\0')
+            assembler_chunk_add_event(chunk,ev_code_label,chunk->ic_words,s_struct->symbol,source,line_len);
+        operand_count = assembler_get_symbol_operands(s_struct,operands);
+        for(i=0;i<operand_count;i++)
+            assembler_chunk_add_event(chunk,ev_reference,0,operands[i],source,line_len);
+        break;
+    case tag_dir:
+        if(s_struct->asm_directive_and_cpu_inst.asm_directive.d_tag == tag_extern)
+            assembler_chunk_add_event(chunk,ev_extern,0,s_struct->asm_directive_and_cpu_inst.asm_directive.directive_union.symbol,source,line_len);
+        else if(s_struct->asm_directive_and_cpu_inst.asm_directive.d_tag == tag_entry)
+            assembler_chunk_add_event(chunk,ev_entry,0,s_struct->asm_directive_and_cpu_inst.asm_directive.directive_union.symbol,source,line_len);
+        else if(s_struct->symbol[0] == '\0')
+            assembler_chunk_add_event(chunk,ev_data_no_label,0,NULL,NULL,0);
+        else
+            assembler_chunk_add_event(chunk,ev_data_label,chunk->dc_words,s_struct->symbol,source,line_len);
+        break;
+    default:
+        break;
+    }
+    assembler_line_words(s_struct,&ic_words,&dc_words);
+    chunk->ic_words += ic_words;
+    chunk->dc_words += dc_words;
+    chunk->line_count++;
+}
+/**
+ * @brief Parses and sizes every line of a chunk, this does not touch the translation unit so chunks can be parsed concurrently.
+ * @param arg Pointer to the struct first_pass_chunk.
+ * @return NULL
+ */
+static void * assembler_first_pass_parse_chunk(void * arg) {
+    struct first_pass_chunk * chunk = arg;
     char buffer[max_line_size + 1] = {0};
     struct syntax_struct s_struct;
+    const char * cursor = chunk->begin;
+    const char * line = cursor;
+    while(source_buffer_next_line(&cursor,chunk->end,buffer,max_line_size)) {
+        assembler_first_pass_parse_line(chunk,buffer,line,&s_struct);
+        line = cursor;
+    }
+    STATS_FLUSH();
+    return NULL;
+}
+/**
+ * @brief Entry of a thread that parses a chunk.
+ * @param arg Pointer to the struct first_pass_chunk.
+ * @return NULL
+ */
+static void * assembler_first_pass_chunk_worker(void * arg) {
+    TRACE_THREAD("first pass worker");
+    TRACE_BEGIN("parse chunk",NULL);
+    assembler_first_pass_parse_chunk(arg);
+    TRACE_END();
+    TRACE_RELEASE();
+    return NULL;
+}
+/**
+ * @brief Applies one event to the symbol table.
+ * @param t_unit The translation unit whose symbol table is updated.
+ * @param ev The event.
+ * @param line The line number of the event in the file.
+ * @param IC The instruction counter of the event.
+ * @param DC The data counter of the event.
+ * @param file_name The name of the input assembly file for error and warning messages.
+ * @return 1 if the event is an error, 0 otherwise.
+ */
+static int assembler_first_pass_apply_event(struct translation_unit * t_unit,const struct first_pass_event * ev,int line,unsigned int IC,unsigned int DC,const char * file_name) {
     struct symbol * in_table = NULL;
-    struct symbol dummy;
-    int line_count = 1;
-    int error =0;
-    int IC = PROG_BASE_ADDR,DC = 0;
-    void *const* sym_table_it_begin;
-    void *const* sym_table_it_end;
-    /* Read lines from the input assembly file */
-    while(fgets(buffer,max_line_size,am_file)) {
-        /* Create a syntax_struct from the logical line */
-        s_struct = lang_engine_create_ss_from_logical_line(buffer);
-        /* Process the syntax_struct based on its tag (instruction, directive, or error) */
-        switch (s_struct.dir_or_inst_tag)
+    int error = 0;
+    if(ev->kind != ev_syntax_error && ev->kind != ev_data_no_label) {
+        /* Search for the symbol in the symbol table, a placeholder is created if it was never seen before */
+        in_table = assembler_intern_symbol_n(t_unit,ev->text,ev->len,line);
+        if(in_table == NULL) {
+            asm_error_printer(t_unit->diagnostics,file_name,line,"could not allocate the symbol '%.*s'.\n",(int)ev->len,ev->text);
+            return 1;
+        }
+    }
+    switch (ev->kind)
+    {
+    case ev_syntax_error:
+        asm_error_printer(t_unit->diagnostics,file_name,line,"syntax: %.*s\n",(int)ev->len,ev->text);
+        error =1;
+        break;
+    case ev_code_label:
+        switch (in_table->sym_type)
         {
-        case tag_syntax_error:
-        /* Return an error if a syntax error is found */
-            asm_error_printer(file_name,line_count,"syntax: %s\n",s_struct.syntax_error_buffer);
+            /* Update the symbol type and address */
+        case sym_type_unresolved:
+            in_table->addr      = IC;
+            in_table->sym_type  = sym_type_code;
+            in_table->line_def  = line;
+            break;
+        case sym_type_entry:
+            in_table->addr      = IC;
+            in_table->sym_type  = sym_type_code_entry;
+            break;
+        
+        default: /* all other cases are of course errors....*/
+            asm_error_printer(t_unit->diagnostics,file_name,line,"symbol is being defined as '%s' but was defined before as '%s' in line %d.\n",sym_type_str[sym_type_code],sym_type_str[in_table->sym_type],in_table->line_def);
             error =1;
             break;
+        }
+        break;
+    case ev_reference:
+        /* Record the id of every symbol operand for the second pass, a missing one would shift every fixup after it */
+        if(gda_insert(t_unit->symbol_refs,&in_table->id) == NULL) {
+            asm_error_printer(t_unit->diagnostics,file_name,line,"could not record the reference to '%s'.\n",in_table->symbol_name->string);
+            error =1;
+        }
+        break;
+    case ev_extern:
+        /* process the symbol according to what it was so far */
+        switch (in_table->sym_type)
+        {
+        case sym_type_unresolved:
+            in_table->sym_type = sym_type_extern;
+            in_table->line_def = line;
+            break;
+        case sym_type_extern:
+            /* warning redefinition as extern...*/
+            asm_warning_printer(t_unit->diagnostics,file_name,line,"symbol:'%s' was already defined as '%s' in line %d.\n",in_table->symbol_name->string,sym_type_str[sym_type_extern],in_table->line_def);
+            break;
+
+        default:
+            /* error for the rest of the cases DUHHH*/
+            asm_error_printer(t_unit->diagnostics,file_name,line,"symbol:'%s' was defined in line %d as '%s' and now is being defined as '%s'.\n",in_table->symbol_name->string,in_table->line_def,sym_type_str[in_table->sym_type],sym_type_str[sym_type_extern]);
+            error =1;
+            break;
+        }
+        break;
+    case ev_entry:
+        switch (in_table->sym_type)
+        {
+        case sym_type_unresolved:
+            in_table->sym_type = sym_type_entry;
+            in_table->line_def = line;
+            break;
+        case sym_type_data:
+            in_table->sym_type= sym_type_data_entry;
+            break;
+        case sym_type_code:
+            in_table->sym_type= sym_type_code_entry;
+            break;
+        case sym_type_extern:
+            asm_error_printer(t_unit->diagnostics,file_name,line,"symbol:'%s' was defined as '%s' in line %d but now it's being redefined as '%s'\n",in_table->symbol_name->string,sym_type_str[in_table->sym_type],in_table->line_def,sym_type_str[sym_type_extern]);
+            error = 1;
+            /* error what the fuck ? cant be extern and entry !*/
+            break;
+        case sym_type_entry: case sym_type_code_entry: case sym_type_data_entry:
+            /* warning you are trying to redfine this symbol as entry*/
+            asm_warning_printer(t_unit->diagnostics,file_name,line,"symbol:'%s' was already defined as '%s' in line %d.\n",in_table->symbol_name->string,sym_type_str[sym_type_entry],in_table->line_def);
+            break;
+        default:
+            break;
+        }
+        break;
+    case ev_data_no_label:
+        /* warning inserting data or string without a pointing symbol..... how you gonna use it ?*/
+        asm_warning_printer(t_unit->diagnostics,file_name,line,"data or string directive without a pointing symbol.\n");
+        break;
+    case ev_data_label:
+        switch (in_table->sym_type)
+        {
+            case sym_type_unresolved:
+            in_table->sym_type = sym_type_data;
+            in_table->line_def = line;
+            in_table->addr = DC;
+            break;
+            case sym_type_entry:
+            in_table->sym_type= sym_type_data_entry;
+            in_table->addr = DC;
+            break;
+        default: 
+            /* error redefinition now it's ...*/
+            asm_error_printer(t_unit->diagnostics,file_name,line,"symbol :'%s' was defined as '%s' in line  %d and now it's being redefined as '%s'.\n",in_table->symbol_name->string,sym_type_str[in_table->sym_type],in_table->line_def,sym_type_str[sym_type_data_entry]);
+            error =1;
+            break;
+        }
+        break;
+    }
+    return error;
+}
+/**
+ * @brief Applies the events of a chunk to the symbol table, in source order.
+ * @param t_unit The translation unit whose symbol table is updated.
+ * @param chunk The parsed chunk.
+ * @param line_count The line number the chunk starts at, advanced past the chunk.
+ * @param IC The instruction counter the chunk starts at, advanced past the chunk.
+ * @param DC The data counter the chunk starts at, advanced past the chunk.
+ * @param file_name The name of the input assembly file for error and warning messages.
+ * @return 1 if any of the events is an error, 0 otherwise.
+ */
+static int assembler_first_pass_apply_chunk(struct translation_unit * t_unit,const struct first_pass_chunk * chunk,int * line_count,unsigned int * IC,unsigned int * DC,const char * file_name) {
+    const struct first_pass_event * ev;
+    unsigned int i;
+    int error = 0;
+    /* the symbols of the lost events would be missing, and a lost reference shifts every fixup after it */
+    if(chunk->events.failed) {
+        asm_error_printer(t_unit->diagnostics,file_name,*line_count,"could not allocate the symbol table events.\n");
+        error = 1;
+    }
+    for(i=0;!chunk->events.failed && i<chunk->events.count;i++) {
+        ev = &chunk->events.items[i];
+        error |= assembler_first_pass_apply_event(t_unit,ev,*line_count + ev->line,*IC + ev->offset,*DC + ev->offset,file_name);
+    }
+    *IC          += chunk->ic_words;
+    *DC          += chunk->dc_words;
+    *line_count  += chunk->line_count;
+    return error;
+}
+/**
+ * @brief Finishes the symbol table once every event was applied.
+ * the table is sorted, data addresses are moved after the code and symbols that were never defined are reported.
+ * @param t_unit The translation unit whose symbol table is finished.
+ * @param IC The instruction counter at the end of the file.
+ * @param file_name The name of the input assembly file for error messages.
+ * @return 1 if a symbol was never defined, 0 otherwise.
+ */
+static int assembler_first_pass_finish(struct translation_unit * t_unit,unsigned int IC,const char * file_name) {
+    void *const* sym_ids_it_begin;
+    void *const* sym_ids_it_end;
+    struct symbol * in_table;
+    int error = 0;
+    /* the table is sorted for binary search lookups and a deterministic .ent order */
+    gda_sort(t_unit->symbol_table);
+    /* a single scan over the id space fixes data addresses and finds every symbol that was never defined */
+    gda_for_each(t_unit->symbol_ids,sym_ids_it_begin,sym_ids_it_end) {
+        in_table = *(struct symbol **)(*sym_ids_it_begin);
+        if(in_table->sym_type == sym_type_data || in_table->sym_type == sym_type_data_entry )
+            in_table->addr +=IC;
+        else if (in_table->sym_type == sym_type_entry) {
+            /* error , it was declared as entry but was never defined in this file....!*/
+            asm_error_printer(t_unit->diagnostics,file_name,in_table->line_def,"symbol : '%s' was declared as '%s' in line %d but was never defined.\n",in_table->symbol_name->string,sym_type_str[in_table->sym_type],in_table->line_def);
+            error = 1;
+        } else if (in_table->sym_type == sym_type_unresolved) {
+            /* error couldn't find the symbol in the sym table...*/
+            asm_error_printer(t_unit->diagnostics,file_name,in_table->line_def,"undefined symbol: '%s'.\n",in_table->symbol_name->string);
+            error = 1;
+        }
+    }
+    return error;
+}
+/**
+ * @brief Performs the first pass of the assembler to populate the symbol table.
+ * every symbol seen (defined or referenced) gets a dense id, forward references get an unresolved placeholder,
+ * and the id of each symbol operand is recorded in symbol_refs for the second pass.
+ * the file is split into line aligned chunks that are parsed and sized concurrently, then the IC/DC of every chunk
+ * is found by prefix sums and the chunk events are applied to the symbol table in source order, so the
+ * diagnostics are the same for any amount of threads.
+ * @param t_unit The translation unit whose symbol table is to be populated.
+ * @param am_file The contents of the input assembly file.
+ * @param file_name The name of the input assembly file for error and warning messages.
+ * @param threads The amount of threads to parse with, 1 parses on the calling thread.
+ * @return Returns 0 if successful, -1 if a syntax error is found, or 1 if other errors are found.
+ */
+static int assembler_first_pass_symbol_table(struct translation_unit * t_unit, source_buffer am_file,const char * file_name,int threads) {
+    struct first_pass_chunk * chunks;
+    pthread_t * workers;
+    int * started;
+    const char * contents = source_buffer_begin(am_file);
+    const char * cursor;
+    size_t size;
+    int chunk_count, c;
+    int line_count = 1;
+    int error =0;
+    unsigned int IC = PROG_BASE_ADDR,DC = 0;
+
+    size = source_buffer_end(am_file) - contents;
+    /* small files are not worth a thread per chunk */
+    chunk_count = threads;
+    if(chunk_count < 1 || size < FIRST_PASS_MIN_CHUNK_SIZE * 2)
+        chunk_count = 1;
+    if(chunk_count > 1 && size / chunk_count < FIRST_PASS_MIN_CHUNK_SIZE)
+        chunk_count = size / FIRST_PASS_MIN_CHUNK_SIZE;
+    chunks  = mem_calloc(mem_tag_first_pass,chunk_count,sizeof(struct first_pass_chunk));
+    workers = mem_calloc(mem_tag_first_pass,chunk_count,sizeof(pthread_t));
+    started = mem_calloc(mem_tag_first_pass,chunk_count,sizeof(int));
+    if(!chunks || !workers || !started) {
+        mem_free(chunks);
+        mem_free(workers);
+        mem_free(started);
+        return 1;
+    }
+    /* split on line ends */
+    cursor = contents;
+    for(c=0;c<chunk_count;c++) {
+        chunks[c].begin  = cursor;
+        cursor = (c == chunk_count - 1) ? contents + size : contents + (size / chunk_count) * (c + 1);
+        if(cursor < chunks[c].begin)
+            cursor = chunks[c].begin;
+        while(cursor < contents + size && cursor > contents && cursor[-1] != '\n')
+            cursor++;
+        chunks[c].end    = cursor;
+    }
+    /* the calling thread parses the first chunk, a chunk whose thread could not be started is parsed here as well */
+    for(c=1;c<chunk_count;c++)
+        started[c] = pthread_create(&workers[c],NULL,assembler_first_pass_chunk_worker,&chunks[c]) == 0;
+    assembler_first_pass_parse_chunk(&chunks[0]);
+    for(c=1;c<chunk_count;c++) {
+        if(started[c])
+            pthread_join(workers[c],NULL);
+        else
+            assembler_first_pass_parse_chunk(&chunks[c]);
+    }
+    /* apply the events in source order, a chunk starts at the prefix sums of the chunks before it */
+    for(c=0;c<chunk_count;c++) {
+        error |= assembler_first_pass_apply_chunk(t_unit,&chunks[c],&line_count,&IC,&DC,file_name);
+        first_pass_events_free(&chunks[c].events);
+    }
+    mem_free(chunks);
+    mem_free(workers);
+    mem_free(started);
+    error |= assembler_first_pass_finish(t_unit,IC,file_name);
+    return error;
+}
+/**
+ * @brief Records a symbol operand to be resolved once the symbol table is complete.
+ * @param t_unit The translation unit holding bmc_code and the symbol fixups.
+ * @return The placeholder word, the fixup overwrites it.
+ */
+static unsigned short assembler_symbol_placeholder(struct translation_unit * t_unit) {
+    unsigned int index = gda_size(t_unit->bmc_code);
+    gda_insert(t_unit->symbol_fixups,&index);
+    return 0;
+}
+/**
+ * @brief Encodes a symbol operand, recording the calling address if the symbol is an extern.
+ * @param t_unit The translation unit holding the extern usage.
+ * @param f_sym The referenced symbol.
+ * @param index The index of the operand word in bmc_code.
+ * @return The operand word.
+ */
+static unsigned short assembler_encode_symbol_operand(struct translation_unit * t_unit,struct symbol * f_sym,unsigned int index) {
+    struct extern_call e_call_dummy = {0};
+    unsigned short temp;
+    if(f_sym->sym_type != sym_type_extern)
+        return (f_sym->addr << 2) | 2;
+    if(f_sym->usage == NULL) {
+        e_call_dummy.symbol_name = f_sym->symbol_name;
+        e_call_dummy.addresses = gda_create(bmc_ctor,bmc_dtor,NULL);
+        f_sym->usage = gda_insert(t_unit->extern_usage,&e_call_dummy);
+    }
+    temp = index + PROG_BASE_ADDR;
+    gda_insert(f_sym->usage->addresses,&temp);
+    return 1;
+}
+/**
+@brief Encodes a parsed line into bmc_code and bmc_data.
+symbol operands are encoded as placeholders recorded in symbol_fixups, so a line can be encoded before the symbol table
+is complete, and only bmc_code, bmc_data and symbol_fixups are touched.
+@param t_unit The translation unit containing bmc_code, bmc_data and the symbol fixups.
+@param s_struct The parsed line.
+*/
+static void assembler_encode_line(struct translation_unit * t_unit,const struct syntax_struct * s_struct) {
+    unsigned short bmc_code_i = 0;
+    const char *it;
+    int i;
+    /* Process the line based on the tag (directive, instruction, or syntax error/null line) */
+    switch (s_struct->dir_or_inst_tag) {
+        /*Ignore syntax errors or null lines*/
+        case tag_syntax_error: case tag_line_null:
+        break;
+        /* Handle an assembly instruction */
         case tag_inst:
-            /* Check if the symbol is not empty */
-            if(s_struct.symbol[0] !='\0') {
-                /* Copy the symbol to the dummy symbol */
-                strcpy(dummy.symbol_name,s_struct.symbol);
-                /* Search for the symbol in the symbol table */
-                in_table = gda_search(symbol_table,&dummy);
-                /* If the symbol is found in the table, process it accordingly */
-                if(in_table) {
-                    switch (in_table->sym_type)
-                    {
-                        /* Update the symbol type and address */
-                    case sym_type_entry:
-                        in_table->addr      = IC;
-                        in_table->sym_type  = sym_type_code_entry;
-                        break;
-                    
-                    default: /* all other cases are of course errors....*/
-                        asm_error_printer(file_name,line_count,"symbol is being defined as '%s' but was defined before as '%s' in line %d.\n",sym_type_str[sym_type_code],sym_type_str[in_table->sym_type],in_table->line_def);
-                        error =1;
-                        break;
+            bmc_code_i = s_struct->asm_directive_and_cpu_inst.cpu_inst.i_tag << 6;
+            /* Check if the instruction belongs to group A */
+            if(is_i_tag_groupA(s_struct->asm_directive_and_cpu_inst.cpu_inst.i_tag)) {
+                bmc_code_i |= s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_A.left_and_right_args[0] << 4;
+                bmc_code_i |= s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_A.left_and_right_args[1] << 2;
+                gda_insert(t_unit->bmc_code,&bmc_code_i);
+                if(s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_A.left_and_right_args[0] == tag_arg_tag_register && 
+                    s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_A.left_and_right_args[1] == tag_arg_tag_register) {
+                        bmc_code_i = (s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_A.arg_option[0].register_number << 8) |
+                         (s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_A.arg_option[1].register_number << 2);
+                         gda_insert(t_unit->bmc_code,&bmc_code_i);
+                    }else {
+                        for(i=0;i<2;i++) {
+                            switch (s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_A.left_and_right_args[i])
+                            {
+                            case tag_arg_tag_register:
+                                bmc_code_i = s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_A.arg_option[i].register_number << (8 - (i * 6));
+                                break;
+                            case tag_arg_tag_constant:
+                                bmc_code_i = s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_A.arg_option[i].constant_number << 2;
+                                break;
+                            case tag_arg_tag_symbol:
+                                bmc_code_i = assembler_symbol_placeholder(t_unit);
+                                break;
+                            default:
+                                break;
+                            }
+                            gda_insert(t_unit->bmc_code,&bmc_code_i);
+                        }
+                        
                     }
-                }else {
-                    /* If the symbol is not found in the table, insert it */
-                    dummy.sym_type = sym_type_code;
-                    dummy.addr     = IC;
-                    dummy.line_def = line_count;
-                    gda_insert(symbol_table,&dummy);
-                }
             }
-             /* Increment the instruction counter (IC) */
-            IC++;
-            /* Check if instruction belongs to group A */
-            if(is_i_tag_groupA(s_struct.asm_directive_and_cpu_inst.cpu_inst.i_tag)) {
-                if(s_struct.asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_A.left_and_right_args[0] == tag_arg_tag_register && 
-                    s_struct.asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_A.left_and_right_args[1] == tag_arg_tag_register)
-                        IC++;/* two registers*/
-                else {
-                    IC+=2;
-                }
-                /* Check if instruction belongs to group B */
-            }else if (is_i_tag_groupB(s_struct.asm_directive_and_cpu_inst.cpu_inst.i_tag)) {
-                if(s_struct.asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.arg_options == tag_arg_2_args_with_symbol) {
-                        if(s_struct.asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.sub_group_b.arg_2_symbol.left_and_right_args[0] == tag_arg_tag_register &&
-                            s_struct.asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.sub_group_b.arg_2_symbol.left_and_right_args[1] == tag_arg_tag_register ) {
-                                IC+=2;
-                            }
-                            else {
-                                IC+=3;
+             /* Process group B instructions */
+            else if(is_i_tag_groupB(s_struct->asm_directive_and_cpu_inst.cpu_inst.i_tag)) {
+                if(s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.arg_options == tag_arg_2_args_with_symbol) {
+                    bmc_code_i |= (2 << 2);
+                    bmc_code_i |= s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.sub_group_b.arg_2_symbol.left_and_right_args[0] << 12;
+                    bmc_code_i |= s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.sub_group_b.arg_2_symbol.left_and_right_args[1] << 10;
+                    gda_insert(t_unit->bmc_code,&bmc_code_i);
+                    bmc_code_i = assembler_symbol_placeholder(t_unit);
+                    gda_insert(t_unit->bmc_code,&bmc_code_i);
+                    if(s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.sub_group_b.arg_2_symbol.left_and_right_args[0] == tag_arg_tag_register &&
+                        s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.sub_group_b.arg_2_symbol.left_and_right_args[1] == tag_arg_tag_register) {
+                            bmc_code_i = s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.sub_group_b.arg_2_symbol.arg_2_args_options[0].register_number << 8 |
+                                        s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.sub_group_b.arg_2_symbol.arg_2_args_options[1].register_number << 2;
+                            gda_insert(t_unit->bmc_code,&bmc_code_i);
+                        }
+                    else {
+                        for(i=0;i<2;i++) {
+                            switch (s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.sub_group_b.arg_2_symbol.left_and_right_args[i])
+                            {
+                            case tag_arg_tag_register:
+                                bmc_code_i = s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.sub_group_b.arg_2_symbol.arg_2_args_options[i].register_number<< (8 - (i * 6));
+                                break;
+                            case tag_arg_tag_constant:
+                                bmc_code_i = s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.sub_group_b.arg_2_symbol.arg_2_args_options[i].constant_number << 2;
+                                break;
+                            case tag_arg_tag_symbol:
+                                bmc_code_i = assembler_symbol_placeholder(t_unit);
+                                break;
+                            default:
+                                break;
                             }
-                }else {
-                    IC+=1;
-                }
-            }
-            break;
-        case tag_dir:
-        /* If the syntax_struct is a directive */
-            /* Check the directive tag (extern, entry, string, data) */
-            if(s_struct.asm_directive_and_cpu_inst.asm_directive.d_tag == tag_extern || s_struct.asm_directive_and_cpu_inst.asm_directive.d_tag == tag_entry ) {
-                /* Copy the directive symbol to the dummy symbol */
-                strcpy(dummy.symbol_name,s_struct.asm_directive_and_cpu_inst.asm_directive.directive_union.symbol);
-                /*Search for the symbol in the symbol table */
-                in_table = gda_search(symbol_table,&dummy);
-            }
-            /* If the directive is an extern directive */
-            if(s_struct.asm_directive_and_cpu_inst.asm_directive.d_tag == tag_extern) {
-                /* If the symbol is found in the table, process it accordingly */
-                if(in_table) {
-                    switch (in_table->sym_type)
-                    {
-                    case sym_type_extern:
-                        /* warning redefinition as extern...*/
-                        asm_warning_printer(file_name,line_count,"symbol:'%s' was already defined as '%s' in line %d.\n",in_table->symbol_name,sym_type_str[sym_type_extern],in_table->line_def);
-                        break;
-
-                    default:
-                        /* error for the rest of the cases DUHHH*/
-                        asm_error_printer(file_name,line_count,"symbol:'%s' was defined in line %d as '%s' and now is being defined as '%s'.\n",in_table->symbol_name,in_table->line_def,sym_type_str[in_table->sym_type],sym_type_str[sym_type_extern]);
-                        error =1;
-                        break;
+                            gda_insert(t_unit->bmc_code,&bmc_code_i);
+                        }
                     }
                 }else {
-                     /* If the symbol is not found in the table, insert it */
-                    dummy.sym_type = sym_type_extern;
-                    dummy.line_def = line_count;
-                    gda_insert(symbol_table,&dummy);
-                }
-                /* If the directive is an entry directive */
-            }else if (s_struct.asm_directive_and_cpu_inst.asm_directive.d_tag == tag_entry) {
-                if(in_table) {
-                    switch (in_table->sym_type)
+                    bmc_code_i |= (s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.sub_group_b.rest_of_group_b.arg_opt << 2);
+                    gda_insert(t_unit->bmc_code,&bmc_code_i);
+                    switch (s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.sub_group_b.rest_of_group_b.arg_opt)
                     {
-                    case sym_type_data:
-                        in_table->sym_type= sym_type_data_entry;
+                    case tag_arg_tag_register:
+                         bmc_code_i = s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.sub_group_b.rest_of_group_b.arg_option.register_number << 2;
                         break;
-                    case sym_type_code:
-                        in_table->sym_type= sym_type_code_entry;
+                    case tag_arg_tag_constant:
+                        bmc_code_i = s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.sub_group_b.rest_of_group_b.arg_option.constant_number << 2;
                         break;
-                    case sym_type_extern:
-                        asm_error_printer(file_name,line_count,"symbol:'%s' was defined as '%s' in line %d but now it's being redefined as '%s'\n",in_table->symbol_name,sym_type_str[in_table->sym_type],in_table->line_def,sym_type_str[sym_type_extern]);
-                        error = 1;
-                        /* error what the fuck ? cant be extern and entry !*/
-                        break;
-                    case sym_type_entry: case sym_type_code_entry: case sym_type_data_entry:
-                        /* warning you are trying to redfine this symbol as entry*/
-                        asm_warning_printer(file_name,line_count,"symbol:'%s' was already defined as '%s' in line %d.\n",in_table->symbol_name,sym_type_str[sym_type_entry],in_table->line_def);
+                    case tag_arg_tag_symbol:
+                        bmc_code_i = assembler_symbol_placeholder(t_unit);
                         break;
-                    default:
-                        break;
-                    }
-                }else {
-                    dummy.sym_type = sym_type_entry;
-                    dummy.line_def = line_count;
-                    gda_insert(symbol_table,&dummy);
+                 }
+                 gda_insert(t_unit->bmc_code,&bmc_code_i);
                 }
+            }else {
+                gda_insert(t_unit->bmc_code,&bmc_code_i);
             }
-            else if(s_struct.asm_directive_and_cpu_inst.asm_directive.d_tag == tag_string || s_struct.asm_directive_and_cpu_inst.asm_directive.d_tag == tag_data) {
-                if(s_struct.symbol[0] == '\0') {
-                    /* warning inserting data or string without a pointing symbol..... how you gonna use it ?*/
-                    asm_warning_printer(file_name,line_count,"data or string directive without a pointing symbol.\n");
-                }else {
-                    strcpy(dummy.symbol_name,s_struct.symbol);
-                    in_table = gda_search(symbol_table,&dummy);
-                    if(in_table) {
-                        switch (in_table->sym_type)
-                        {
-                            case sym_type_entry:
-                            
-                            in_table->sym_type= sym_type_data_entry;
-                            in_table->addr = DC;
-                            if(s_struct.asm_directive_and_cpu_inst.asm_directive.d_tag == tag_string)
-                                DC += strlen(s_struct.asm_directive_and_cpu_inst.asm_directive.directive_union.string) + 1;
-                            else 
-                                DC += s_struct.asm_directive_and_cpu_inst.asm_directive.directive_union.data_array.num_count;
-                            break;
-                        default: 
-                            /* error redefinition now it's ...*/
-                            asm_error_printer(file_name,line_count,"symbol :'%s' was defined as '%s' in line  %d and now it's being redefined as '%s'.\n",in_table->symbol_name,sym_type_str[in_table->sym_type],in_table->line_def,sym_type_str[sym_type_data_entry]);
-                            error =1;
-                            break;
-                        }
-                    }else {
-                        /* If the symbol is not found in the table, insert it */
-                        dummy.addr = DC;
-                        dummy.sym_type = sym_type_data;
-                        dummy.line_def = line_count;
-                        if(s_struct.asm_directive_and_cpu_inst.asm_directive.d_tag == tag_string)
-                            DC += strlen(s_struct.asm_directive_and_cpu_inst.asm_directive.directive_union.string) + 1;
-                        else 
-                            DC += s_struct.asm_directive_and_cpu_inst.asm_directive.directive_union.data_array.num_count;
-                        
-        
-                        gda_insert(symbol_table,&dummy);
-                    }
+            break;
+        case tag_dir:
+        /* Handle an assembly directive */
+            if(s_struct->asm_directive_and_cpu_inst.asm_directive.d_tag == tag_string) {
+                for(it =s_struct->asm_directive_and_cpu_inst.asm_directive.directive_union.string;*it;it++) {
+                    bmc_code_i = *it;
+                    gda_insert(t_unit->bmc_data,&bmc_code_i);
+                }
+                bmc_code_i = 0;
+                gda_insert(t_unit->bmc_data,&bmc_code_i);
+            }else if (s_struct->asm_directive_and_cpu_inst.asm_directive.d_tag == tag_data){
+                /* Process data directive */
+                for(i=0;i<s_struct->asm_directive_and_cpu_inst.asm_directive.directive_union.data_array.num_count;i++) {
+                    bmc_code_i =s_struct->asm_directive_and_cpu_inst.asm_directive.directive_union.data_array.num_array[i];
+                    gda_insert(t_unit->bmc_data,&bmc_code_i);
                 }
+            }else if (s_struct->asm_directive_and_cpu_inst.asm_directive.d_tag == tag_space || s_struct->asm_directive_and_cpu_inst.asm_directive.d_tag == tag_fill){
+                /* Process space and fill directives, all the words are inserted at once */
+                bmc_code_i = s_struct->asm_directive_and_cpu_inst.asm_directive.directive_union.fill.value;
+                gda_insert_n(t_unit->bmc_data,&bmc_code_i,sizeof(bmc_code_i),s_struct->asm_directive_and_cpu_inst.asm_directive.directive_union.fill.count);
             }
             break;
-        default:
-            break;
+    }
+}
+/**
+@brief Resolves every symbol operand through the ids recorded by the first pass, no names are compared.
+symbol_fixups and symbol_refs are parallel, the k'th operand word is patched with the k'th referenced symbol.
+@param t_unit The translation unit containing the complete symbol table and the encoded bmc_code.
+*/
+static void assembler_resolve_fixups(struct translation_unit * t_unit) {
+    void *const* fixup_it = gda_get_begin_ptr(t_unit->symbol_fixups);
+    void *const* fixup_end = gda_get_end_ptr(t_unit->symbol_fixups);
+    void *const* ref_it = gda_get_begin_ptr(t_unit->symbol_refs);
+    void *const* bmc_code = gda_get_begin_ptr(t_unit->bmc_code);
+    void *const* symbol_ids = gda_get_begin_ptr(t_unit->symbol_ids);
+    struct symbol * f_sym;
+    unsigned int index;
+    for(;fixup_it < fixup_end;fixup_it++,ref_it++) {
+        index = *(unsigned int *)(*fixup_it);
+        f_sym = *(struct symbol **)symbol_ids[*(unsigned int *)(*ref_it)];
+        *(unsigned short *)bmc_code[index] = assembler_encode_symbol_operand(t_unit,f_sym,index);
+    }
+}
+/* What the optimizer does to a line of the .am file. */
+enum optimize_action {
+    optimize_keep,
+    optimize_drop,      /* the line has no effect. */
+    optimize_fold,      /* the line was folded into the constant the line before it moves. */
+    optimize_set        /* the line moves a constant into its destination, it is encoded as mov #value or as clr. */
+};
+/**
+ * @brief The optimizer's plan for a line of the .am file, the second pass applies it.
+ * @param action enum optimize_action.
+ * @param words code words of the line as written.
+ * @param value the constant of optimize_set.
+ */
+struct optimize_line {
+    unsigned char   action;
+    unsigned char   words;
+    short           value;
+};
+/**
+ * @brief The optimizer's plan for a file.
+ * @param lines one per line of the .am file.
+ * @param line_count
+ * @param words_saved code words the plan saves.
+ */
+struct optimize_plan {
+    struct optimize_line   *lines;
+    size_t                  line_count;
+    unsigned long           words_saved;
+};
+/* The operand a constant is moved into, compared to the destination of the lines after it. */
+struct optimize_operand {
+    enum argument_option    tag;
+    int                     reg;
+    const char             *symbol;
+};
+/**
+ * @brief Returns the destination operand of a mov, add, sub or a group B instruction with a single operand.
+ * @param s_struct The parsed instruction.
+ * @param operand Output for the operand, the symbol points into s_struct.
+ * @return 1 if the destination is a register or a symbol, 0 otherwise.
+ */
+static int assembler_optimize_destination(const struct syntax_struct * s_struct,struct optimize_operand * operand) {
+    if(is_i_tag_groupA(s_struct->asm_directive_and_cpu_inst.cpu_inst.i_tag)) {
+        operand->tag    = s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_A.left_and_right_args[1];
+        operand->reg    = s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_A.arg_option[1].register_number;
+        operand->symbol = s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_A.arg_option[1].symbol;
+    }else if(is_i_tag_groupB(s_struct->asm_directive_and_cpu_inst.cpu_inst.i_tag) &&
+             s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.arg_options == tag_1_arg) {
+        operand->tag    = s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.sub_group_b.rest_of_group_b.arg_opt;
+        operand->reg    = s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.sub_group_b.rest_of_group_b.arg_option.register_number;
+        operand->symbol = s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.sub_group_b.rest_of_group_b.arg_option.symbol;
+    }else {
+        return 0;
+    }
+    return operand->tag == tag_arg_tag_register || operand->tag == tag_arg_tag_symbol;
+}
+/**
+ * @brief Checks if two destination operands are the same register or the same symbol.
+ */
+static int assembler_optimize_same(const struct optimize_operand * a,const struct optimize_operand * b) {
+    if(a->tag != b->tag)
+        return 0;
+    return a->tag == tag_arg_tag_register ? a->reg == b->reg : strcmp(a->symbol,b->symbol) == 0;
+}
+/**
+ * @brief Checks if an instruction has no effect: mov of a register to itself, add or sub of #0,
+ * and jmp or bne to the instruction right after it. only cmp sets the zero flag, so none of them change it.
+ * @param t_unit The translation unit with the complete symbol table.
+ * @param s_struct The parsed instruction.
+ * @param next The address of the instruction after it.
+ * @return 1 if it has no effect, 0 otherwise.
+ */
+static int assembler_optimize_no_effect(struct translation_unit * t_unit,const struct syntax_struct * s_struct,unsigned int next) {
+    const struct symbol * target;
+    switch(s_struct->asm_directive_and_cpu_inst.cpu_inst.i_tag) {
+    case tag_mov:
+        return s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_A.left_and_right_args[0] == tag_arg_tag_register &&
+               s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_A.left_and_right_args[1] == tag_arg_tag_register &&
+               s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_A.arg_option[0].register_number ==
+               s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_A.arg_option[1].register_number;
+    case tag_add: case tag_sub:
+        return s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_A.left_and_right_args[0] == tag_arg_tag_constant &&
+               s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_A.arg_option[0].constant_number == 0;
+    case tag_jmp: case tag_bne:
+        if(s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.arg_options != tag_1_arg ||
+           s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.sub_group_b.rest_of_group_b.arg_opt != tag_arg_tag_symbol)
+            return 0;
+        /* planning never adds a symbol, one that is not in the table is not a jump to the next line */
+        target = assembler_find_symbol(t_unit,s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.sub_group_b.rest_of_group_b.arg_option.symbol);
+        return target != NULL && (target->sym_type == sym_type_code || target->sym_type == sym_type_code_entry) && target->addr == next;
+    default:
+        return 0;
+    }
+}
+/**
+ * @brief Checks if an instruction moves a constant into a register or a symbol, mov #constant or clr.
+ * @param s_struct The parsed instruction.
+ * @param value Output for the constant.
+ * @param operand Output for the destination.
+ * @return 1 if it does, 0 otherwise.
+ */
+static int assembler_optimize_sets(const struct syntax_struct * s_struct,int * value,struct optimize_operand * operand) {
+    if(s_struct->asm_directive_and_cpu_inst.cpu_inst.i_tag == tag_clr) {
+        *value = 0;
+        return assembler_optimize_destination(s_struct,operand);
+    }
+    if(s_struct->asm_directive_and_cpu_inst.cpu_inst.i_tag == tag_mov &&
+       s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_A.left_and_right_args[0] == tag_arg_tag_constant) {
+        *value = s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_A.arg_option[0].constant_number;
+        return assembler_optimize_destination(s_struct,operand);
+    }
+    return 0;
+}
+/**
+ * @brief Folds an add, sub, inc or dec of the destination a constant was just moved into, into the constant.
+ * @param s_struct The parsed instruction.
+ * @param operand The destination the constant was moved into.
+ * @param value The constant, updated if the instruction is folded.
+ * @return 1 if it was folded, 0 otherwise.
+ */
+static int assembler_optimize_fold(const struct syntax_struct * s_struct,const struct optimize_operand * operand,int * value) {
+    struct optimize_operand destination = {0};
+    int folded;
+    if(!assembler_optimize_destination(s_struct,&destination) || !assembler_optimize_same(&destination,operand))
+        return 0;
+    switch(s_struct->asm_directive_and_cpu_inst.cpu_inst.i_tag) {
+    case tag_add: case tag_sub:
+        if(s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_A.left_and_right_args[0] != tag_arg_tag_constant)
+            return 0;
+        folded = s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_A.arg_option[0].constant_number;
+        folded = s_struct->asm_directive_and_cpu_inst.cpu_inst.i_tag == tag_add ? *value + folded : *value - folded;
+        break;
+    case tag_inc:
+        folded = *value + 1;
+        break;
+    case tag_dec:
+        folded = *value - 1;
+        break;
+    default:
+        return 0;
+    }
+    /* the sum must still be an immediate operand */
+    if(folded < -(1 << 11) || folded >= (1 << 11))
+        return 0;
+    *value = folded;
+    return 1;
+}
+/**
+ * @brief Rewrites an instruction that moves a constant into its destination as mov #value, or as clr when value is 0.
+ * @param s_struct The parsed instruction, mov #constant or clr.
+ * @param value The constant.
+ */
+static void assembler_optimize_set(struct syntax_struct * s_struct,int value) {
+    struct optimize_operand destination = {0};
+    char symbol[max_symbol_len + 1];
+    assembler_optimize_destination(s_struct,&destination);
+    /* group A and group B share their storage, the destination is copied out first */
+    strcpy(symbol,destination.symbol);
+    if(value == 0) {
+        s_struct->asm_directive_and_cpu_inst.cpu_inst.i_tag = tag_clr;
+        s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.arg_options = tag_1_arg;
+        s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.sub_group_b.rest_of_group_b.arg_opt = destination.tag;
+        if(destination.tag == tag_arg_tag_register)
+            s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.sub_group_b.rest_of_group_b.arg_option.register_number = destination.reg;
+        else
+            strcpy(s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.sub_group_b.rest_of_group_b.arg_option.symbol,symbol);
+    }else {
+        s_struct->asm_directive_and_cpu_inst.cpu_inst.i_tag = tag_mov;
+        s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_A.left_and_right_args[0] = tag_arg_tag_constant;
+        s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_A.arg_option[0].constant_number = value;
+        s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_A.left_and_right_args[1] = destination.tag;
+        if(destination.tag == tag_arg_tag_register)
+            s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_A.arg_option[1].register_number = destination.reg;
+        else
+            strcpy(s_struct->asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_A.arg_option[1].symbol,symbol);
+    }
+}
+/**
+ * @brief Returns the code words the plan of a line saves, a clr that a constant was folded into grows by a word.
+ */
+static int assembler_optimize_saved(const struct optimize_line * line) {
+    switch(line->action) {
+    case optimize_drop: case optimize_fold:
+        return line->words;
+    case optimize_set:
+        return line->words - (line->value == 0 ? 2 : 3);
+    default:
+        return 0;
+    }
+}
+/**
+ * @brief Moves every symbol to its address once the plan is applied.
+ * a code symbol moves back by the words the lines before it saved, and the data, which follows the code, by all of them.
+ * @param t_unit The translation unit with the complete symbol table.
+ * @param plan The plan, its words_saved is set.
+ * @return 0 on success, 1 on allocation failure.
+ */
+static int assembler_optimize_relayout(struct translation_unit * t_unit,struct optimize_plan * plan) {
+    void *const* sym_ids_it_begin;
+    void *const* sym_ids_it_end;
+    struct symbol * in_table;
+    int * saved_before;
+    int saved = 0;
+    unsigned int address = PROG_BASE_ADDR, words;
+    size_t i;
+    /* the words saved before every code address, the code is small enough for a table indexed by address */
+    for(i=0;i<plan->line_count;i++)
+        address += plan->lines[i].words;
+    saved_before = mem_malloc(mem_tag_first_pass,(address - PROG_BASE_ADDR + 1) * sizeof(int));
+    if(!saved_before)
+        return 1;
+    for(address=0,i=0;i<plan->line_count;i++) {
+        for(words=0;words<plan->lines[i].words;words++)
+            saved_before[address++] = saved;
+        saved += assembler_optimize_saved(&plan->lines[i]);
+    }
+    saved_before[address] = saved;
+    gda_for_each(t_unit->symbol_ids,sym_ids_it_begin,sym_ids_it_end) {
+        in_table = *(struct symbol **)(*sym_ids_it_begin);
+        if(in_table->sym_type == sym_type_code || in_table->sym_type == sym_type_code_entry)
+            in_table->addr -= saved_before[in_table->addr - PROG_BASE_ADDR];
+        else if(in_table->sym_type == sym_type_data || in_table->sym_type == sym_type_data_entry)
+            in_table->addr -= saved;
+    }
+    mem_free(saved_before);
+    plan->words_saved = saved;
+    return 0;
+}
+/**
+ * @brief Plans shorter equivalent code for the parsed instruction stream, between the first and the second pass.
+ * a mov #constant or clr followed by add or sub of a constant, inc or dec of the same destination is folded into a single mov,
+ * or into clr when the constant is 0, and instructions that have no effect are dropped.
+ * a folded instruction must not have a label, nothing may jump between it and the constant it is folded into.
+ * a dropped instruction may have a label, it then names the instruction after it.
+ * the symbol table is moved to the addresses of the plan.
+ * @param t_unit The translation unit with the complete symbol table.
+ * @param am_file The contents of the input assembly file.
+ * @param plan Output for the plan, its lines are freed by the caller.
+ * @return 0 on success, 1 on allocation failure.
+ */
+static int assembler_optimize(struct translation_unit * t_unit,source_buffer am_file,struct optimize_plan * plan) {
+    char buffer[max_line_size + 1] = {0};
+    struct syntax_struct s_struct;
+    struct optimize_operand pending_operand = {0};
+    struct optimize_line * grown;
+    str_handle pending_name;
+    const char * cursor = source_buffer_begin(am_file);
+    unsigned int address = PROG_BASE_ADDR, ic_words, dc_words;
+    size_t capacity = 0, pending = 0, last = 0;
+    int value = 0, has_pending = 0;
+    plan->lines = NULL;
+    plan->line_count = 0;
+    plan->words_saved = 0;
+    while(source_buffer_next_line(&cursor,source_buffer_end(am_file),buffer,max_line_size)) {
+        if(plan->line_count == capacity) {
+            grown = mem_realloc(mem_tag_first_pass,plan->lines,(capacity * 2 + 256) * sizeof(struct optimize_line));
+            if(!grown)
+                return 1;
+            plan->lines = grown;
+            capacity = capacity * 2 + 256;
+        }
+        s_struct = lang_engine_create_ss_from_logical_line(buffer);
+        assembler_line_words(&s_struct,&ic_words,&dc_words);
+        plan->lines[plan->line_count].action = optimize_keep;
+        plan->lines[plan->line_count].words  = ic_words;
+        plan->lines[plan->line_count].value  = 0;
+        /* directives do not break a fold, only the code runs */
+        if(s_struct.dir_or_inst_tag == tag_inst) {
+            if(has_pending && s_struct.symbol[0] == '\0' && assembler_optimize_fold(&s_struct,&pending_operand,&value)) {
+                plan->lines[plan->line_count].action = optimize_fold;
+                plan->lines[pending].value = value;
+            }else if(assembler_optimize_no_effect(t_unit,&s_struct,address + ic_words)) {
+                plan->lines[plan->line_count].action = optimize_drop;
+                has_pending = 0;
+            }else {
+                has_pending = assembler_optimize_sets(&s_struct,&value,&pending_operand);
+                /* the destination is compared by name after the buffer is reused, one that is not in the pool is not folded into */
+                if(has_pending && pending_operand.tag == tag_arg_tag_symbol) {
+                    pending_name = str_pool_find(t_unit->names,pending_operand.symbol);
+                    has_pending = pending_name != NULL;
+                    if(has_pending)
+                        pending_operand.symbol = pending_name->string;
+                }
+                if(has_pending) {
+                    pending = plan->line_count;
+                    plan->lines[pending].action = optimize_set;
+                    plan->lines[pending].value  = value;
+                }
+            }
+            last = plan->line_count;
         }
-        line_count++;
+        address += ic_words;
+        plan->line_count++;
     }
-    gda_for_each(symbol_table,sym_table_it_begin,sym_table_it_end) {
-       if(*sym_table_it_begin) {
-        in_table = *sym_table_it_begin;
-        if(in_table->sym_type == sym_type_data || in_table->sym_type == sym_type_data_entry )
-            in_table->addr +=IC;
-       } else if (in_table->sym_type == sym_type_entry) {
-        /* error , it was declared as entry but was never defined in this file....!*/
-        asm_error_printer(file_name,line_count,"symbol : '%s' was declared as '%s' in line %d but was never defined.\n",in_table->symbol_name,sym_type_str[in_table->sym_type],in_table->line_def);
-        error = 1;
-       }
+    /* a label of a dropped instruction names the instruction after it, so the last instruction is kept */
+    if(plan->line_count > 0 && plan->lines[last].action == optimize_drop)
+        plan->lines[last].action = optimize_keep;
+    if(assembler_optimize_relayout(t_unit,plan))
+        return 1;
+    STATS_ADD(stats_words_saved,plan->words_saved);
+    return 0;
+}
+/* a run of equal words at least this long is inserted in a single allocation */
+#define ASSEMBLER_WORD_RUN_MIN 8
+/**
+ * @brief Appends words to bmc_code or bmc_data, a run of equal words, e.g. the words of a .space, is inserted at once.
+ * @param words bmc_code or bmc_data.
+ * @param from The words.
+ * @param count The amount of words.
+ */
+static void assembler_insert_words(gda words,const unsigned short * from,unsigned int count) {
+    unsigned int i, run;
+    for(i=0;i<count;i+=run) {
+        for(run=1;i + run < count && from[i + run] == from[i];run++);
+        if(run < ASSEMBLER_WORD_RUN_MIN)
+            run = 1;
+        if(run == 1)
+            gda_insert(words,&from[i]);
+        else
+            gda_insert_n(words,&from[i],sizeof(unsigned short),run);
     }
-    return error;
+}
+/**
+ * @brief A payload of the data, for the data deduplication. the payload of a .data or .string line may be merged,
+ * the words between them, e.g. a .space, are reserved payloads that are never merged.
+ * @param end one past its last word.
+ * @param offset where the line put it in the data.
+ * @param len
+ * @param host the payload it shares the words of, itself if it keeps its own.
+ * @param new_offset where it is in the deduplicated data.
+ */
+struct dedup_payload {
+    const unsigned short   *end;
+    unsigned int            offset;
+    unsigned int            len;
+    struct dedup_payload   *host;
+    unsigned int            new_offset;
+};
+/**
+ * @brief Orders payloads by their words read from the last one, so a payload comes right before the payloads it is a suffix of.
+ * equal payloads are ordered by descending offset, which makes the first of them the host of the rest.
+ */
+static int dedup_payload_compar(const void * a,const void * b) {
+    const struct dedup_payload * ap = *(struct dedup_payload * const *)a;
+    const struct dedup_payload * bp = *(struct dedup_payload * const *)b;
+    unsigned int i, len = ap->len < bp->len ? ap->len : bp->len;
+    for(i=1;i<=len;i++) {
+        if(ap->end[-(long)i] != bp->end[-(long)i])
+            return ap->end[-(long)i] < bp->end[-(long)i] ? -1 : 1;
+    }
+    if(ap->len != bp->len)
+        return ap->len < bp->len ? -1 : 1;
+    return (ap->offset < bp->offset) - (ap->offset > bp->offset);
+}
+/**
+ * @brief Checks if a payload is a suffix of another.
+ */
+static int dedup_payload_is_suffix(const struct dedup_payload * p,const struct dedup_payload * of) {
+    return p->len <= of->len && memcmp(p->end - p->len,of->end - p->len,p->len * sizeof(unsigned short)) == 0;
+}
+/**
+ * @brief Merges identical data payloads, and payloads that are a suffix of another, e.g. a string that ends another string,
+ * into a single copy that all of their labels point into. the payloads that keep their words stay in source order.
+ * runs once every line is encoded and before the fixups are resolved, so the symbol operands see the merged layout.
+ * the words of .space and .fill are writable buffers, so they are never merged and nothing is merged into them.
+ * neither is a .data or .string line whose label the program writes or exports with .entry, another module may write it.
+ * @param t_unit The translation unit with the encoded bmc_data and the complete symbol table.
+ * @param line_spans The first word, one past the last word and the id of the label plus one, 0 for none, of every .data and .string line, in source order.
+ * @param line_count
+ * @param written Non zero for the id of every symbol an instruction writes to.
+ * @return The amount of data words saved, 0 on allocation failure, the data is then left as it is.
+ */
+static unsigned long assembler_dedup_data(struct translation_unit * t_unit,const unsigned int * line_spans,size_t line_count,const unsigned char * written) {
+    void *const* begin;
+    void *const* end;
+    void *const* sym_ids_it_begin;
+    void *const* sym_ids_it_end;
+    struct symbol * in_table;
+    unsigned int data_base = PROG_BASE_ADDR + gda_size(t_unit->bmc_code), total = gda_size(t_unit->bmc_data), next = 0, i;
+    unsigned short * words = mem_malloc(mem_tag_code,(total + 1) * sizeof(unsigned short));
+    struct dedup_payload * payloads = mem_malloc(mem_tag_code,(2 * line_count + 1) * sizeof(struct dedup_payload));
+    struct dedup_payload ** order = mem_malloc(mem_tag_code,(line_count + 1) * sizeof(struct dedup_payload *));
+    unsigned int * moved = mem_malloc(mem_tag_code,(total + 1) * sizeof(unsigned int));
+    void *const * symbols;
+    unsigned int reserved = 0;
+    size_t m = 0, n = 0, k;
+    gda merged;
+    if(!words || !payloads || !order || !moved) {
+        mem_free(words);
+        mem_free(payloads);
+        mem_free(order);
+        mem_free(moved);
+        return 0;
+    }
+    i = 0;
+    gda_for_each(t_unit->bmc_data,begin,end)
+        words[i++] = *(unsigned short *)*begin;
+    symbols = gda_get_begin_ptr(t_unit->symbol_ids);
+    /* the payloads in data order, the words before a line and after the last one are reserved */
+    for(k=0;k<=line_count;k++) {
+        /* a line the program may write stays in the reserved words around it */
+        if(k < line_count && line_spans[3 * k + 2] != 0 &&
+           (written[line_spans[3 * k + 2] - 1] || (*(struct symbol **)symbols[line_spans[3 * k + 2] - 1])->sym_type == sym_type_data_entry))
+            continue;
+        if((k < line_count ? line_spans[3 * k] : total) > reserved) {
+            payloads[m].offset = reserved;
+            payloads[m].len    = (k < line_count ? line_spans[3 * k] : total) - reserved;
+            payloads[m].end    = words + payloads[m].offset + payloads[m].len;
+            payloads[m].host   = &payloads[m];
+            m++;
+        }
+        if(k < line_count) {
+            payloads[m].offset = line_spans[3 * k];
+            payloads[m].len    = line_spans[3 * k + 1] - line_spans[3 * k];
+            payloads[m].end    = words + line_spans[3 * k + 1];
+            if(payloads[m].len > 0) {
+                order[n++] = &payloads[m];
+                m++;
+            }
+            reserved = line_spans[3 * k + 1];
+        }
+    }
+    qsort(order,n,sizeof(struct dedup_payload *),dedup_payload_compar);
+    /* a payload that is a suffix of the next one is a suffix of every payload up to the longest of them, which hosts them all */
+    for(k=n;k-- > 0;)
+        order[k]->host = k + 1 < n && dedup_payload_is_suffix(order[k],order[k + 1]) ? order[k + 1]->host : order[k];
+    for(k=0;k<m;k++) {
+        if(payloads[k].host == &payloads[k]) {
+            payloads[k].new_offset = next;
+            next += payloads[k].len;
+        }
+    }
+    for(k=0;k<m;k++) {
+        payloads[k].new_offset = payloads[k].host->new_offset + payloads[k].host->len - payloads[k].len;
+        /* a reserved payload may hold several lines, so every word of it is moved */
+        for(i=0;i<(payloads[k].host == &payloads[k] ? payloads[k].len : 1);i++)
+            moved[payloads[k].offset + i] = payloads[k].new_offset + i;
+    }
+    /* a data label is at the start of the payload of its line */
+    gda_for_each(t_unit->symbol_ids,sym_ids_it_begin,sym_ids_it_end) {
+        in_table = *(struct symbol **)(*sym_ids_it_begin);
+        if(in_table->sym_type == sym_type_data || in_table->sym_type == sym_type_data_entry)
+            in_table->addr = data_base + moved[in_table->addr - data_base];
+    }
+    merged = gda_create(bmc_ctor,bmc_dtor,NULL);
+    for(k=0;k<m;k++) {
+        if(payloads[k].host == &payloads[k])
+            assembler_insert_words(merged,&words[payloads[k].offset],payloads[k].len);
+    }
+    gda_destroy(t_unit->bmc_data);
+    t_unit->bmc_data = merged;
+    mem_free(words);
+    mem_free(payloads);
+    mem_free(order);
+    mem_free(moved);
+    return total - next;
 }
 /**
 @brief Performs the second pass of the assembler to generate the binary machine code.
 @param t_unit The translation unit containing the gda symbol table, bmc_code, and bmc_data.
-@param am_file The input assembly file to be processed.
+@param am_file The contents of the input assembly file, the same buffer the first pass read.
 @param file_name The name of the input assembly file for error and warning messages.
-@return Returns 0 if successful, -1 if a syntax error is found, or 1 if other errors are found.
+@param plan The optimizer's plan, applied to every line before it is encoded. NULL encodes the lines as written.
+@param data_words_saved If not NULL, the data payloads are deduplicated and it is incremented by the data words saved.
+@return Returns 0 if successful, or 1 if a reference or the bookkeeping of the deduplication could not be allocated.
 */
-static int assembler_second_pass(struct translation_unit * t_unit, FILE * am_file,const char * file_name) {
+static int assembler_second_pass(struct translation_unit * t_unit, source_buffer am_file,const char * file_name,const struct optimize_plan * plan,unsigned long * data_words_saved) {
     /* Initialize local variables */
     char buffer[max_line_size + 1] = {0};
     struct syntax_struct s_struct;
-     struct extern_call e_call_dummy = {0};
-    struct extern_call *e_call_find = NULL;
-    unsigned short temp;
-    struct symbol * f_sym;
-    unsigned short bmc_code_i = 0;
-    int line_counter = 1;
-    char *it;
-    int i, error =0;
+    const char * cursor = source_buffer_begin(am_file);
+    const char * operands[3];
+    int operand_count, i;
+    size_t line = 0, data_lines = 0, data_capacity = 0, symbol_count = gda_size(t_unit->symbol_ids);
+    unsigned int * data_spans = NULL, * grown, data_start;
+    unsigned char * written = NULL;
+    const char * written_name;
+    struct symbol * label;
+    unsigned long saved;
+    int error = 0;
+    /* the symbol operands of the dropped lines are gone, so the references are recorded again in the order they are encoded */
+    if(plan)
+        gda_clear(t_unit->symbol_refs);
+    /* the symbols the program writes, their data is not merged */
+    if(data_words_saved) {
+        written = mem_calloc(mem_tag_code,symbol_count + 1,sizeof(unsigned char));
+        if(!written) {
+            asm_error_printer(t_unit->diagnostics,file_name,0,"could not allocate the written symbols of the data deduplication.\n");
+            data_words_saved = NULL;
+            error = 1;
+        }
+    }
     /*Iterate through each line of the input assembly file*/
-    while(fgets(buffer,max_line_size,am_file)) {
+    while(source_buffer_next_line(&cursor,source_buffer_end(am_file),buffer,max_line_size)) {
         /* Parse the current line and store the result in a syntax_struct */
         s_struct = lang_engine_create_ss_from_logical_line(buffer);
-        /* Process the line based on the tag (directive, instruction, or syntax error/null line) */
-        switch (s_struct.dir_or_inst_tag) {
-            /*Ignore syntax errors or null lines*/
-            case tag_syntax_error: case tag_line_null:
-            break;
-            /* Handle an assembly instruction */
-            case tag_inst:
-                bmc_code_i = s_struct.asm_directive_and_cpu_inst.cpu_inst.i_tag << 6;
-                /* Check if the instruction belongs to group A */
-                if(is_i_tag_groupA(s_struct.asm_directive_and_cpu_inst.cpu_inst.i_tag)) {
-                    bmc_code_i |= s_struct.asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_A.left_and_right_args[0] << 4;
-                    bmc_code_i |= s_struct.asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_A.left_and_right_args[1] << 2;
-                    gda_insert(t_unit->bmc_code,&bmc_code_i);
-                    if(s_struct.asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_A.left_and_right_args[0] == tag_arg_tag_register && 
-                        s_struct.asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_A.left_and_right_args[1] == tag_arg_tag_register) {
-                            bmc_code_i = (s_struct.asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_A.arg_option[0].register_number << 8) |
-                             (s_struct.asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_A.arg_option[1].register_number << 2);
-                             gda_insert(t_unit->bmc_code,&bmc_code_i);
-                        }else {
-                            for(i=0;i<2;i++) {
-                                switch (s_struct.asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_A.left_and_right_args[i])
-                                {
-                                case tag_arg_tag_register:
-                                    bmc_code_i = s_struct.asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_A.arg_option[i].register_number << (8 - (i * 6));
-                                    break;
-                                case tag_arg_tag_constant:
-                                    bmc_code_i = s_struct.asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_A.arg_option[i].constant_number << 2;
-                                    break;
-                                case tag_arg_tag_symbol:
-                                    f_sym = gda_search(t_unit->symbol_table,s_struct.asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_A.arg_option[i].symbol);
-                                    if(f_sym == NULL) {
-                                        /* error couldn't find the symbol in the sym table...*/
-                                        asm_error_printer(file_name,line_counter,"undefined symbol: '%s'.",s_struct.asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_A.arg_option[i].symbol);
-                                        error =1;
-                                    }else {
-                                        if(f_sym->sym_type == sym_type_extern) {
-                                            bmc_code_i = 1;
-                                            strcpy(e_call_dummy.symbol_name,f_sym->symbol_name);
-                                            e_call_find = gda_search(t_unit->extern_usage,&e_call_dummy);
-                                            temp = gda_size(t_unit->bmc_code) + PROG_BASE_ADDR;
-                                            if(e_call_find) {
-                                                gda_insert(e_call_find->addresses,&temp);
-                                            }else {
-                                                e_call_dummy.addresses = gda_create(bmc_ctor,bmc_dtor,NULL);
-                                                gda_insert(e_call_dummy.addresses,&temp);
-                                                gda_insert(t_unit->extern_usage,&e_call_dummy);
-                                            }
-                                        }else {
-                                            bmc_code_i = (f_sym->addr << 2) | 2;
-                                        }
-                                    }
-                                    break;
-                                default:
-                                    break;
-                                }
-                                gda_insert(t_unit->bmc_code,&bmc_code_i);
-                            }
-                            
-                        }
-                }
-                 /* Process group B instructions */
-                else if(is_i_tag_groupB(s_struct.asm_directive_and_cpu_inst.cpu_inst.i_tag)) {
-                    if(s_struct.asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.arg_options == tag_arg_2_args_with_symbol) {
-                        bmc_code_i |= (2 << 2);
-                        bmc_code_i |= s_struct.asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.sub_group_b.arg_2_symbol.left_and_right_args[0] << 12;
-                        bmc_code_i |= s_struct.asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.sub_group_b.arg_2_symbol.left_and_right_args[1] << 10;
-                        gda_insert(t_unit->bmc_code,&bmc_code_i);
-                        f_sym = gda_search(t_unit->symbol_table,s_struct.asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.sub_group_b.arg_2_symbol.symbol);
-                        if(f_sym) {
-                            if(f_sym->sym_type == sym_type_extern) {
-                                bmc_code_i = 1;
-                                            strcpy(e_call_dummy.symbol_name,f_sym->symbol_name);
-                                            e_call_find = gda_search(t_unit->extern_usage,&e_call_dummy);
-                                            temp = gda_size(t_unit->bmc_code) + PROG_BASE_ADDR;
-                                            if(e_call_find) {
-                                                gda_insert(e_call_find->addresses,&temp);
-                                            }else {
-                                                e_call_dummy.addresses = gda_create(bmc_ctor,bmc_dtor,NULL);
-                                                gda_insert(e_call_dummy.addresses,&temp);
-                                                gda_insert(t_unit->extern_usage,&e_call_dummy);
-                                            }
-                            }else {
-                                bmc_code_i = (f_sym->addr <<2) | 2;
-                            }
-                            gda_insert(t_unit->bmc_code,&bmc_code_i);
-                        }else {
-                            /* error couldn't find the symbol in the sym table...*/
-                            asm_error_printer(file_name,line_counter,"undefined symbol: '%s'.\n",s_struct.asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.sub_group_b.arg_2_symbol.symbol);
-                            error = 1;
-                        }
-                        if(s_struct.asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.sub_group_b.arg_2_symbol.left_and_right_args[0] == tag_arg_tag_register &&
-                            s_struct.asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.sub_group_b.arg_2_symbol.left_and_right_args[1] == tag_arg_tag_register) {
-                                bmc_code_i = s_struct.asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.sub_group_b.arg_2_symbol.arg_2_args_options[0].register_number << 8 |
-                                            s_struct.asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.sub_group_b.arg_2_symbol.arg_2_args_options[1].register_number << 2;
-                                gda_insert(t_unit->bmc_code,&bmc_code_i);
-                            }
-                        else {
-                            for(i=0;i<2;i++) {
-                                switch (s_struct.asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.sub_group_b.arg_2_symbol.left_and_right_args[i])
-                                {
-                                case tag_arg_tag_register:
-                                    bmc_code_i = s_struct.asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.sub_group_b.arg_2_symbol.arg_2_args_options[i].register_number<< (8 - (i * 6));
-                                    break;
-                                case tag_arg_tag_constant:
-                                    bmc_code_i = s_struct.asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.sub_group_b.arg_2_symbol.arg_2_args_options[i].constant_number << 2;
-                                    break;
-                                case tag_arg_tag_symbol:
-                                    f_sym = gda_search(t_unit->symbol_table,s_struct.asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.sub_group_b.arg_2_symbol.arg_2_args_options[i].symbol);
-                                    if(f_sym) {
-                                        if(f_sym->sym_type == sym_type_extern) {
-                                            bmc_code_i = 1;
-                                            strcpy(e_call_dummy.symbol_name,f_sym->symbol_name);
-                                            e_call_find = gda_search(t_unit->extern_usage,&e_call_dummy);
-                                            temp = gda_size(t_unit->bmc_code) + PROG_BASE_ADDR;
-                                            if(e_call_find) {
-                                                gda_insert(e_call_find->addresses,&temp);
-                                            }else {
-                                                e_call_dummy.addresses = gda_create(bmc_ctor,bmc_dtor,NULL);
-                                                gda_insert(e_call_dummy.addresses,&temp);
-                                                gda_insert(t_unit->extern_usage,&e_call_dummy);
-                                            }
-                                        }else {
-                                            bmc_code_i = (f_sym->addr << 2) | 2;
-                                        }
-
-                                        
-                                    }else {
-                                        /* error couldn't find the symbol in the sym table...*/
-                                        asm_error_printer(file_name,line_counter,"undefined symbol: '%s'.\n",s_struct.asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.sub_group_b.arg_2_symbol.arg_2_args_options[i].symbol);
-                                        error = 1;
-                                    }
-                                    break;
-                                default:
-                                    break;
-                                }
-                                gda_insert(t_unit->bmc_code,&bmc_code_i);
-                            }
-                        }
-                    }else {
-                        bmc_code_i |= (s_struct.asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.sub_group_b.rest_of_group_b.arg_opt << 2);
-                        gda_insert(t_unit->bmc_code,&bmc_code_i);
-                        switch (s_struct.asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.sub_group_b.rest_of_group_b.arg_opt)
-                        {
-                        case tag_arg_tag_register:
-                             bmc_code_i = s_struct.asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.sub_group_b.rest_of_group_b.arg_option.register_number << (8 - (i * 6));
-                            break;
-                        case tag_arg_tag_constant:
-                            bmc_code_i = s_struct.asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.sub_group_b.rest_of_group_b.arg_option.constant_number << 2;
-                            break;
-                        case tag_arg_tag_symbol:
-                         f_sym = gda_search(t_unit->symbol_table,s_struct.asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.sub_group_b.rest_of_group_b.arg_option.symbol);
-                            if(f_sym == NULL) {
-                                        /* error couldn't find the symbol in the sym table...*/
-                                asm_error_printer(file_name,line_counter,"undefined symbol: '%s'.\n",s_struct.asm_directive_and_cpu_inst.cpu_inst.inst_arguments.group_B.sub_group_b.rest_of_group_b.arg_option.symbol);
-                                error = 1;
-                            }else {
-                                if(f_sym->sym_type == sym_type_extern) {
-                                bmc_code_i = 1;
-                                            strcpy(e_call_dummy.symbol_name,f_sym->symbol_name);
-                                            e_call_find = gda_search(t_unit->extern_usage,&e_call_dummy);
-                                            temp = gda_size(t_unit->bmc_code) + PROG_BASE_ADDR;
-                                            if(e_call_find) {
-                                                gda_insert(e_call_find->addresses,&temp);
-                                            }else {
-                                                e_call_dummy.addresses = gda_create(bmc_ctor,bmc_dtor,NULL);
-                                                gda_insert(e_call_dummy.addresses,&temp);
-                                                gda_insert(t_unit->extern_usage,&e_call_dummy);
-                                            }
-                                }else {
-                                    bmc_code_i = (f_sym->addr << 2) | 2;
-                                }
-                                
-                            }
-                            break;
-                     }
-                     gda_insert(t_unit->bmc_code,&bmc_code_i);
-                    }
-                }else {
-                    gda_insert(t_unit->bmc_code,&bmc_code_i);
-                }
+        if(plan) {
+            switch(plan->lines[line++].action) {
+            case optimize_drop: case optimize_fold:
+                continue;
+            case optimize_set:
+                assembler_optimize_set(&s_struct,plan->lines[line - 1].value);
                 break;
-            case tag_dir:
-            /* Handle an assembly directive */
-                if(s_struct.asm_directive_and_cpu_inst.asm_directive.d_tag == tag_string) {
-                    for(it =s_struct.asm_directive_and_cpu_inst.asm_directive.directive_union.string;*it;it++) {
-                        bmc_code_i = *it;
-                        gda_insert(t_unit->bmc_data,&bmc_code_i);
-                    }
-                    bmc_code_i = 0;
-                    gda_insert(t_unit->bmc_data,&bmc_code_i);
-                }else if (s_struct.asm_directive_and_cpu_inst.asm_directive.d_tag == tag_data){
-                    /* Process data directive */
-                    for(i=0;i<s_struct.asm_directive_and_cpu_inst.asm_directive.directive_union.data_array.num_count;i++) {
-                        bmc_code_i =s_struct.asm_directive_and_cpu_inst.asm_directive.directive_union.data_array.num_array[i];
-                        gda_insert(t_unit->bmc_data,&bmc_code_i);
+            }
+            if(s_struct.dir_or_inst_tag == tag_inst) {
+                operand_count = assembler_get_symbol_operands(&s_struct,operands);
+                for(i=0;i<operand_count;i++) {
+                    /* every symbol operand was added to the table by the first pass */
+                    label = assembler_find_symbol(t_unit,operands[i]);
+                    if(label == NULL || gda_insert(t_unit->symbol_refs,&label->id) == NULL) {
+                        asm_error_printer(t_unit->diagnostics,file_name,(int)line,"could not record the reference to '%s'.\n",operands[i]);
+                        error = 1;
                     }
                 }
-                break;
+            }
+        }
+        if(data_words_saved && s_struct.dir_or_inst_tag == tag_inst && (written_name = assembler_get_written_symbol(&s_struct)) != NULL &&
+           (label = assembler_find_symbol(t_unit,written_name)) != NULL && label->id < symbol_count)
+            written[label->id] = 1;
+        data_start = gda_size(t_unit->bmc_data);
+        assembler_encode_line(t_unit,&s_struct);
+        /* only .data and .string payloads are merged, .space and .fill reserve buffers a program writes */
+        if(data_words_saved && s_struct.dir_or_inst_tag == tag_dir &&
+           (s_struct.asm_directive_and_cpu_inst.asm_directive.d_tag == tag_data || s_struct.asm_directive_and_cpu_inst.asm_directive.d_tag == tag_string)) {
+            if(data_lines == data_capacity) {
+                grown = mem_realloc(mem_tag_code,data_spans,(data_capacity * 2 + 256) * 3 * sizeof(unsigned int));
+                if(!grown) {
+                    asm_error_printer(t_unit->diagnostics,file_name,0,"could not allocate the data spans of the data deduplication.\n");
+                    data_words_saved = NULL;
+                    error = 1;
+                    continue;
+                }
+                data_spans = grown;
+                data_capacity = data_capacity * 2 + 256;
+            }
+            label = s_struct.symbol[0] ? assembler_find_symbol(t_unit,s_struct.symbol) : NULL;
+            data_spans[3 * data_lines]     = data_start;
+            data_spans[3 * data_lines + 1] = gda_size(t_unit->bmc_data);
+            data_spans[3 * data_lines + 2] = label ? label->id + 1 : 0;
+            data_lines++;
         }
-        /*Increment the line counter */
-        line_counter++;
     }
+    if(data_words_saved) {
+        saved = assembler_dedup_data(t_unit,data_spans,data_lines,written);
+        *data_words_saved += saved;
+        STATS_ADD(stats_words_saved,saved);
+    }
+    mem_free(data_spans);
+    mem_free(written);
+    /* a reference that was not recorded leaves symbol_refs shorter than symbol_fixups */
+    if(!error)
+        assembler_resolve_fixups(t_unit);
     /*Return any errors encountered during the second pass*/
     return error;
 }
-int assemble( char **files,int file_count) {
+/* A block of .am text, handed from pre-asm to the parser. */
+struct pipeline_block {
+    size_t  len;
+    char    text[PIPELINE_BLOCK_SIZE];
+};
+/* A batch of parsed lines, handed from the parser to the encoder. */
+struct pipeline_batch {
+    int                     count;
+    struct syntax_struct    lines[PIPELINE_BATCH_LINES];
+};
+/**
+ * @brief The state shared by the stages of a pipelined assembly of one file.
+ * @param t_unit the translation unit, the encoder owns bmc_code, bmc_data and symbol_fixups until it is joined.
+ * @param text_ring blocks of .am text, pre-asm to the parser, NULL ends the stream.
+ * @param line_ring batches of parsed lines, the parser to the encoder, NULL ends the stream.
+ * @param block the block being filled by pre-asm.
+ * @param chunk the symbol table events of the whole file, owned by the parser until it is joined.
+ * @param text_lost set by pre-asm if a block could not be allocated and expanded text was dropped.
+ * @param lines_lost set by the parser if a batch could not be allocated and a parsed line was dropped.
+ */
+struct pipeline {
+    struct translation_unit    *t_unit;
+    spsc_ring                   text_ring;
+    spsc_ring                   line_ring;
+    struct pipeline_block      *block;
+    struct first_pass_chunk     chunk;
+    int                         text_lost;
+    int                         lines_lost;
+};
+/**
+ * @brief The pre-asm sink, copies expanded text into blocks and hands every full block to the parser.
+ * @param context Pointer to the struct pipeline.
+ * @param text The expanded text.
+ */
+static void assembler_pipeline_sink(void * context,const char * text) {
+    struct pipeline * pl = context;
+    size_t len = strlen(text);
+    size_t n;
+    while(len > 0) {
+        if(pl->block == NULL) {
+            pl->block = mem_malloc(mem_tag_first_pass,sizeof(struct pipeline_block));
+            if(pl->block == NULL) {
+                pl->text_lost = 1;
+                return;
+            }
+            pl->block->len = 0;
+        }
+        n = PIPELINE_BLOCK_SIZE - pl->block->len;
+        if(n > len)
+            n = len;
+        memcpy(pl->block->text + pl->block->len,text,n);
+        pl->block->len += n;
+        text += n;
+        len  -= n;
+        if(pl->block->len == PIPELINE_BLOCK_SIZE) {
+            spsc_ring_push(pl->text_ring,pl->block);
+            pl->block = NULL;
+        }
+    }
+}
+/**
+ * @brief Parses a logical line of the stream, and hands it to the encoder if it emits words.
+ * @param pl The pipeline.
+ * @param line The logical line.
+ * @param batch The batch being filled, NULL if there is none.
+ * @return The batch being filled after the line.
+ */
+static struct pipeline_batch * assembler_pipeline_parse_line(struct pipeline * pl,char * line,struct pipeline_batch * batch) {
+    struct syntax_struct s_struct;
+    /* the line is in a block that is freed once it is parsed, the texts of its events are copied */
+    assembler_first_pass_parse_line(&pl->chunk,line,NULL,&s_struct);
+    if(s_struct.dir_or_inst_tag != tag_inst && s_struct.dir_or_inst_tag != tag_dir)
+        return batch;
+    if(batch == NULL) {
+        batch = mem_malloc(mem_tag_first_pass,sizeof(struct pipeline_batch));
+        if(batch == NULL) {
+            pl->lines_lost = 1;
+            return NULL;
+        }
+        batch->count = 0;
+    }
+    batch->lines[batch->count++] = s_struct;
+    if(batch->count == PIPELINE_BATCH_LINES) {
+        spsc_ring_push(pl->line_ring,batch);
+        batch = NULL;
+    }
+    return batch;
+}
+/**
+ * @brief The parser stage, splits the text stream into logical lines the way fgets(buffer,max_line_size,...) does.
+ * @param arg Pointer to the struct pipeline.
+ * @return NULL
+ */
+static void * assembler_pipeline_parser(void * arg) {
+    struct pipeline * pl = arg;
+    struct pipeline_block * block;
+    struct pipeline_batch * batch = NULL;
+    char buffer[max_line_size + 1] = {0};
+    size_t len = 0;
+    size_t i;
+    TRACE_THREAD("pipeline parser");
+    TRACE_BEGIN("parse",NULL);
+    while((block = spsc_ring_pop(pl->text_ring)) != NULL) {
+        for(i=0;i<block->len;i++) {
+            buffer[len++] = block->text[i];
+            /* a line ends at a new line or when the buffer is full, the rest is the next line */
+            if(block->text[i] == '\n' || len == max_line_size - 1) {
+                buffer[len] = '\0';
+                batch = assembler_pipeline_parse_line(pl,buffer,batch);
+                len = 0;
+            }
+        }
+        mem_free(block);
+    }
+    if(len > 0) {
+        buffer[len] = '\0';
+        batch = assembler_pipeline_parse_line(pl,buffer,batch);
+    }
+    if(batch)
+        spsc_ring_push(pl->line_ring,batch);
+    spsc_ring_push(pl->line_ring,NULL);
+    TRACE_END();
+    TRACE_RELEASE();
+    STATS_FLUSH();
+    return NULL;
+}
+/**
+ * @brief The encoder stage.
+ * @param arg Pointer to the struct pipeline.
+ * @return NULL
+ */
+static void * assembler_pipeline_encoder(void * arg) {
+    struct pipeline * pl = arg;
+    struct pipeline_batch * batch;
     int i;
-    const char *am_file_name;
-    struct translation_unit t_unit;
-    FILE * am_file;
-    for(i=0;i<file_count;i++) {
-        am_file_name = asm_pre_asm(files[i]);
-        if(!am_file_name ) /* failed to macro parsed .. do what ever...*/ {
+    TRACE_THREAD("pipeline encoder");
+    TRACE_BEGIN("encode",NULL);
+    while((batch = spsc_ring_pop(pl->line_ring)) != NULL) {
+        for(i=0;i<batch->count;i++)
+            assembler_encode_line(pl->t_unit,&batch->lines[i]);
+        mem_free(batch);
+    }
+    TRACE_END();
+    TRACE_RELEASE();
+    STATS_FLUSH();
+    return NULL;
+}
+/**
+ * @brief Assembles one file with pre-asm, parsing and encoding running concurrently as a pipeline.
+ * pre-asm runs on the calling thread and streams the expanded text to a parser thread, which streams the parsed lines
+ * to an encoder thread. symbol operands are encoded as fixups, so the only barrier is after the last line:
+ * the symbol table events are applied, the fixups are resolved and the output files are written.
+ * the .am file is still written by pre-asm, unless in_memory is set.
+ * @param t_unit The translation unit of the file.
+ * @param base_name The base name of the file.
+ * @param includes The include cache of the run, may be NULL.
+ * @param in_memory Non zero writes neither the .am file nor the output files.
+ * @return -1 if the pipeline could not be started (nothing was done), 1 if the file has errors, 0 otherwise.
+ */
+static int assembler_assemble_pipelined(struct translation_unit * t_unit,const char * base_name,pre_asm_includes includes,int in_memory) {
+    struct pipeline pl = {0};
+    pthread_t parser, encoder;
+    const char * am_file_name;
+    char * file_name;
+    int line_count = 1;
+    unsigned int IC = PROG_BASE_ADDR,DC = 0;
+    int started = 0;
+    int error = 0;
 
+    pl.t_unit       = t_unit;
+    pl.text_ring    = spsc_ring_create(PIPELINE_RING_SIZE);
+    pl.line_ring    = spsc_ring_create(PIPELINE_RING_SIZE);
+    file_name       = mem_malloc(mem_tag_files,strlen(base_name) + 4);
+    if(pl.text_ring && pl.line_ring && file_name) {
+        strcat(strcpy(file_name,base_name),".am");
+        if(pthread_create(&encoder,NULL,assembler_pipeline_encoder,&pl) == 0) {
+            started = pthread_create(&parser,NULL,assembler_pipeline_parser,&pl) == 0;
+            if(!started) {
+                spsc_ring_push(pl.line_ring,NULL);
+                pthread_join(encoder,NULL);
+            }
+        }
+    }
+    if(!started) {
+        if(pl.text_ring)
+            spsc_ring_destroy(pl.text_ring);
+        if(pl.line_ring)
+            spsc_ring_destroy(pl.line_ring);
+        mem_free(file_name);
+        return -1;
+    }
+    /* the stages overlap, pre-asm is timed until the last stage is joined */
+    ASSEMBLER_PHASE(t_unit,stats_phase_pre_asm,"pre-asm",
+        am_file_name = in_memory ? asm_pre_asm_to_memory(base_name,t_unit->names,includes,assembler_pipeline_sink,&pl)
+                                 : asm_pre_asm_with_includes(base_name,t_unit->names,includes,assembler_pipeline_sink,&pl);
+        if(pl.block)
+            spsc_ring_push(pl.text_ring,pl.block);
+        spsc_ring_push(pl.text_ring,NULL);
+        pthread_join(parser,NULL);
+        pthread_join(encoder,NULL));
+    if(!am_file_name) {
+        error = 1;
+    }else {
+        if(pl.text_lost || pl.lines_lost) {
+            /* the events and the words are of a file with lines missing */
+            asm_error_printer(t_unit->diagnostics,file_name,0,"could not allocate the pipeline %s.\n",pl.text_lost ? "text blocks" : "line batches");
+            error = 1;
         }else {
-            am_file = fopen(am_file_name,"r");
-            if(!am_file) {
+            ASSEMBLER_PHASE(t_unit,stats_phase_first_pass,"first pass",
+                error |= assembler_first_pass_apply_chunk(t_unit,&pl.chunk,&line_count,&IC,&DC,file_name);
+                error |= assembler_first_pass_finish(t_unit,IC,file_name));
+        }
+        if(error == 0) {
+            ASSEMBLER_PHASE(t_unit,stats_phase_second_pass,"second pass",assembler_resolve_fixups(t_unit));
+            if(!in_memory)
+                ASSEMBLER_PHASE(t_unit,stats_phase_output,"output",out_print_translation_unit(t_unit,base_name));
+        }
+        mem_free((void*)am_file_name);
+    }
+    first_pass_events_free(&pl.chunk.events);
+    spsc_ring_destroy(pl.text_ring);
+    spsc_ring_destroy(pl.line_ring);
+    mem_free(file_name);
+    return error;
+}
+/**
+ * @brief What an incremental run keeps of a single line of the .am file.
+ * @param hash two independent hashes of the line text.
+ * @param ic_words the amount of code words of the line.
+ * @param dc_words the amount of data words of the line.
+ * @param first_event index of the first symbol table event of the line in the events of the state.
+ * @param event_count the amount of events of the line.
+ * @param first_ref index of the first symbol operand of the line in the refs of the state.
+ * @param ref_count the amount of symbol operands of the line.
+ * @param code_start index of the first code word of the line.
+ * @param data_start index of the first data word of the line.
+ */
+struct incremental_line {
+    unsigned long   hash[2];
+    unsigned int    ic_words;
+    unsigned int    dc_words;
+    unsigned int    first_event;
+    unsigned int    event_count;
+    unsigned int    first_ref;
+    unsigned int    ref_count;
+    unsigned int    code_start;
+    unsigned int    data_start;
+};
+/**
+ * @brief The state an incremental run keeps of a file, between runs.
+ * @param lines one per line of the .am file.
+ * @param line_count the amount of lines.
+ * @param events the events of every line in order, a loaded state owns copies of their texts.
+ * @param refs array of unsigned ints, the offset of every symbol operand word from the first code word of its line.
+ * @param code the code words.
+ * @param code_count the amount of code words.
+ * @param data the data words.
+ * @param data_count the amount of data words.
+ * @param ob_key the hash of the .ob file written together with the state.
+ */
+struct incremental_state {
+    struct incremental_line    *lines;
+    unsigned int                line_count;
+    struct first_pass_events    events;
+    gda                         refs;
+    unsigned short             *code;
+    unsigned int                code_count;
+    unsigned short             *data;
+    unsigned int                data_count;
+    char                        ob_key[BUILD_CACHE_KEY_LEN + 1];
+};
+/**
+ * @brief Hashes the text of a line with two independent FNV-1a lanes.
+ * @param line The line.
+ * @param hash Output for the two hashes.
+ */
+static void assembler_incremental_hash(const char * line,unsigned long hash[2]) {
+    hash[0] = 2166136261UL;
+    hash[1] = 2166136261UL ^ 0x5bd1e995UL;
+    for(;*line;line++) {
+        hash[0] = ((hash[0] ^ (unsigned char)*line) * 16777619UL) & 0xffffffffUL;
+        hash[1] = ((hash[1] ^ (unsigned char)*line) * 2246822519UL) & 0xffffffffUL;
+    }
+}
+/**
+ * @brief Creates an empty incremental state.
+ * @param state The state.
+ */
+static void assembler_incremental_init(struct incremental_state * state) {
+    memset(state,0,sizeof(struct incremental_state));
+    state->refs   = gda_create(symbol_ref_ctor,symbol_table_dtor,NULL);
+}
+/**
+ * @brief Destroys an incremental state.
+ * @param state The state.
+ */
+static void assembler_incremental_free(struct incremental_state * state) {
+    first_pass_events_free(&state->events);
+    gda_destroy(state->refs);
+    mem_free(state->lines);
+    mem_free(state->code);
+    mem_free(state->data);
+}
+/**
+ * @brief Loads the incremental state a previous run saved.
+ * @param state An empty state, left empty if the file is missing or invalid.
+ * @param file_name The name of the state file.
+ * @return 0 if the state was loaded, -1 otherwise.
+ */
+static int assembler_incremental_load(struct incremental_state * state,const char * file_name) {
+    /* every token of the file is a symbol name or a number, all shorter than a line */
+    char token[max_line_size + 1];
+    struct first_pass_event ev = {0};
+    struct incremental_line * line;
+    unsigned int i, k, ref, code_count = 0, data_count = 0;
+    int kind, valid;
+    FILE * file = fopen(file_name,"r");
+    if(!file)
+        return -1;
+    valid = fscanf(file,"%85s",token) == 1 && strcmp(token,INCREMENTAL_MAGIC) == 0 &&
+            fscanf(file,"%85s",token) == 1 && strcmp(token,ASSEMBLER_VERSION) == 0 &&
+            fscanf(file,"%32s %u %u %u",state->ob_key,&state->line_count,&state->code_count,&state->data_count) == 4;
+    if(valid) {
+        state->lines = mem_calloc(mem_tag_incremental,state->line_count + 1,sizeof(struct incremental_line));
+        state->code  = mem_calloc(mem_tag_incremental,state->code_count + 1,sizeof(unsigned short));
+        state->data  = mem_calloc(mem_tag_incremental,state->data_count + 1,sizeof(unsigned short));
+        valid = state->lines && state->code && state->data;
+    }
+    for(i=0;valid && i<state->line_count;i++) {
+        line = &state->lines[i];
+        valid = fscanf(file,"%lx %lx %u %u %u %u",&line->hash[0],&line->hash[1],&line->ic_words,&line->dc_words,&line->event_count,&line->ref_count) == 6;
+        line->code_start  = code_count;
+        line->data_start  = data_count;
+        line->first_event = state->events.count;
+        line->first_ref   = gda_size(state->refs);
+        code_count += line->ic_words;
+        data_count += line->dc_words;
+        for(k=0;valid && k<line->event_count;k++) {
+            valid = fscanf(file,"%d %85s",&kind,token) == 2 && kind > ev_syntax_error && kind <= ev_reference;
+            ev.kind = kind;
+            ev.len  = strcmp(token,"-") == 0 ? 0 : (unsigned int)strlen(token);
+            ev.text = ev.len ? first_pass_events_copy_text(&state->events,token,ev.len) : NULL;
+            valid = valid && first_pass_events_add(&state->events,&ev) == 0;
+        }
+        for(k=0;valid && k<line->ref_count;k++) {
+            valid = fscanf(file,"%u",&ref) == 1 && ref < line->ic_words;
+            if(valid)
+                gda_insert(state->refs,&ref);
+        }
+    }
+    valid = valid && code_count == state->code_count && data_count == state->data_count;
+    for(i=0;valid && i<state->code_count;i++)
+        valid = fscanf(file,"%hu",&state->code[i]) == 1;
+    for(i=0;valid && i<state->data_count;i++)
+        valid = fscanf(file,"%hu",&state->data[i]) == 1;
+    fclose(file);
+    if(!valid) {
+        assembler_incremental_free(state);
+        assembler_incremental_init(state);
+        return -1;
+    }
+    return 0;
+}
+/**
+ * @brief Saves the incremental state of an assembled file.
+ * @param state The lines and events of the file, its symbol operands are the fixups of t_unit.
+ * @param t_unit The translation unit of the file.
+ * @param file_name The name of the state file.
+ */
+static void assembler_incremental_save(const struct incremental_state * state,const struct translation_unit * t_unit,const char * file_name) {
+    void *const* fixups = gda_get_begin_ptr(t_unit->symbol_fixups);
+    void *const* begin;
+    void *const* end;
+    const struct incremental_line * line;
+    const struct first_pass_event * ev;
+    unsigned int i, k;
+    FILE * file = fopen(file_name,"w");
+    if(!file)
+        return;
+    fprintf(file,"%s %s\n%s %u %lu %lu\n",INCREMENTAL_MAGIC,ASSEMBLER_VERSION,state->ob_key,state->line_count,
+        (unsigned long)gda_size(t_unit->bmc_code),(unsigned long)gda_size(t_unit->bmc_data));
+    for(i=0;i<state->line_count;i++) {
+        line = &state->lines[i];
+        fprintf(file,"%lx %lx %u %u %u %u",line->hash[0],line->hash[1],line->ic_words,line->dc_words,line->event_count,line->ref_count);
+        for(k=0;k<line->event_count;k++) {
+            ev = &state->events.items[line->first_event + k];
+            if(ev->len)
+                fprintf(file," %d %.*s",(int)ev->kind,(int)ev->len,ev->text);
+            else
+                fprintf(file," %d -",(int)ev->kind);
+        }
+        for(k=0;k<line->ref_count;k++)
+            fprintf(file," %u",*(unsigned int *)fixups[line->first_ref + k] - line->code_start);
+        fprintf(file,"\n");
+    }
+    gda_for_each(t_unit->bmc_code,begin,end) {
+        fprintf(file,"%hu\n",*(unsigned short *)*begin);
+    }
+    gda_for_each(t_unit->bmc_data,begin,end) {
+        fprintf(file,"%hu\n",*(unsigned short *)*begin);
+    }
+    fclose(file);
+}
+/**
+ * @brief Copies an unchanged line from the previous state, with its events, words and symbol operands.
+ * @param t_unit The translation unit the words and fixups are added to.
+ * @param events The events of the new state, the events are added to it, their texts stay in the previous state.
+ * @param old The previous state.
+ * @param line The line in the new state.
+ * @param old_line The same line in the previous state.
+ */
+static void assembler_incremental_copy_line(struct translation_unit * t_unit,struct first_pass_events * events,const struct incremental_state * old,struct incremental_line * line,const struct incremental_line * old_line) {
+    void *const* refs = gda_get_begin_ptr(old->refs);
+    unsigned int k, index;
+    for(k=0;k<old_line->event_count;k++)
+        first_pass_events_add(events,&old->events.items[old_line->first_event + k]);
+    for(k=0;k<old_line->ref_count;k++) {
+        index = line->code_start + *(unsigned int *)refs[old_line->first_ref + k];
+        gda_insert(t_unit->symbol_fixups,&index);
+    }
+    for(k=0;k<old_line->ic_words;k++)
+        gda_insert(t_unit->bmc_code,&old->code[old_line->code_start + k]);
+    assembler_insert_words(t_unit->bmc_data,&old->data[old_line->data_start],old_line->dc_words);
+}
+/**
+ * @brief Assembles one file incrementally, against the state its previous run saved next to the .ob file.
+ * the lines of the common prefix and suffix of the previous and the new .am file are not parsed or encoded again,
+ * their events and words are copied from the state, only the lines in between are. the events of all lines are then
+ * applied in source order, so the symbol table and the diagnostics are the ones of a full run, and every symbol
+ * operand is resolved again, so references to labels that moved are fixed wherever they are.
+ * if the .ob file is the one the state was saved with and the amount of words did not change, it is patched in place.
+ * without a valid state every line counts as changed.
+ * @param t_unit The translation unit of the file.
+ * @param base_name The base name of the file.
+ * @param includes The include cache of the run, may be NULL.
+ * @return 0 if the output files were written, 1 otherwise.
+ */
+static int assembler_assemble_incremental(struct translation_unit * t_unit,const char * base_name,pre_asm_includes includes) {
+    struct incremental_state old, state;
+    struct incremental_line * line;
+    struct incremental_line * realloc_ret;
+    struct first_pass_chunk chunk = {0};
+    struct syntax_struct s_struct;
+    char buffer[max_line_size + 1] = {0};
+    char ob_key[BUILD_CACHE_KEY_LEN + 1];
+    const char * am_file_name;
+    char * state_file_name;
+    char * ob_file_name;
+    source_buffer am_file;
+    const char * cursor;
+    const char * source_line;
+    const struct first_pass_event * events;
+    unsigned int i, k, prefix, suffix, capacity = 0;
+    int loaded, patch, error = 0;
 
-            }else {
-                t_unit = assembler_create_new_translation_unit();
-                if(assembler_first_pass_symbol_table(t_unit.symbol_table,am_file,am_file_name) == 0 ) {
-                    rewind(am_file);
-                    if(assembler_second_pass(&t_unit,am_file,am_file_name) == 0) {
-                        if(out_print_translation_unit(&t_unit,files[i])) {
+    ASSEMBLER_PHASE(t_unit,stats_phase_pre_asm,"pre-asm",am_file_name = asm_pre_asm_with_includes(base_name,t_unit->names,includes,NULL,NULL));
+    if(!am_file_name)
+        return 1;
+    am_file = source_buffer_open(am_file_name);
+    state_file_name = mem_malloc(mem_tag_files,strlen(base_name) + strlen(INCREMENTAL_STATE_EXT) + 1);
+    ob_file_name    = mem_malloc(mem_tag_files,strlen(base_name) + 4);
+    if(!am_file || !state_file_name || !ob_file_name) {
+        if(am_file)
+            source_buffer_close(am_file);
+        mem_free(state_file_name);
+        mem_free(ob_file_name);
+        mem_free((void*)am_file_name);
+        return 1;
+    }
+    strcat(strcpy(state_file_name,base_name),INCREMENTAL_STATE_EXT);
+    strcat(strcpy(ob_file_name,base_name),".ob");
+    assembler_incremental_init(&old);
+    assembler_incremental_init(&state);
+    loaded = assembler_incremental_load(&old,state_file_name) == 0;
+    /* hash every line */
+    cursor = source_buffer_begin(am_file);
+    while(!error && source_buffer_next_line(&cursor,source_buffer_end(am_file),buffer,max_line_size)) {
+        if(state.line_count == capacity) {
+            capacity = capacity ? capacity * 2 : 1024;
+            realloc_ret = mem_realloc(mem_tag_incremental,state.lines,capacity * sizeof(struct incremental_line));
+            if(!realloc_ret) {
+                error = 1;
+                break;
+            }
+            state.lines = realloc_ret;
+        }
+        assembler_incremental_hash(buffer,state.lines[state.line_count++].hash);
+    }
+    /* the unchanged lines are the common prefix and suffix */
+    for(prefix=0;prefix < state.line_count && prefix < old.line_count;prefix++) {
+        if(state.lines[prefix].hash[0] != old.lines[prefix].hash[0] || state.lines[prefix].hash[1] != old.lines[prefix].hash[1])
+            break;
+    }
+    for(suffix=0;suffix < state.line_count - prefix && suffix < old.line_count - prefix;suffix++) {
+        if(state.lines[state.line_count - 1 - suffix].hash[0] != old.lines[old.line_count - 1 - suffix].hash[0] ||
+            state.lines[state.line_count - 1 - suffix].hash[1] != old.lines[old.line_count - 1 - suffix].hash[1])
+            break;
+    }
+    /* words, events and symbol operands of every line, in order. the events of parsed lines point into am_file,
+       the events of copied lines into old, both outlive the state */
+    cursor = source_buffer_begin(am_file);
+    for(i=0;!error && i<state.line_count;i++) {
+        source_line = cursor;
+        source_buffer_next_line(&cursor,source_buffer_end(am_file),buffer,max_line_size);
+        line = &state.lines[i];
+        line->code_start  = gda_size(t_unit->bmc_code);
+        line->data_start  = gda_size(t_unit->bmc_data);
+        line->first_event = chunk.events.count;
+        line->first_ref   = gda_size(t_unit->symbol_fixups);
+        if(i < prefix || i >= state.line_count - suffix) {
+            assembler_incremental_copy_line(t_unit,&chunk.events,&old,line,&old.lines[i < prefix ? i : i + old.line_count - state.line_count]);
+        }else {
+            assembler_first_pass_parse_line(&chunk,buffer,source_line,&s_struct);
+            assembler_encode_line(t_unit,&s_struct);
+        }
+        line->ic_words    = gda_size(t_unit->bmc_code) - line->code_start;
+        line->dc_words    = gda_size(t_unit->bmc_data) - line->data_start;
+        line->event_count = chunk.events.count - line->first_event;
+        line->ref_count   = gda_size(t_unit->symbol_fixups) - line->first_ref;
+    }
+    state.events = chunk.events;
+    if(state.events.failed) {
+        asm_error_printer(t_unit->diagnostics,am_file_name,i,"could not allocate the symbol table events.\n");
+        error = 1;
+    }
+    /* the events are applied in source order, a line starts at its own IC and DC. every event is applied after
+       an error as well, so the diagnostics are the ones of a full run */
+    events = state.events.items;
+    if(error == 0)
+        ASSEMBLER_PHASE(t_unit,stats_phase_first_pass,"first pass",
+            for(i=0;i<state.line_count;i++) {
+                line = &state.lines[i];
+                for(k=0;k<line->event_count;k++)
+                    error |= assembler_first_pass_apply_event(t_unit,&events[line->first_event + k],i + 1,PROG_BASE_ADDR + line->code_start,line->data_start,am_file_name);
+            }
+            error |= assembler_first_pass_finish(t_unit,PROG_BASE_ADDR + gda_size(t_unit->bmc_code),am_file_name));
+    if(error == 0) {
+        ASSEMBLER_PHASE(t_unit,stats_phase_second_pass,"second pass",assembler_resolve_fixups(t_unit));
+        /* the .ob file is patched only if it is the one the previous state was saved with */
+        patch = loaded && old.code_count == gda_size(t_unit->bmc_code) && old.data_count == gda_size(t_unit->bmc_data) &&
+                build_cache_key(ob_file_name,"",ob_key) == 0 && strcmp(ob_key,old.ob_key) == 0;
+        if(patch)
+            ASSEMBLER_PHASE(t_unit,stats_phase_output,"output",error = out_patch_translation_unit(t_unit,base_name,old.code,old.data) != 0);
+        else
+            ASSEMBLER_PHASE(t_unit,stats_phase_output,"output",error = out_print_translation_unit(t_unit,base_name) != 0);
+        if(error == 0 && build_cache_key(ob_file_name,"",state.ob_key) == 0)
+            assembler_incremental_save(&state,t_unit,state_file_name);
+    }
+    assembler_incremental_free(&old);
+    assembler_incremental_free(&state);
+    source_buffer_close(am_file);
+    mem_free(state_file_name);
+    mem_free(ob_file_name);
+    mem_free((void*)am_file_name);
+    return error;
+}
+/**
+ * @brief The expanded text of a file that is assembled without writing its .am file.
+ * @param text the text, allocated with mem_malloc.
+ * @param len the characters of text in use.
+ * @param capacity the characters text has room for.
+ * @param failed set if the text could not grow, pieces of it are missing.
+ */
+struct assembler_text {
+    char   *text;
+    size_t  len;
+    size_t  capacity;
+    int     failed;
+};
+/**
+ * @brief The pre-asm sink of an in memory assembly, appends the expanded text.
+ * @param context Pointer to the struct assembler_text.
+ * @param text The expanded text.
+ */
+static void assembler_text_sink(void * context,const char * text) {
+    struct assembler_text * collected = context;
+    size_t len = strlen(text);
+    size_t capacity;
+    char * grown;
+    if(collected->failed)
+        return;
+    if(collected->len + len > collected->capacity) {
+        capacity = collected->capacity ? collected->capacity * 2 : 64 * 1024;
+        while(capacity < collected->len + len)
+            capacity *= 2;
+        grown = mem_realloc(mem_tag_files,collected->text,capacity);
+        if(grown == NULL) {
+            collected->failed = 1;
+            return;
+        }
+        collected->text = grown;
+        collected->capacity = capacity;
+    }
+    memcpy(collected->text + collected->len,text,len);
+    collected->len += len;
+}
+/**
+ * @brief Assembles one file with pre-asm and the two passes, one after the other.
+ * @param t_unit The translation unit of the file.
+ * @param base_name The base name of the file.
+ * @param options The options of the run, its parse_threads, optimize and dedup_data apply.
+ * @param includes The include cache of the run, may be NULL.
+ * @param words_saved Incremented by the code and data words the optimizer and the data deduplication saved.
+ * @return 0 if the output files were written, 1 otherwise.
+ */
+static int assembler_assemble_sequential(struct translation_unit * t_unit,const char * base_name,const struct assembler_options * options,pre_asm_includes includes,unsigned long * words_saved) {
+    const char *am_file_name;
+    source_buffer am_file;
+    struct optimize_plan plan = {0};
+    struct assembler_text text = {0};
+    int error = 1, pass;
+    if(options->in_memory)
+        ASSEMBLER_PHASE(t_unit,stats_phase_pre_asm,"pre-asm",am_file_name = asm_pre_asm_to_memory(base_name,t_unit->names,includes,assembler_text_sink,&text));
+    else
+        ASSEMBLER_PHASE(t_unit,stats_phase_pre_asm,"pre-asm",am_file_name = asm_pre_asm_with_includes(base_name,t_unit->names,includes,NULL,NULL));
+    if(!am_file_name || text.failed) /* failed to macro parsed .. do what ever...*/ {
+        mem_free(text.text);
+        mem_free((void*)am_file_name);
+    }else {
+        /* the passes read the expanded text from memory, the name of the .am file is still the one in diagnostics */
+        am_file = options->in_memory ? source_buffer_adopt(text.text,text.len) : source_buffer_open(am_file_name);
+        if(!am_file) {
 
-                        }
-                    }
+        }else {
+            /* both passes read the same in memory copy of the .am file */
+            ASSEMBLER_PHASE(t_unit,stats_phase_first_pass,"first pass",pass = assembler_first_pass_symbol_table(t_unit,am_file,am_file_name,options->parse_threads));
+            if(pass == 0 && options->optimize) {
+                ASSEMBLER_PHASE(t_unit,stats_phase_optimize,"optimize",pass = assembler_optimize(t_unit,am_file,&plan));
+                *words_saved += plan.words_saved;
+            }
+            if(pass == 0 ) {
+                ASSEMBLER_PHASE(t_unit,stats_phase_second_pass,"second pass",pass = assembler_second_pass(t_unit,am_file,am_file_name,options->optimize ? &plan : NULL,options->dedup_data ? words_saved : NULL));
+                if(pass == 0 && options->in_memory)
+                    error = 0;
+                else if(pass == 0) {
+                    ASSEMBLER_PHASE(t_unit,stats_phase_output,"output",error = out_print_translation_unit(t_unit,base_name) != 0);
                 }
-                fclose(am_file);
-                assembler_destroy_translation_unit(&t_unit);
-                free((void*)am_file_name);
             }
-            
+            mem_free(plan.lines);
+            source_buffer_close(am_file);
+        }
+        mem_free((void*)am_file_name);
+    }
+    return error;
+}
+/**
+ * @brief The salt of a build cache key, the version followed by the key of every included file.
+ * @param salt The salt so far.
+ * @param len Its length.
+ * @param capacity The bytes allocated for it.
+ * @param error Non zero if an included file could not be hashed or on allocation failure.
+ */
+struct cache_key_salt {
+    char *salt;
+    size_t len;
+    size_t capacity;
+    int error;
+};
+/**
+ * @brief Appends the key of an included file to the salt.
+ * @param context The salt.
+ * @param path The path of the included file.
+ */
+static void assembler_cache_key_include(void * context,const char * path) {
+    struct cache_key_salt * salt = context;
+    char key[BUILD_CACHE_KEY_LEN + 1];
+    char * realloc_ret;
+    if(salt->error || build_cache_key(path,"",key) != 0) {
+        salt->error = 1;
+        return;
+    }
+    if(salt->len + BUILD_CACHE_KEY_LEN + 1 > salt->capacity) {
+        realloc_ret = mem_realloc(mem_tag_files,salt->salt,salt->capacity * 2 + BUILD_CACHE_KEY_LEN + 1);
+        if(!realloc_ret) {
+            salt->error = 1;
+            return;
         }
+        salt->salt = realloc_ret;
+        salt->capacity = salt->capacity * 2 + BUILD_CACHE_KEY_LEN + 1;
+    }
+    strcpy(salt->salt + salt->len,key);
+    salt->len += BUILD_CACHE_KEY_LEN;
+}
+/**
+ * @brief Computes the build cache key of a file.
+ * @param base_name The base name of the file.
+ * @param options The options of the run, the optimizer and the data deduplication change the outputs.
+ * @param includes The include cache the included files are read into.
+ * @param key Output for the key.
+ * @return 0 on success, -1 if the .as file or a file it includes cannot be read.
+ */
+static int assembler_cache_key(const char * base_name,const struct assembler_options * options,pre_asm_includes includes,char key[BUILD_CACHE_KEY_LEN + 1]) {
+    static const char * const versions[4] = {
+        ASSEMBLER_VERSION,
+        ASSEMBLER_VERSION "-optimize",
+        ASSEMBLER_VERSION "-dedup-data",
+        ASSEMBLER_VERSION "-optimize-dedup-data"
+    };
+    struct cache_key_salt salt = {0};
+    const char * version = versions[(options->optimize != 0) | (options->dedup_data != 0) << 1];
+    char * as_file_name;
+    int ret;
+    if(!includes)
+        return -1;
+    as_file_name = mem_malloc(mem_tag_files,strlen(base_name) + 4);
+    salt.capacity = strlen(version) + 1;
+    salt.salt = mem_malloc(mem_tag_files,salt.capacity);
+    if(!as_file_name || !salt.salt) {
+        mem_free(as_file_name);
+        mem_free(salt.salt);
+        return -1;
     }
+    strcat(strcpy(as_file_name,base_name),".as");
+    strcpy(salt.salt,version);
+    salt.len = strlen(version);
+    /* macros are defined in the .as file and in the files it includes, so their contents and the version determine the outputs */
+    ret = pre_asm_includes_of(includes,base_name,assembler_cache_key_include,&salt);
+    if(ret == 0 && !salt.error)
+        ret = build_cache_key(as_file_name,salt.salt,key);
+    else
+        ret = -1;
+    mem_free(as_file_name);
+    mem_free(salt.salt);
+    return ret;
+}
+/**
+ * @brief Stores the output files of an assembled file in the build cache.
+ * @param cache The build cache.
+ * @param key The key of the file.
+ * @param t_unit The translation unit of the file, the same outputs out_print_translation_unit wrote are stored.
+ * @param base_name The base name of the file.
+ */
+static void assembler_cache_store(build_cache cache,const char * key,const struct translation_unit * t_unit,const char * base_name) {
+    const char * extensions[3];
+    int count = 0;
+    void *const* begin;
+    void *const* end;
+    const struct symbol * symbol;
+    extensions[count++] = ".ob";
+    if(gda_size(t_unit->extern_usage) > 0)
+        extensions[count++] = ".ext";
+    gda_for_each(t_unit->symbol_table,begin,end) {
+        symbol = *begin;
+        if(symbol->sym_type == sym_type_code_entry || symbol->sym_type == sym_type_data_entry) {
+            extensions[count++] = ".ent";
+            break;
+        }
+    }
+    build_cache_store(cache,key,base_name,extensions,count);
+}
+/**
+ * @brief The state kept warm between the runs of a session.
+ * @param includes the include cache, NULL until the first run.
+ * @param t_unit the translation unit, emptied between files.
+ * @param warm non zero if t_unit was created and not destroyed since.
+ */
+struct assembler_session {
+    pre_asm_includes        includes;
+    struct translation_unit t_unit;
+    int                     warm;
+};
+
+assembler_session assembler_session_create(void) {
+    return mem_calloc(mem_tag_files,1,sizeof(struct assembler_session));
+}
+
+/**
+ * @brief Frees what a session keeps warm, not the session itself.
+ * @param session The session.
+ */
+static void assembler_session_release(struct assembler_session * session) {
+    if(session->includes)
+        pre_asm_includes_destroy(session->includes);
+    if(session->warm)
+        assembler_destroy_translation_unit(&session->t_unit);
+}
+
+void assembler_session_destroy(assembler_session session) {
+    assembler_session_release(session);
+    mem_free(session);
+}
+
+int assemble_in_session(assembler_session session, char **files,int file_count,const struct assembler_options * options) {
+    int i, error, keyed;
+    unsigned long words_saved = 0;
+    build_cache cache = NULL;
+    pre_asm_includes includes;
+    char key[BUILD_CACHE_KEY_LEN + 1];
+#ifdef ASM_STATS
+    struct stats snapshot;
+    struct stats batch;
+#endif
+#ifdef ASM_MEM
+    struct mem_stats mem_snapshot_file;
+    struct mem_stats mem_file;
+    struct mem_stats mem_batch;
+#endif
+    if(options->trace_file)
+        trace_start(options->trace_file);
+    /* outputs of an in memory run are never on disk, there is nothing to restore or patch */
+    if(options->cache_dir && !options->in_memory)
+        cache = build_cache_open(options->cache_dir,options->cache_max_bytes);
+    /* a file included by several files of the run, or of the runs of a session, is read and its macros scanned once */
+    if(session->includes && !pre_asm_includes_unchanged(session->includes)) {
+        pre_asm_includes_destroy(session->includes);
+        session->includes = NULL;
+    }
+    if(session->includes)
+        pre_asm_includes_set_diagnostics(session->includes,options->diagnostics);
+    else
+        session->includes = pre_asm_includes_create(options->diagnostics);
+    includes = session->includes;
+#ifdef ASM_STATS
+    memset(&batch,0,sizeof(batch));
+#endif
+#ifdef ASM_MEM
+    memset(&mem_batch,0,sizeof(mem_batch));
+#endif
+    for(i=0;i<file_count;i++) {
+        /* an unchanged source is not assembled again, its outputs are restored from the cache */
+        keyed = cache && assembler_cache_key(files[i],options,includes,key) == 0;
+        if(keyed && build_cache_restore(cache,key,files[i]))
+            continue;
+        TRACE_BEGIN("file",files[i]);
+#ifdef ASM_MEM
+        if(options->memory)
+            mem_snapshot(&mem_snapshot_file);
+#endif
+        /* the translation unit is ready first so pre-asm interns macro names into the same pool */
+        if(session->warm)
+            assembler_reset_translation_unit(&session->t_unit);
+        else
+            session->t_unit = assembler_create_new_translation_unit();
+        session->warm = 1;
+        session->t_unit.diagnostics = options->diagnostics ? options->diagnostics : stdout;
+#ifdef ASM_STATS
+        if(options->stats)
+            stats_snapshot(&snapshot);
+#endif
+        error = -1;
+        /* the optimizer and the data deduplication work on the whole file between the passes, only the sequential assembly has that point */
+        if(options->incremental && !options->in_memory && !options->optimize && !options->dedup_data)
+            error = assembler_assemble_incremental(&session->t_unit,files[i],includes);
+        else if(options->pipeline && !options->optimize && !options->dedup_data)
+            error = assembler_assemble_pipelined(&session->t_unit,files[i],includes,options->in_memory);
+        if(error == -1)
+            error = assembler_assemble_sequential(&session->t_unit,files[i],options,includes,&words_saved);
+        if(error == 0 && keyed)
+            assembler_cache_store(cache,key,&session->t_unit,files[i]);
+        if(error == 0 && options->assembled)
+            options->assembled(options->assembled_context,files[i],&session->t_unit);
+#ifdef ASM_STATS
+        if(options->stats) {
+            STATS_ADD(stats_symbols,gda_size(session->t_unit.symbol_ids));
+            STATS_ADD(stats_words_emitted,gda_size(session->t_unit.bmc_code) + gda_size(session->t_unit.bmc_data));
+            stats_since(&session->t_unit.stats,&snapshot);
+            stats_print(options->stats,files[i],&session->t_unit.stats,options->stats_json);
+            stats_add(&batch,&session->t_unit.stats);
+        }
+#endif
+#ifdef ASM_MEM
+        /* bytes and blocks the file left behind once its translation unit is destroyed are leaks */
+        if(options->memory) {
+            assembler_destroy_translation_unit(&session->t_unit);
+            session->warm = 0;
+            mem_since(&mem_file,&mem_snapshot_file);
+            mem_print(options->memory,files[i],&mem_file,options->memory_json);
+            mem_add(&mem_batch,&mem_file);
+        }
+#endif
+        TRACE_END();
+    }
+#ifdef ASM_STATS
+    if(options->stats)
+        stats_print(options->stats,NULL,&batch,options->stats_json);
+#endif
+#ifdef ASM_MEM
+    if(options->memory)
+        mem_print(options->memory,NULL,&mem_batch,options->memory_json);
+#endif
+    if(cache)
+        build_cache_close(cache,options->cache_stats);
+    if(options->words_saved)
+        *options->words_saved = words_saved;
+    return 0;
+}
+
+int assemble_with_options( char **files,int file_count,const struct assembler_options * options) {
+    struct assembler_session session = {0};
+    assemble_in_session(&session,files,file_count,options);
+    /* nothing of a single run is kept warm */
+    assembler_session_release(&session);
+#ifdef ASM_MEM
+    if(options->memory)
+        mem_print_leaks(options->memory);
+#endif
     return 0;
-}
\ No newline at end of file
+}
+int assemble( char **files,int file_count) {
+    struct assembler_options options = {0};
+    options.parse_threads = 1;
+    return assemble_with_options(files,file_count,&options);
+}
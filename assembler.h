@@ -1,6 +1,11 @@
 #ifndef __ASSEMBLER_H__
 #define __ASSEMBLER_H__
 
+#include <stdio.h>
+#include "../../build-cache/inc/build-cache.h"
+
+struct translation_unit;
+
 
 
 
@@ -14,6 +19,96 @@
  */
 int assemble( char **files,int file_count);
 
+/**
+ * @brief options of an assembler run.
+ * @param parse_threads amount of threads the first pass parses a single file with, 1 or less parses sequentially.
+ * @param pipeline non zero runs pre-asm, parsing and encoding of a file concurrently, parse_threads is then ignored.
+ * @param incremental non zero assembles a file against the state its previous run saved next to its .ob file, only the lines that changed are parsed and encoded again, and the .ob file is patched in place when possible. parse_threads and pipeline are then ignored.
+ * @param cache_dir directory of the build cache, outputs of unchanged .as files are restored from it instead of assembling them. NULL disables the cache.
+ * @param cache_max_bytes the cache is evicted down to this size at the end of the run, 0 for no bound.
+ * @param cache_stats if not NULL, receives the cache counters at the end of the run.
+ * @param diagnostics where errors and warnings are printed, NULL prints them to stdout.
+ * @param stats if not NULL, the phase timings and counters of every file and of the whole run are printed to it. printed only when built with ASM_STATS.
+ * @param stats_json non zero prints the stats as one line of JSON per file instead of text.
+ * @param memory if not NULL, the bytes, peak bytes and allocations of every subsystem are printed to it for every file and for the whole run, followed by the blocks still in use. printed only when built with ASM_MEM. the counters are of the whole process, files assembled concurrently, e.g. by the server, are mixed.
+ * @param memory_json non zero prints the memory of every file as one line of JSON instead of text.
+ * @param trace_file if not NULL, tracing starts into this file if it did not already, and spans of every file, phase and macro expansion are written to it at exit in the Chrome trace event format. traced only when built with ASM_TRACE.
+ * @param assembled if not NULL, called with every file assembled without errors and its translation unit, before the translation unit is destroyed. a file restored from the cache is not assembled, so it is not called for it.
+ * @param assembled_context passed to assembled.
+ * @param optimize non zero runs a peephole optimizer between the two passes: a constant moved into a register or a symbol absorbs the add, sub, inc and dec of it that follow,
+ * mov #0 becomes clr, and mov of a register to itself, add or sub of #0 and a jmp or bne to the next instruction are dropped. labels move to the shorter code.
+ * pipeline and incremental are then ignored.
+ * @param dedup_data non zero merges identical .data and .string payloads, and payloads that end another one, into a single copy their labels share.
+ * a program must not write to the data it merges. pipeline and incremental are then ignored.
+ * @param words_saved if not NULL, receives the code and data words the optimizer and dedup_data saved over the run.
+ * @param in_memory non zero writes nothing next to the .as files: pre-asm hands the expanded text to the passes in memory and the
+ * .am, .ob, .ent and .ext files are not written, assembled takes the outputs from the translation unit with out_write_translation_unit.
+ * cache_dir and incremental are then ignored.
+ */
+struct assembler_options {
+    int parse_threads;
+    int pipeline;
+    int incremental;
+    const char *cache_dir;
+    unsigned long cache_max_bytes;
+    struct build_cache_stats *cache_stats;
+    FILE *diagnostics;
+    FILE *stats;
+    int stats_json;
+    FILE *memory;
+    int memory_json;
+    const char *trace_file;
+    void (*assembled)(void *context,const char *base_name,const struct translation_unit *t_unit);
+    void *assembled_context;
+    int optimize;
+    int dedup_data;
+    unsigned long *words_saved;
+    int in_memory;
+};
+
+/**
+ * @brief main assembler routine, with options.
+ * 
+ * @param[in] files - list of .as files
+ * @param[in] file_count  count of how many .as files..
+ * @param[in] options - options of the run.
+ * @return int the amount of compiled .as files.
+ */
+int assemble_with_options( char **files,int file_count,const struct assembler_options * options);
+
+/* opaque struct */
+struct assembler_session;
+typedef struct assembler_session * assembler_session;
+
+/**
+ * @brief creates the state a caller that assembles many runs, e.g. a server, keeps warm between them:
+ * the include cache, and the translation unit whose tables and name pool are emptied, not freed, between files.
+ * the include cache is read again when a file in it changed on disk.
+ * 
+ * @return assembler_session NULL on allocation failure.
+ */
+assembler_session assembler_session_create(void);
+
+/**
+ * @brief same as assemble_with_options, with the warm state of session. a session serves one run at a time.
+ * with options->memory the translation unit is freed after every file, so its memory is accounted to the file,
+ * and the blocks still in use are not printed, the session holds some of them.
+ * 
+ * @param[in] session
+ * @param[in] files - list of .as files
+ * @param[in] file_count  count of how many .as files..
+ * @param[in] options - options of the run.
+ * @return int the amount of compiled .as files.
+ */
+int assemble_in_session(assembler_session session, char **files,int file_count,const struct assembler_options * options);
+
+/**
+ * @brief frees the session and everything it keeps warm.
+ * 
+ * @param session
+ */
+void assembler_session_destroy(assembler_session session);
+
 
 
 
@@ -0,0 +1,407 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <utime.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include "../inc/build-cache.h"
+#include "../../utilities/source-buffer/inc/source-buffer.h"
+#include "../../utilities/generic-dynamic-array/inc/gda.h"
+#include "../../utilities/mem/inc/mem.h"
+
+/* independent 32 bit lanes of the key hash, each with its own multiplier. */
+#define BUILD_CACHE_LANES 4
+/* size of the buffer files are copied through. */
+#define BUILD_CACHE_COPY_SIZE 8192
+
+/* Temporary entries created so far by the process, for unique names. counted for the whole process, not per cache,
+   so the caches of concurrent runs on the same directory never pick the same name. */
+static unsigned long build_cache_temp_count;
+
+/* The build_cache structure. */
+struct build_cache {
+    char                       *dir;        /* The cache directory. */
+    unsigned long               max_bytes;  /* The size bound, 0 for none. */
+    struct build_cache_stats    stats;
+};
+
+/* An entry found while scanning for eviction. */
+struct build_cache_entry {
+    char           *name;
+    unsigned long   bytes;
+    time_t          mtime;
+};
+
+/**
+ * @brief Constructs a new entry by deep copying an existing one.
+ *
+ * @param copy The existing entry
+ * @return void* The new entry
+ */
+static void *build_cache_entry_ctor(const void *copy) {
+    const struct build_cache_entry *c = copy;
+    struct build_cache_entry *entry = mem_malloc(mem_tag_cache,sizeof(struct build_cache_entry));
+    if(!entry)
+        return NULL;
+    *entry = *c;
+    entry->name = mem_malloc(mem_tag_cache,strlen(c->name) + 1);
+    if(!entry->name) {
+        mem_free(entry);
+        return NULL;
+    }
+    strcpy(entry->name,c->name);
+    return entry;
+}
+
+/**
+ * @brief Destroys an entry.
+ *
+ * @param copy The entry
+ */
+static void build_cache_entry_dtor(void *copy) {
+    mem_free(((struct build_cache_entry *)copy)->name);
+    mem_free(copy);
+}
+
+/**
+ * @brief Orders entries from the least recently used.
+ *
+ * @param a The first entry
+ * @param b The second entry
+ * @return int The comparison result
+ */
+static int build_cache_entry_compar(const void *a,const void *b) {
+    const struct build_cache_entry *ap = a;
+    const struct build_cache_entry *bp = b;
+    if(ap->mtime != bp->mtime)
+        return ap->mtime < bp->mtime ? -1 : 1;
+    return strcmp(ap->name,bp->name);
+}
+
+/**
+ * @brief Joins a directory and a name into a new path.
+ *
+ * @param dir The directory
+ * @param name The name
+ * @param suffix Appended to name, may be empty
+ * @return char* The path, or NULL on allocation failure
+ */
+static char *build_cache_path(const char *dir,const char *name,const char *suffix) {
+    char *path = mem_malloc(mem_tag_cache,strlen(dir) + strlen(name) + strlen(suffix) + 2);
+    if(!path)
+        return NULL;
+    strcat(strcat(strcat(strcpy(path,dir),"/"),name),suffix);
+    return path;
+}
+
+/**
+ * @brief Copies a file.
+ *
+ * @param from The source path
+ * @param to The destination path
+ * @return int 0 on success, -1 otherwise
+ */
+static int build_cache_copy(const char *from,const char *to) {
+    char buffer[BUILD_CACHE_COPY_SIZE];
+    FILE *in, *out;
+    size_t n;
+    int error = 0;
+    in = fopen(from,"rb");
+    if(!in)
+        return -1;
+    out = fopen(to,"wb");
+    if(!out) {
+        fclose(in);
+        return -1;
+    }
+    while((n = fread(buffer,1,sizeof(buffer),in)) > 0) {
+        if(fwrite(buffer,1,n,out) != n) {
+            error = -1;
+            break;
+        }
+    }
+    if(ferror(in))
+        error = -1;
+    fclose(in);
+    if(fclose(out))
+        error = -1;
+    return error;
+}
+
+/**
+ * @brief Removes an entry directory and the files in it.
+ *
+ * @param path The entry directory
+ * @param bytes Output for the size of the removed files, may be NULL
+ */
+static void build_cache_remove_entry(const char *path,unsigned long *bytes) {
+    DIR *dir = opendir(path);
+    struct dirent *de;
+    struct stat st;
+    char *file;
+    if(dir) {
+        while((de = readdir(dir)) != NULL) {
+            if(de->d_name[0] == '.')
+                continue;
+            file = build_cache_path(path,de->d_name,"");
+            if(!file)
+                continue;
+            if(bytes && stat(file,&st) == 0)
+                *bytes += st.st_size;
+            remove(file);
+            mem_free(file);
+        }
+        closedir(dir);
+    }
+    rmdir(path);
+}
+
+/**
+ * @brief Returns the size of the files of an entry directory.
+ *
+ * @param path The entry directory
+ * @return unsigned long The size
+ */
+static unsigned long build_cache_entry_size(const char *path) {
+    DIR *dir = opendir(path);
+    struct dirent *de;
+    struct stat st;
+    char *file;
+    unsigned long bytes = 0;
+    if(!dir)
+        return 0;
+    while((de = readdir(dir)) != NULL) {
+        if(de->d_name[0] == '.')
+            continue;
+        file = build_cache_path(path,de->d_name,"");
+        if(file && stat(file,&st) == 0)
+            bytes += st.st_size;
+        mem_free(file);
+    }
+    closedir(dir);
+    return bytes;
+}
+
+/**
+ * @brief Opens a cache.
+ *
+ * @param dir The cache directory
+ * @param max_bytes The size bound
+ * @return build_cache The cache
+ */
+build_cache build_cache_open(const char *dir,unsigned long max_bytes) {
+    struct stat st;
+    build_cache cache;
+    if(stat(dir,&st) != 0 && mkdir(dir,0777) != 0)
+        return NULL;
+    cache = mem_calloc(mem_tag_cache,1,sizeof(struct build_cache));
+    if(!cache)
+        return NULL;
+    cache->dir = mem_malloc(mem_tag_cache,strlen(dir) + 1);
+    if(!cache->dir) {
+        mem_free(cache);
+        return NULL;
+    }
+    strcpy(cache->dir,dir);
+    cache->max_bytes = max_bytes;
+    return cache;
+}
+
+/**
+ * @brief Computes the key of a source file.
+ *
+ * @param file_name The source file
+ * @param salt Anything else the outputs depend on
+ * @param key Output for the key
+ * @return int 0 on success, -1 otherwise
+ */
+int build_cache_key(const char *file_name,const char *salt,char key[BUILD_CACHE_KEY_LEN + 1]) {
+    static const unsigned long multipliers[BUILD_CACHE_LANES] = {16777619UL,2654435761UL,2246822519UL,3266489917UL};
+    unsigned long lanes[BUILD_CACHE_LANES];
+    source_buffer sb = source_buffer_open(file_name);
+    const char *it;
+    const char *end;
+    int l;
+    if(!sb)
+        return -1;
+    for(l=0;l<BUILD_CACHE_LANES;l++)
+        lanes[l] = 2166136261UL + l;
+    /* the salt goes first, a null separates it from the contents */
+    for(it = salt;;it++) {
+        for(l=0;l<BUILD_CACHE_LANES;l++)
+            lanes[l] = ((lanes[l] ^ (unsigned char)*it) * multipliers[l]) & 0xffffffffUL;
+        if(*it == '\0')
+            break;
+    }
+    end = source_buffer_end(sb);
+    for(it = source_buffer_begin(sb);it < end;it++) {
+        for(l=0;l<BUILD_CACHE_LANES;l++)
+            lanes[l] = ((lanes[l] ^ (unsigned char)*it) * multipliers[l]) & 0xffffffffUL;
+    }
+    for(l=0;l<BUILD_CACHE_LANES;l++) {
+        /* mix in the length so contents that differ only in trailing nulls differ */
+        lanes[l] = ((lanes[l] ^ (unsigned long)(end - source_buffer_begin(sb))) * multipliers[l]) & 0xffffffffUL;
+        sprintf(key + l * 8,"%08lx",lanes[l]);
+    }
+    source_buffer_close(sb);
+    return 0;
+}
+
+/**
+ * @brief Restores the outputs stored under a key.
+ *
+ * @param cache The cache
+ * @param key The key
+ * @param base_name The base name of the outputs
+ * @return int 1 on a hit, 0 on a miss
+ */
+int build_cache_restore(build_cache cache,const char *key,const char *base_name) {
+    char *entry = build_cache_path(cache->dir,key,"");
+    char *from, *to;
+    DIR *dir;
+    struct dirent *de;
+    int hit = 1;
+    if(!entry || (dir = opendir(entry)) == NULL) {
+        mem_free(entry);
+        cache->stats.misses++;
+        return 0;
+    }
+    while(hit && (de = readdir(dir)) != NULL) {
+        if(de->d_name[0] == '.')
+            continue;
+        /* the files of an entry are named by their extension without the dot */
+        from = build_cache_path(entry,de->d_name,"");
+        to = mem_malloc(mem_tag_cache,strlen(base_name) + strlen(de->d_name) + 2);
+        if(!from || !to)
+            hit = 0;
+        else
+            hit = build_cache_copy(from,strcat(strcat(strcpy(to,base_name),"."),de->d_name)) == 0;
+        mem_free(from);
+        mem_free(to);
+    }
+    closedir(dir);
+    if(hit) {
+        /* the modification time of an entry is its last use, eviction starts from the oldest */
+        utime(entry,NULL);
+        cache->stats.hits++;
+    }else {
+        cache->stats.misses++;
+    }
+    mem_free(entry);
+    return hit;
+}
+
+/**
+ * @brief Stores the outputs of a base name under a key.
+ *
+ * @param cache The cache
+ * @param key The key
+ * @param base_name The base name of the outputs
+ * @param extensions The extensions of the outputs
+ * @param count The amount of extensions
+ * @return int 0 on success, -1 otherwise
+ */
+int build_cache_store(build_cache cache,const char *key,const char *base_name,const char *const *extensions,int count) {
+    char temp_name[64];
+    char *temp, *entry, *from, *to;
+    int i, error = 0;
+    /* the entry is filled under a temporary name and renamed into place, so a reader never sees half of it */
+    sprintf(temp_name,".tmp-%ld-%lu",(long)getpid(),__atomic_fetch_add(&build_cache_temp_count,1,__ATOMIC_RELAXED));
+    temp  = build_cache_path(cache->dir,temp_name,"");
+    entry = build_cache_path(cache->dir,key,"");
+    if(!temp || !entry || mkdir(temp,0777) != 0) {
+        mem_free(temp);
+        mem_free(entry);
+        return -1;
+    }
+    for(i=0;i<count && !error;i++) {
+        from = mem_malloc(mem_tag_cache,strlen(base_name) + strlen(extensions[i]) + 1);
+        to   = build_cache_path(temp,extensions[i] + (extensions[i][0] == '.'),"");
+        if(!from || !to)
+            error = -1;
+        else
+            error = build_cache_copy(strcat(strcpy(from,base_name),extensions[i]),to);
+        mem_free(from);
+        mem_free(to);
+    }
+    /* rename fails if another run stored the same key first, its entry is just as good */
+    if(error || rename(temp,entry) != 0) {
+        build_cache_remove_entry(temp,NULL);
+    }else {
+        cache->stats.stores++;
+    }
+    mem_free(temp);
+    mem_free(entry);
+    return error;
+}
+
+/**
+ * @brief Evicts the least recently used entries until the cache is under its bound.
+ *
+ * @param cache The cache
+ */
+static void build_cache_evict(build_cache cache) {
+    DIR *dir = opendir(cache->dir);
+    struct dirent *de;
+    struct stat st;
+    struct build_cache_entry candidate;
+    const struct build_cache_entry *entry;
+    gda entries;
+    void *const *begin;
+    void *const *end;
+    char *path;
+    unsigned long bytes = 0, removed;
+    if(!dir)
+        return;
+    entries = gda_create(build_cache_entry_ctor,build_cache_entry_dtor,build_cache_entry_compar);
+    while((de = readdir(dir)) != NULL) {
+        /* skips . and .. and the temporary entries of runs in progress */
+        if(de->d_name[0] == '.')
+            continue;
+        path = build_cache_path(cache->dir,de->d_name,"");
+        if(path && stat(path,&st) == 0 && S_ISDIR(st.st_mode)) {
+            candidate.name  = de->d_name;
+            candidate.bytes = build_cache_entry_size(path);
+            candidate.mtime = st.st_mtime;
+            gda_insert(entries,&candidate);
+            bytes += candidate.bytes;
+        }
+        mem_free(path);
+    }
+    closedir(dir);
+    if(cache->max_bytes && bytes > cache->max_bytes) {
+        gda_sort(entries);
+        gda_for_each(entries,begin,end) {
+            if(bytes <= cache->max_bytes)
+                break;
+            entry = *begin;
+            path = build_cache_path(cache->dir,entry->name,"");
+            if(!path)
+                continue;
+            removed = 0;
+            build_cache_remove_entry(path,&removed);
+            bytes -= removed < bytes ? removed : bytes;
+            cache->stats.evictions++;
+            mem_free(path);
+        }
+    }
+    cache->stats.bytes = bytes;
+    gda_destroy(entries);
+}
+
+/**
+ * @brief Closes the cache.
+ *
+ * @param cache The cache
+ * @param stats Output for the final counters
+ */
+void build_cache_close(build_cache cache,struct build_cache_stats *stats) {
+    build_cache_evict(cache);
+    if(stats)
+        *stats = cache->stats;
+    mem_free(cache->dir);
+    mem_free(cache);
+}
@@ -0,0 +1,77 @@
+#ifndef maman14_build_cache_h
+#define maman14_build_cache_h
+
+/* length of a key, in hex digits, without the terminating null. */
+#define BUILD_CACHE_KEY_LEN 32
+
+/* opaque struct */
+struct build_cache;
+typedef struct build_cache * build_cache;
+
+/**
+ * @brief counters of a cache, since it was opened.
+ * @param hits lookups whose outputs were restored.
+ * @param misses lookups that found nothing.
+ * @param stores entries added.
+ * @param evictions entries removed to keep the cache under its size bound.
+ * @param bytes size of the cache after eviction.
+ */
+struct build_cache_stats {
+    unsigned long hits;
+    unsigned long misses;
+    unsigned long stores;
+    unsigned long evictions;
+    unsigned long bytes;
+};
+
+/**
+ * @brief opens a cache directory, creating it if it does not exist.
+ * every entry is a directory named by its key holding the output files, so entries are added atomically by renaming.
+ *
+ * @param dir
+ * @param max_bytes the size the cache is evicted down to when it is closed, 0 for no bound.
+ * @return build_cache returns NULL if the directory cannot be created or on allocation failure.
+ */
+build_cache build_cache_open(const char *dir,unsigned long max_bytes);
+
+/**
+ * @brief computes the key of a source file, a hash of its contents and of salt.
+ *
+ * @param file_name
+ * @param salt anything else the outputs depend on, e.g. the assembler version.
+ * @param key output, BUILD_CACHE_KEY_LEN hex digits and a null.
+ * @return int 0 on success, -1 if the file cannot be read.
+ */
+int build_cache_key(const char *file_name,const char *salt,char key[BUILD_CACHE_KEY_LEN + 1]);
+
+/**
+ * @brief copies the outputs stored under key to base_name with their extensions.
+ *
+ * @param cache
+ * @param key
+ * @param base_name
+ * @return int 1 on a hit, 0 on a miss.
+ */
+int build_cache_restore(build_cache cache,const char *key,const char *base_name);
+
+/**
+ * @brief stores the outputs of base_name under key, nothing is stored if key is already in the cache.
+ *
+ * @param cache
+ * @param key
+ * @param base_name
+ * @param extensions the extensions of the outputs, e.g. ".ob".
+ * @param count amount of extensions.
+ * @return int 0 on success, -1 otherwise.
+ */
+int build_cache_store(build_cache cache,const char *key,const char *base_name,const char *const *extensions,int count);
+
+/**
+ * @brief evicts the least recently used entries until the cache is under its size bound, then closes it.
+ *
+ * @param cache
+ * @param stats output for the final counters, may be NULL.
+ */
+void build_cache_close(build_cache cache,struct build_cache_stats *stats);
+
+#endif
@@ -0,0 +1,16 @@
+; reserved buffers are never shared, even when their words are equal
+MAIN: mov #1, BUFA
+ mov #2, BUFB
+ mov #3, SMALL
+ prn ONES
+ prn TAB
+ prn TAB2
+ prn ZEROS
+ stop
+BUFA: .space 4
+BUFB: .space 4
+SMALL: .space 2
+ONES: .fill 3, 1
+TAB: .data 1,1,1
+ZEROS: .data 0,0
+TAB2: .data 1,1
@@ -0,0 +1,28 @@
+; data the program writes or exports keeps its own words
+.entry SHARED
+MAIN: inc A
+ prn A
+ prn B
+ clr C
+ prn D
+ not E
+ prn F
+ lea A, G
+ prn H
+ prn SHARED
+ prn S2
+ prn R1
+ prn R2
+ stop
+A: .data 0
+B: .data 0
+C: .data 5
+D: .data 5
+E: .data 7
+F: .data 7
+G: .data 9
+H: .data 9
+SHARED: .data 3
+S2: .data 3
+R1: .data 11
+R2: .data 11
@@ -0,0 +1,15 @@
+; equal payloads and payloads that end another one share its words
+.entry KEEP
+MAIN: lea HELLO, r1
+ lea LO, r2
+ prn TAB2
+ prn TAIL
+ mov TAB1, r3
+ cmp KEEP, TAB2
+ stop
+HELLO: .string "hello"
+TAB1: .data 1,2,3
+LO: .string "lo"
+TAB2: .data 1,2,3
+TAIL: .data 2,3
+KEEP: .data 4
@@ -0,0 +1,7 @@
+; a file with errors writes the .am file and nothing else
+MAIN: mov #1, r1
+MAIN: inc r1
+ jmp NOWHERE
+ add r1
+ .data 5,,6
+ stop
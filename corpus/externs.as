@@ -0,0 +1,31 @@
+; a module that calls into others, every extern is used more than once
+.extern PUTC
+.extern GETC
+.extern OPEN
+.extern CLOSE
+.extern BUF
+.extern LEN
+.entry START
+.entry DONE
+.entry TABLE
+START: jsr OPEN
+ lea BUF, r1
+ mov LEN, r2
+READ: jsr GETC
+ mov r4, BUF
+ cmp r4, #-1
+ bne STORE
+ jmp DONE
+STORE: add #1, r1
+ jsr PUTC
+ dec r2
+ bne READ(r2,LEN)
+ jsr PUTC(BUF,#10)
+ prn LEN
+DONE: jsr CLOSE
+ red BUF
+ not r7
+ jsr CLOSE(r1,BUF)
+ rts
+TABLE: .data 1,2,3,-4,5
+ .string "ext"
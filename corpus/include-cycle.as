@@ -0,0 +1,3 @@
+; a file including itself through ../ is an error, not endless longer paths
+.include "cycle.inc"
+MAIN: stop
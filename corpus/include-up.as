@@ -0,0 +1,9 @@
+; a file included directly and through ../ is one file, expanded once
+.include "regs.inc"
+.include "nested/up.inc"
+MAIN: mov #1, r1
+ twice
+ swap
+ prn r2
+ prn r1
+ stop
@@ -0,0 +1,13 @@
+; macros and externs of included files, one of them included twice
+.include "regs.inc"
+.include "io.inc"
+.entry MAIN
+MAIN: mov #5, r1
+ mov #9, r2
+ swap
+ print
+ zero
+ print
+.include "regs.inc"
+ swap
+ stop
@@ -0,0 +1,22 @@
+; parameterized jumps with every pair of operand kinds, and plain ones
+.entry LOOP
+.extern FAR
+MAIN: mov #7, r1
+LOOP: jmp NEXT(#1,#-2)
+NEXT: bne LOOP(r1,r2)
+ jsr SUB(VAL,r3)
+ jmp FAR(#4,VAL)
+ bne NEXT(r5,#-6)
+ jsr SUB(VAL,VAL)
+ jmp FAR(FAR,r0)
+ jmp LOOP
+ bne FAR
+ jsr SUB
+ dec r1
+ bne LOOP(r1,#0)
+ stop
+SUB: cmp r3, #100
+ bne BACK
+ prn r3
+BACK: rts
+VAL: .data 100,-100
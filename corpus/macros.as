@@ -0,0 +1,39 @@
+; copies a string and counts its characters, the loop bodies are macros
+mcr push
+ mov r1, SAVE1
+ mov r2, SAVE2
+endmcr
+mcr pop
+ mov SAVE1, r1
+ mov SAVE2, r2
+endmcr
+mcr step
+ inc r1
+ inc r2
+ inc COUNT
+endmcr
+mcr copych
+ mov SRC, r3
+ mov r3, DST
+endmcr
+MAIN: clr r3
+ push
+ lea SRC, r1
+ lea DST, r2
+ clr COUNT
+COPY: mov SRC, r3
+ copych
+ step
+ cmp r3, #0
+ bne COPY
+ pop
+ prn COUNT
+ push
+ step
+ pop
+ stop
+SRC: .string "macro heavy"
+DST: .data 0,0,0,0,0,0,0,0,0,0,0,0
+COUNT: .data 0
+SAVE1: .data 0
+SAVE2: .data 0
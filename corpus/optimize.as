@@ -0,0 +1,28 @@
+; peephole cases: folded constants, dropped no-ops and jumps to the next line
+.entry COUNT
+.entry ZERO
+MAIN: mov #3, r1
+ add #4, r1
+ inc r1
+ dec r1
+ sub #2, r1
+ clr CNT
+ inc CNT
+ inc CNT
+ZERO: mov r2, r2
+ add #0, r3
+ jmp NEXT
+NEXT: prn r1
+ clr r4
+ sub #1, r4
+ mov #1, r5
+SKIP: add #1, r5
+ cmp r5, #2
+ bne DONE
+DONE: prn CNT
+ sub #0, CNT
+ jmp ZERO
+ bne SKIP
+ stop
+CNT: .data 0
+COUNT: .data 9
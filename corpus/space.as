@@ -0,0 +1,13 @@
+; reserved buffers, zero filled and filled with a value
+.entry BUF
+.entry END
+MAIN: lea BUF, r1
+ mov #-1, FLAGS
+ lea BIG, r2
+ prn END
+ stop
+BUF: .space 6
+FLAGS: .fill 4, -1
+ .space 1
+BIG: .fill 300, 7
+END: .data 5
@@ -0,0 +1,174 @@
+/* clock_gettime is POSIX */
+#define _POSIX_C_SOURCE 199309L
+#include "../inc/disasm.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define REPEATS 3
+/* words of the generated image. */
+#define BENCH_WORDS 1000000UL
+#define BENCH_DATA_WORDS 1000UL
+
+/* The state of the generator, deterministic for a given seed. */
+static unsigned long bench_random_state = 1;
+
+/**
+ * @brief returns the next pseudo random number, xorshift.
+ */
+static unsigned long bench_random(void) {
+    bench_random_state ^= (bench_random_state << 13) & 0xffffffffUL;
+    bench_random_state ^= bench_random_state >> 17;
+    bench_random_state ^= (bench_random_state << 5) & 0xffffffffUL;
+    return bench_random_state & 0xffffffffUL;
+}
+
+/**
+ * @brief returns the seconds of the monotonic clock.
+ */
+static double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief returns an operand word of an addressing mode, 0 immediate, 1 symbol and 3 register.
+ */
+static unsigned short bench_operand(int mode,int shift) {
+    switch(mode) {
+    case 0:
+        return (bench_random() % 1000) << 2;
+    case 1:
+        /* a tenth of the symbols are externs */
+        return bench_random() % 10 ? ((100 + bench_random() % 3000) << 2) | 2 : 1;
+    default:
+        return (bench_random() % 8) << shift;
+    }
+}
+
+/**
+ * @brief fills code with random instructions, the way the assembler encodes them.
+ *
+ * @param code
+ * @param words
+ * @return size_t the words used, an instruction is not split at the end.
+ */
+static size_t bench_generate(unsigned short *code,size_t words) {
+    static const int modes[] = {0,1,3};
+    size_t n = 0;
+    int opcode, src, dst, p1, p2;
+    while(n + 4 <= words) {
+        opcode = bench_random() % 16;
+        if(opcode <= 4) {
+            src = opcode == 4 ? 1 : modes[bench_random() % 3];
+            dst = modes[1 + bench_random() % 2];
+            code[n++] = opcode << 6 | src << 4 | dst << 2;
+            if(src == 3 && dst == 3) {
+                code[n++] = (bench_random() % 8) << 8 | (bench_random() % 8) << 2;
+            }else {
+                code[n++] = bench_operand(src,8);
+                code[n++] = bench_operand(dst,2);
+            }
+        }else if(opcode <= 13) {
+            if((opcode == 9 || opcode == 10 || opcode == 13) && bench_random() % 2) {
+                p1 = modes[bench_random() % 3];
+                p2 = modes[bench_random() % 3];
+                code[n++] = p1 << 12 | p2 << 10 | opcode << 6 | 2 << 2;
+                code[n++] = bench_operand(1,2);
+                if(p1 == 3 && p2 == 3) {
+                    code[n++] = (bench_random() % 8) << 8 | (bench_random() % 8) << 2;
+                }else {
+                    code[n++] = bench_operand(p1,8);
+                    code[n++] = bench_operand(p2,2);
+                }
+            }else {
+                dst = modes[1 + bench_random() % 2];
+                code[n++] = opcode << 6 | dst << 2;
+                code[n++] = bench_operand(dst,2);
+            }
+        }else {
+            code[n++] = opcode << 6;
+        }
+    }
+    return n;
+}
+
+/**
+ * @brief prints a disassembler to a stream repeats times.
+ *
+ * @param name
+ * @param d
+ * @param out
+ * @param repeats
+ * @return int 0 on success, 1 otherwise.
+ */
+static int bench_run(const char *name,disasm d,FILE *out,int repeats) {
+    double start, seconds, best = 0;
+    int r, failed = 0;
+    for(r=0;r<repeats;r++) {
+        start = bench_now();
+        failed |= disasm_print(d,out) != 0;
+        seconds = bench_now() - start;
+        if(r == 0 || seconds < best)
+            best = seconds;
+    }
+    fprintf(out == stdout ? stderr : stdout,"%-24s words=%-9lu %9.4f s %14.0f words/s\n",name,(unsigned long)disasm_words(d),best,disasm_words(d) / best);
+    return failed;
+}
+
+int main(int argc,char **argv) {
+    unsigned short *code, *data;
+    size_t words = BENCH_WORDS, code_words, k;
+    FILE *out = NULL;
+    disasm d;
+    int i, repeats = REPEATS, print = 0, programs = 0, failed = 0;
+    for(i=1;i<argc && argv[i][0] == '-';i++) {
+        if(strcmp(argv[i],"-p") == 0) {
+            print = 1;
+        }else if(i + 1 < argc && strcmp(argv[i],"-n") == 0) {
+            words = strtoul(argv[++i],NULL,10);
+        }else if(i + 1 < argc && strcmp(argv[i],"-r") == 0) {
+            repeats = atoi(argv[++i]);
+        }else {
+            fprintf(stderr,"usage: %s [-p] [-n words] [-r repeats] [base_name]...\n",argv[0]);
+            return 1;
+        }
+    }
+    /* -p prints the listing once, otherwise the output is discarded so only the disassembler is measured */
+    if(print)
+        repeats = 1;
+    out = print ? stdout : fopen("/dev/null","w");
+    if(!out)
+        return 1;
+    for(;i<argc;i++,programs++) {
+        d = disasm_open(argv[i]);
+        if(!d) {
+            fprintf(stderr,"%s: cannot read %s.ob\n",argv[i],argv[i]);
+            failed = 1;
+            continue;
+        }
+        failed |= bench_run(argv[i],d,out,repeats);
+        disasm_destroy(d);
+    }
+    if(programs == 0) {
+        code = malloc(words * sizeof(unsigned short) + 1);
+        data = malloc(BENCH_DATA_WORDS * sizeof(unsigned short));
+        if(!code || !data)
+            return 1;
+        code_words = bench_generate(code,words);
+        for(k=0;k<BENCH_DATA_WORDS;k++)
+            data[k] = bench_random() & 0x3fff;
+        d = disasm_create(code,code_words,data,BENCH_DATA_WORDS);
+        if(!d)
+            return 1;
+        failed |= bench_run("generated",d,out,repeats);
+        disasm_destroy(d);
+        free(code);
+        free(data);
+    }
+    if(out != stdout)
+        fclose(out);
+    return failed;
+}
@@ -0,0 +1,571 @@
+#include "../inc/disasm.h"
+#include "../../lang-engine/inc/lang-engine.h"
+#include "../../utilities/mem/inc/mem.h"
+#include "../../utilities/string-pool/inc/str-pool.h"
+#include "../../utilities/source-buffer/inc/source-buffer.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* characters of a word in the object file, without the new line */
+#define DISASM_OB_WORD_LEN 14
+/* the addressing mode of a jump with parameters, the assembler encodes it as a plain 2 */
+#define DISASM_MODE_JUMP 2
+/* the A,R,E bits of an operand word */
+#define DISASM_ARE_ABSOLUTE 0
+#define DISASM_ARE_EXTERNAL 1
+#define DISASM_ARE_RELOCATABLE 2
+/* first words that differ only in their A,R,E bits share a form, the bits must be 0 */
+#define DISASM_FORMS 4096
+/* operand addresses take 12 bits */
+#define DISASM_ADDRESSES 4096
+/* the output is written in blocks of this size */
+#define DISASM_OUT_BUFFER (64 * 1024)
+/* the longest line, an address, a label and a jump with two parameters */
+#define DISASM_MAX_LINE 160
+
+/* mnemonics in the order of enum inst_tag, the opcode is the index. */
+static const char *const disasm_mnemonics[16] = {
+    "mov","cmp","add","sub","lea","not","clr","inc","dec","jmp","bne","red","prn","jsr","rts","stop"
+};
+
+/**
+ * @brief what the first word of an instruction says, precomputed for every first word.
+ * @param size words of the instruction, 0 if the word cannot start one.
+ * @param opcode
+ * @param modes the addressing modes of the source, destination and the two parameters, DISASM_MODE_JUMP means none.
+ * @param operands amount of operands, 0 to 2.
+ * @param shared non zero if two register operands share a word.
+ */
+struct disasm_form {
+    unsigned char   size;
+    unsigned char   opcode;
+    unsigned char   modes[4];
+    unsigned char   operands;
+    unsigned char   shared;
+};
+
+/* The disassembler structure. */
+struct disasm {
+    unsigned short     *words;                      /* The code and then the data. */
+    size_t              code_words;
+    size_t              data_words;
+    size_t              addresses;                  /* Size of the tables indexed by address. */
+    str_pool            names;
+    str_handle         *labels;                     /* The name of every address, NULL for none. */
+    str_handle         *externs;                    /* The extern of every operand word, NULL for none. */
+    unsigned char      *referenced;                 /* Non zero for every address an operand refers to. */
+    struct disasm_form  forms[DISASM_FORMS];
+};
+
+/* The output buffer. */
+struct disasm_writer {
+    FILE   *out;
+    size_t  len;
+    int     error;
+    char    buffer[DISASM_OUT_BUFFER];
+};
+
+/**
+ * @brief Fills the form of every first word, following the rules assembler_encode_line writes them by.
+ *
+ * @param forms The forms
+ */
+static void disasm_build_forms(struct disasm_form *forms) {
+    unsigned int index;
+    int opcode, src, dst, p1, p2;
+    struct disasm_form *form;
+    for(index=0;index<DISASM_FORMS;index++) {
+        form    = &forms[index];
+        p1      = (index >> 10) & 3;
+        p2      = (index >> 8) & 3;
+        opcode  = (index >> 4) & 0xf;
+        src     = (index >> 2) & 3;
+        dst     = index & 3;
+        memset(form,0,sizeof(struct disasm_form));
+        form->opcode    = opcode;
+        form->modes[0]  = form->modes[1] = form->modes[2] = form->modes[3] = DISASM_MODE_JUMP;
+        if(is_i_tag_groupA(opcode)) {
+            if(p1 || p2 || src == DISASM_MODE_JUMP || dst == DISASM_MODE_JUMP)
+                continue;
+            form->modes[0]  = src;
+            form->modes[1]  = dst;
+            form->operands  = 2;
+            form->shared    = src == tag_arg_tag_register && dst == tag_arg_tag_register;
+            form->size      = form->shared ? 2 : 3;
+        }else if(is_i_tag_groupB(opcode)) {
+            if(src)
+                continue;
+            form->operands = 1;
+            form->modes[1] = dst;
+            form->size     = 2;
+            if(dst == DISASM_MODE_JUMP) {
+                if((opcode != tag_jmp && opcode != tag_bne && opcode != tag_jsr) || p1 == DISASM_MODE_JUMP || p2 == DISASM_MODE_JUMP)
+                    continue;
+                form->modes[1] = tag_arg_tag_symbol;
+                form->modes[2] = p1;
+                form->modes[3] = p2;
+                form->shared   = p1 == tag_arg_tag_register && p2 == tag_arg_tag_register;
+                form->size     = form->shared ? 3 : 4;
+            }else if(p1 || p2) {
+                continue;
+            }
+        }else {
+            if(p1 || p2 || src || dst)
+                continue;
+            form->size = 1;
+        }
+    }
+}
+
+/**
+ * @brief Creates a disassembler without an image.
+ *
+ * @param code_words Words of code
+ * @param data_words Words of data
+ * @return disasm The disassembler
+ */
+static disasm disasm_alloc(size_t code_words,size_t data_words) {
+    disasm d = mem_calloc(mem_tag_disasm,1,sizeof(struct disasm));
+    if(!d)
+        return NULL;
+    d->code_words = code_words;
+    d->data_words = data_words;
+    d->addresses  = DISASM_BASE_ADDR + code_words + data_words;
+    if(d->addresses < DISASM_ADDRESSES)
+        d->addresses = DISASM_ADDRESSES;
+    d->words      = mem_malloc(mem_tag_disasm,(code_words + data_words + 1) * sizeof(unsigned short));
+    d->labels     = mem_calloc(mem_tag_disasm,d->addresses,sizeof(str_handle));
+    d->externs    = mem_calloc(mem_tag_disasm,d->addresses,sizeof(str_handle));
+    d->referenced = mem_calloc(mem_tag_disasm,d->addresses,1);
+    d->names      = str_pool_create();
+    if(!d->words || !d->labels || !d->externs || !d->referenced || !d->names) {
+        disasm_destroy(d);
+        return NULL;
+    }
+    disasm_build_forms(d->forms);
+    return d;
+}
+
+/**
+ * @brief Creates a disassembler of a binary image.
+ *
+ * @param code The code
+ * @param code_words Words of code
+ * @param data The data
+ * @param data_words Words of data
+ * @return disasm The disassembler
+ */
+disasm disasm_create(const unsigned short *code,size_t code_words,const unsigned short *data,size_t data_words) {
+    disasm d = disasm_alloc(code_words,data_words);
+    size_t i;
+    if(!d)
+        return NULL;
+    for(i=0;i<code_words;i++)
+        d->words[i] = code[i] & 0x3fff;
+    for(i=0;i<data_words;i++)
+        d->words[code_words + i] = data[i] & 0x3fff;
+    return d;
+}
+
+/**
+ * @brief Reads the labels of a .ent or .ext file, lines of a name and an address.
+ *
+ * @param d The disassembler
+ * @param file_name The file, a missing file has no labels
+ * @param add disasm_add_label or disasm_add_extern
+ */
+static void disasm_read_labels(disasm d,const char *file_name,int (*add)(disasm,const char *,unsigned int)) {
+    char name[max_symbol_len + 2];
+    unsigned int address;
+    FILE *in = fopen(file_name,"r");
+    if(!in)
+        return;
+    while(fscanf(in,"%31s %u",name,&address) == 2)
+        add(d,name,address);
+    fclose(in);
+}
+
+/**
+ * @brief Parses a count of the header of an object file, the contents are not null terminated.
+ *
+ * @param it The cursor, advanced past the count
+ * @param end The end of the contents
+ * @return unsigned long The count
+ */
+static unsigned long disasm_parse_count(const char **it,const char *end) {
+    unsigned long count = 0;
+    while(*it < end && (**it == ' ' || **it == '\t'))
+        (*it)++;
+    while(*it < end && **it >= '0' && **it <= '9')
+        count = count * 10 + (*(*it)++ - '0');
+    return count;
+}
+
+/**
+ * @brief Creates a disassembler of an object file and its labels.
+ *
+ * @param base_name The base name of the files
+ * @return disasm The disassembler
+ */
+disasm disasm_open(const char *base_name) {
+    char *file_name = mem_malloc(mem_tag_disasm,strlen(base_name) + 5);
+    source_buffer ob = NULL;
+    const char *it, *end;
+    unsigned long code_words, data_words;
+    unsigned int word;
+    size_t i, total;
+    int k, error = 1;
+    disasm d = NULL;
+    if(file_name)
+        ob = source_buffer_open(strcat(strcpy(file_name,base_name),".ob"));
+    if(ob) {
+        it  = source_buffer_begin(ob);
+        end = source_buffer_end(ob);
+        /* the header holds the amount of code and data words, then a word per line with an empty line after the code and after the data */
+        code_words = disasm_parse_count(&it,end);
+        data_words = disasm_parse_count(&it,end);
+        total      = code_words + data_words;
+        if(it <= end && total < (size_t)(end - it))
+            d = disasm_alloc(code_words,data_words);
+        for(i=0;d && i<total;i++) {
+            while(it < end && (*it == '\n' || *it == '\r' || *it == ' ' || *it == '\t'))
+                it++;
+            if(end - it < DISASM_OB_WORD_LEN)
+                break;
+            /* '/' is odd and '.' is even, so the low bit of every character is its bit */
+            for(word=0,k=0;k<DISASM_OB_WORD_LEN;k++) {
+                if(it[k] != '/' && it[k] != '.')
+                    break;
+                word = (word << 1) | (it[k] & 1);
+            }
+            if(k < DISASM_OB_WORD_LEN)
+                break;
+            d->words[i] = word;
+            it += DISASM_OB_WORD_LEN;
+        }
+        error = !d || i < total;
+        source_buffer_close(ob);
+    }
+    if(!error) {
+        disasm_read_labels(d,strcat(strcpy(file_name,base_name),".ent"),disasm_add_label);
+        disasm_read_labels(d,strcat(strcpy(file_name,base_name),".ext"),disasm_add_extern);
+    }else if(d) {
+        disasm_destroy(d);
+        d = NULL;
+    }
+    mem_free(file_name);
+    return d;
+}
+
+/**
+ * @brief Names an address.
+ *
+ * @param d The disassembler
+ * @param name The name
+ * @param address The address
+ * @return int 0 on success, -1 otherwise
+ */
+int disasm_add_label(disasm d,const char *name,unsigned int address) {
+    if(address >= d->addresses)
+        return -1;
+    d->labels[address] = str_pool_intern(d->names,name);
+    return d->labels[address] ? 0 : -1;
+}
+
+/**
+ * @brief Names the extern an operand word refers to.
+ *
+ * @param d The disassembler
+ * @param name The extern
+ * @param address The address of the operand word
+ * @return int 0 on success, -1 otherwise
+ */
+int disasm_add_extern(disasm d,const char *name,unsigned int address) {
+    if(address < DISASM_BASE_ADDR || address >= DISASM_BASE_ADDR + d->code_words)
+        return -1;
+    d->externs[address] = str_pool_intern(d->names,name);
+    return d->externs[address] ? 0 : -1;
+}
+
+/**
+ * @brief Returns the words of the image.
+ *
+ * @param d The disassembler
+ * @return size_t The words
+ */
+size_t disasm_words(disasm d) {
+    return d->code_words + d->data_words;
+}
+
+/**
+ * @brief Returns the form of the instruction at a code index, checking its operand words.
+ *
+ * @param d The disassembler
+ * @param index The index of the first word in the code
+ * @return const struct disasm_form* The form, NULL if the word does not start a well formed instruction
+ */
+static const struct disasm_form *disasm_decode(disasm d,size_t index) {
+    const unsigned short *words = d->words + index;
+    const struct disasm_form *form;
+    int i, are;
+    size_t w;
+    if(words[0] & 3)
+        return NULL;
+    form = &d->forms[words[0] >> 2];
+    if(form->size == 0 || index + form->size > d->code_words)
+        return NULL;
+    /* a register or an immediate operand word is absolute, a symbol is relocatable or external */
+    for(i=0,w=1;i<4;i++) {
+        if(form->modes[i] == DISASM_MODE_JUMP)
+            continue;
+        are = words[w] & 3;
+        if(form->modes[i] == tag_arg_tag_symbol ? are != DISASM_ARE_RELOCATABLE && are != DISASM_ARE_EXTERNAL : are != DISASM_ARE_ABSOLUTE)
+            return NULL;
+        if(!(form->shared && (i == 0 || i == 2)))
+            w++;
+    }
+    return form;
+}
+
+/**
+ * @brief Writes text to the output buffer.
+ *
+ * @param w The writer
+ * @param text The text
+ * @param len Its length
+ */
+static void disasm_put(struct disasm_writer *w,const char *text,size_t len) {
+    if(w->len + len > DISASM_OUT_BUFFER) {
+        if(fwrite(w->buffer,1,w->len,w->out) != w->len)
+            w->error = 1;
+        w->len = 0;
+    }
+    memcpy(w->buffer + w->len,text,len);
+    w->len += len;
+}
+
+/**
+ * @brief Formats a number.
+ *
+ * @param text Output, at least 12 characters
+ * @param value The number
+ * @param width Zeros are padded up to this many digits
+ * @return size_t The length
+ */
+static size_t disasm_format_number(char *text,long value,int width) {
+    char digits[24];
+    int n = 0;
+    size_t len = 0;
+    unsigned long magnitude = value < 0 ? -(unsigned long)value : (unsigned long)value;
+    do {
+        digits[n++] = '0' + magnitude % 10;
+        magnitude /= 10;
+    } while(magnitude);
+    while(n < width)
+        digits[n++] = '0';
+    if(value < 0)
+        text[len++] = '-';
+    while(n)
+        text[len++] = digits[--n];
+    return len;
+}
+
+/**
+ * @brief Formats an address by its name, or as L and the address.
+ *
+ * @param d The disassembler
+ * @param text Output
+ * @param address The address
+ * @return size_t The length
+ */
+static size_t disasm_format_address(disasm d,char *text,unsigned int address) {
+    if(address < d->addresses && d->labels[address]) {
+        memcpy(text,d->labels[address]->string,d->labels[address]->len);
+        return d->labels[address]->len;
+    }
+    text[0] = 'L';
+    return 1 + disasm_format_number(text + 1,address,4);
+}
+
+/**
+ * @brief Formats an operand.
+ *
+ * @param d The disassembler
+ * @param text Output
+ * @param mode The addressing mode
+ * @param word The operand word
+ * @param shift Where the register number is in the word
+ * @param address The address of the operand word
+ * @return size_t The length
+ */
+static size_t disasm_format_operand(disasm d,char *text,int mode,unsigned int word,int shift,unsigned int address) {
+    size_t len;
+    switch(mode) {
+    case tag_arg_tag_register:
+        text[0] = 'r';
+        text[1] = '0' + ((word >> shift) & 7);
+        return 2;
+    case tag_arg_tag_constant:
+        text[0] = '#';
+        return 1 + disasm_format_number(text + 1,(long)((((word >> 2) & 0xfff) ^ 0x800)) - 0x800,0);
+    default:
+        if((word & 3) == DISASM_ARE_EXTERNAL) {
+            if(d->externs[address]) {
+                memcpy(text,d->externs[address]->string,d->externs[address]->len);
+                return d->externs[address]->len;
+            }
+            /* an extern without a .ext line, named by the word that refers to it */
+            memcpy(text,"EXTERN@",7);
+            len = 7;
+            return len + disasm_format_number(text + len,address,4);
+        }
+        return disasm_format_address(d,text,word >> 2);
+    }
+}
+
+/**
+ * @brief Formats the operands of an instruction, in the order assembler_encode_line writes their words.
+ *
+ * @param d The disassembler
+ * @param text Output
+ * @param form The form of the instruction
+ * @param index The index of its first word in the code
+ * @return size_t The length
+ */
+static size_t disasm_format_operands(disasm d,char *text,const struct disasm_form *form,size_t index) {
+    const unsigned short *words = d->words + index;
+    unsigned int address = DISASM_BASE_ADDR + index;
+    size_t len = 0;
+    if(form->operands == 2) {
+        text[len++] = ' ';
+        len += disasm_format_operand(d,text + len,form->modes[0],words[1],8,address + 1);
+        text[len++] = ',';
+        text[len++] = ' ';
+        len += disasm_format_operand(d,text + len,form->modes[1],words[form->size - 1],2,address + form->size - 1);
+    }else if(form->operands == 1) {
+        text[len++] = ' ';
+        len += disasm_format_operand(d,text + len,form->modes[1],words[1],2,address + 1);
+        if(form->modes[2] != DISASM_MODE_JUMP) {
+            text[len++] = '(';
+            len += disasm_format_operand(d,text + len,form->modes[2],words[2],8,address + 2);
+            text[len++] = ',';
+            len += disasm_format_operand(d,text + len,form->modes[3],words[form->size - 1],2,address + form->size - 1);
+            text[len++] = ')';
+        }
+    }
+    return len;
+}
+
+/**
+ * @brief Marks every address a relocatable operand refers to, so it gets a label.
+ *
+ * @param d The disassembler
+ */
+static void disasm_mark_references(disasm d) {
+    const struct disasm_form *form;
+    unsigned int word;
+    size_t index = 0, w;
+    int i;
+    while(index < d->code_words) {
+        form = disasm_decode(d,index);
+        if(!form) {
+            index++;
+            continue;
+        }
+        for(i=0,w=1;i<4;i++) {
+            if(form->modes[i] == DISASM_MODE_JUMP)
+                continue;
+            word = d->words[index + w];
+            if(form->modes[i] == tag_arg_tag_symbol && (word & 3) == DISASM_ARE_RELOCATABLE)
+                d->referenced[word >> 2] = 1;
+            if(!(form->shared && (i == 0 || i == 2)))
+                w++;
+        }
+        index += form->size;
+    }
+}
+
+/**
+ * @brief Formats the start of a line, the address and the label of the address.
+ *
+ * @param d The disassembler
+ * @param text Output
+ * @param address The address
+ * @return size_t The length
+ */
+static size_t disasm_format_line_start(disasm d,char *text,unsigned int address) {
+    size_t len = disasm_format_number(text,address,4);
+    text[len++] = '\t';
+    if(d->labels[address] || d->referenced[address]) {
+        len += disasm_format_address(d,text + len,address);
+        text[len++] = ':';
+    }
+    text[len++] = '\t';
+    return len;
+}
+
+/**
+ * @brief Prints the image as source lines.
+ *
+ * @param d The disassembler
+ * @param out The stream
+ * @return int 0 on success, -1 otherwise
+ */
+int disasm_print(disasm d,FILE *out) {
+    struct disasm_writer *w = mem_malloc(mem_tag_disasm,sizeof(struct disasm_writer));
+    char line[DISASM_MAX_LINE + max_symbol_len * 4];
+    const struct disasm_form *form;
+    size_t index, len;
+    int error;
+    if(!w)
+        return -1;
+    w->out   = out;
+    w->len   = 0;
+    w->error = 0;
+    memset(d->referenced,0,d->addresses);
+    disasm_mark_references(d);
+    for(index=0;index<d->code_words;index += form ? form->size : 1) {
+        len  = disasm_format_line_start(d,line,DISASM_BASE_ADDR + index);
+        form = disasm_decode(d,index);
+        if(form) {
+            len += strlen(strcpy(line + len,disasm_mnemonics[form->opcode]));
+            len += disasm_format_operands(d,line + len,form,index);
+        }else {
+            memcpy(line + len,".word ",6);
+            len += 6;
+            len += disasm_format_number(line + len,d->words[index],0);
+        }
+        line[len++] = '\n';
+        disasm_put(w,line,len);
+    }
+    for(index=d->code_words;index<d->code_words + d->data_words;index++) {
+        len  = disasm_format_line_start(d,line,DISASM_BASE_ADDR + index);
+        memcpy(line + len,".data ",6);
+        len += 6;
+        len += disasm_format_number(line + len,(long)((d->words[index] ^ 0x2000)) - 0x2000,0);
+        line[len++] = '\n';
+        disasm_put(w,line,len);
+    }
+    if(w->len && fwrite(w->buffer,1,w->len,out) != w->len)
+        w->error = 1;
+    error = w->error || fflush(out) ? -1 : 0;
+    mem_free(w);
+    return error;
+}
+
+/**
+ * @brief Frees the disassembler.
+ *
+ * @param d The disassembler
+ */
+void disasm_destroy(disasm d) {
+    if(!d)
+        return;
+    mem_free(d->words);
+    mem_free(d->labels);
+    mem_free(d->externs);
+    mem_free(d->referenced);
+    if(d->names)
+        str_pool_destroy(d->names);
+    mem_free(d);
+}
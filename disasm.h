@@ -0,0 +1,79 @@
+#ifndef maman14_disasm_h
+#define maman14_disasm_h
+
+#include <stdio.h>
+#include <stddef.h>
+
+/* the address the code of an image starts at, the same address the assembler counts from. */
+#define DISASM_BASE_ADDR 100
+
+/* opaque struct */
+struct disasm;
+typedef struct disasm * disasm;
+
+/**
+ * @brief creates a disassembler of a binary image, the code is at DISASM_BASE_ADDR with the data right after it.
+ *
+ * @param code words of the code, only their low 14 bits are used.
+ * @param code_words
+ * @param data words of the data.
+ * @param data_words
+ * @return disasm returns NULL on allocation failure.
+ */
+disasm disasm_create(const unsigned short *code,size_t code_words,const unsigned short *data,size_t data_words);
+
+/**
+ * @brief creates a disassembler of base_name.ob, with the labels of base_name.ent and base_name.ext if there are.
+ *
+ * @param base_name
+ * @return disasm returns NULL if the .ob file cannot be read or is malformed, or on allocation failure.
+ */
+disasm disasm_open(const char *base_name);
+
+/**
+ * @brief names an address, e.g. an entry.
+ *
+ * @param d
+ * @param name
+ * @param address
+ * @return int 0 on success, -1 if the address is outside the image or on allocation failure.
+ */
+int disasm_add_label(disasm d,const char *name,unsigned int address);
+
+/**
+ * @brief names the extern an operand word refers to.
+ *
+ * @param d
+ * @param name
+ * @param address the address of the operand word, as in the .ext file.
+ * @return int 0 on success, -1 if the address is outside the code or on allocation failure.
+ */
+int disasm_add_extern(disasm d,const char *name,unsigned int address);
+
+/**
+ * @brief returns the words of the image, code and data.
+ *
+ * @param d
+ * @return size_t
+ */
+size_t disasm_words(disasm d);
+
+/**
+ * @brief prints the image as source lines, every line starts with its address.
+ * an address an operand refers to is printed by its name, or as L and the address if it has none.
+ * a word that does not start a well formed instruction is printed as .word, and the data as .data.
+ *
+ * @param d
+ * @param out
+ * @return int 0 on success, -1 if writing failed.
+ */
+int disasm_print(disasm d,FILE *out);
+
+/**
+ * @brief frees the disassembler.
+ *
+ * @param d
+ */
+void disasm_destroy(disasm d);
+
+#endif
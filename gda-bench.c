@@ -0,0 +1,370 @@
+#include "../inc/gda.h"
+#include "../inc/gda-typed.h"
+#include "../../mem/inc/mem.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define LOOKUPS 2000
+/* a linear search scans up to n elements, so the lookups are cut down to about this many elements scanned at large sizes. */
+#define LOOKUP_WORK 200000000UL
+/* lookups of the symbol table workload, binary searches are cheap enough for more of them. */
+#define SYMBOL_LOOKUPS 100000
+/* the churn workload does at most this many delete and insert pairs, and at most CHURN_WORK elements moved. */
+#define CHURN_OPS 1000
+#define CHURN_WORK 100000000UL
+/* an odd multiplier is a bijection on 32 bits, so it scatters keys without repeating one. */
+#define BENCH_SCATTER(i) (((unsigned long)(i) * 2654435761UL) & 0xffffffffUL)
+
+/* results are accumulated here so the measured loops are not optimized away. */
+static volatile unsigned long bench_sink;
+
+/* The element both containers are measured with, shaped like struct symbol. */
+struct bench_elem {
+    unsigned long   key;
+    unsigned int    addr;
+    int             line_def;
+};
+
+#define bench_elem_cmp(a,b) ((a)->key != (b)->key)
+#define bench_elem_hash(a) ((a)->key * 2654435761UL)
+
+GDA_DECLARE(elem,struct bench_elem);
+GDA_DEFINE(elem,struct bench_elem,bench_elem_cmp,bench_elem_hash)
+
+/* gda callbacks, the same shape as the symbol table ones in the assembler. */
+static void *bench_elem_ctor(const void *copy) {
+    return memcpy(mem_malloc(mem_tag_symbols,sizeof(struct bench_elem)),copy,sizeof(struct bench_elem));
+}
+static void bench_elem_dtor(void *copy) {
+    mem_free(copy);
+}
+static int bench_elem_compar(const void *a,const void *b) {
+    const struct bench_elem *ap = a;
+    const struct bench_elem *bp = b;
+    return ap->key != bp->key;
+}
+/* orders by key, like the symbol table orders by name id. */
+static int bench_elem_order(const void *a,const void *b) {
+    const struct bench_elem *ap = a;
+    const struct bench_elem *bp = b;
+    return (ap->key > bp->key) - (ap->key < bp->key);
+}
+/* equal when the keys are in the same class of ten, so a delete removes a tenth of the elements. */
+static int bench_elem_class(const void *a,const void *b) {
+    const struct bench_elem *ap = a;
+    const struct bench_elem *bp = b;
+    return ap->key % 10 != bp->key % 10;
+}
+/* a word of machine code, the same shape as the code and data sections in the assembler. */
+static void *bench_word_ctor(const void *copy) {
+    return memcpy(mem_malloc(mem_tag_code,sizeof(unsigned short)),copy,sizeof(unsigned short));
+}
+
+/**
+ * @brief returns the seconds elapsed since start.
+ */
+static double bench_elapsed(clock_t start) {
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+/**
+ * @brief prints one result line.
+ */
+static void bench_report(const char *container,const char *op,size_t n,size_t ops,double seconds) {
+    printf("%-6s %-8s n=%-9lu %12.1f ns/op\n",container,op,(unsigned long)n,ops ? seconds * 1e9 / ops : 0.0);
+}
+
+/**
+ * @brief returns the amount of lookups to run on n elements, at most LOOKUPS and at least one.
+ */
+static size_t bench_lookups(size_t n) {
+    size_t lookups = LOOKUP_WORK / n;
+    if(lookups > LOOKUPS)
+        lookups = LOOKUPS;
+    return lookups ? lookups : 1;
+}
+
+/**
+ * @brief prints the memory a workload held at its peak, per element. only measured when built with ASM_MEM, n/a otherwise.
+ */
+static void bench_report_memory(const char *container,const char *op,size_t n,const struct mem_stats *snapshot) {
+#ifdef ASM_MEM
+    struct mem_stats stats;
+    mem_since(&stats,snapshot);
+    printf("%-6s %-8s n=%-9lu %12.1f B/elem %9.2f allocs/elem\n",container,op,(unsigned long)n,
+           n ? (double)stats.total.peak / n : 0.0,n ? (double)stats.total.allocations / n : 0.0);
+#else
+    (void)snapshot;
+    printf("%-6s %-8s n=%-9lu %12s B/elem %9s allocs/elem\n",container,op,(unsigned long)n,"n/a","n/a");
+#endif
+}
+
+/**
+ * @brief runs insert, hit and miss lookups, iteration and destroy on the generic gda.
+ */
+static void bench_run_gda(size_t n) {
+    gda g;
+    struct bench_elem e = {0};
+    void *const *begin;
+    void *const *end;
+    unsigned long sum = 0;
+    size_t i, lookups = bench_lookups(n);
+    clock_t start;
+
+    start = clock();
+    g = gda_create(bench_elem_ctor,bench_elem_dtor,bench_elem_compar);
+    for(i=0;i<n;i++) {
+        e.key = i;
+        gda_insert(g,&e);
+    }
+    bench_report("gda","insert",n,n,bench_elapsed(start));
+
+    start = clock();
+    for(i=0;i<lookups;i++) {
+        e.key = (i * 7919) % n;
+        sum += gda_search(g,&e) != NULL;
+    }
+    bench_report("gda","hit",n,lookups,bench_elapsed(start));
+
+    start = clock();
+    for(i=0;i<lookups;i++) {
+        e.key = n + i;
+        sum += gda_search(g,&e) != NULL;
+    }
+    bench_report("gda","miss",n,lookups,bench_elapsed(start));
+
+    start = clock();
+    gda_for_each(g,begin,end) {
+        sum += ((struct bench_elem *)*begin)->key;
+    }
+    bench_report("gda","iterate",n,n,bench_elapsed(start));
+
+    start = clock();
+    gda_destroy(g);
+    bench_report("gda","destroy",n,n,bench_elapsed(start));
+    bench_sink += sum;
+}
+
+/**
+ * @brief runs the same workload on the type specialized gda.
+ */
+static void bench_run_typed(size_t n) {
+    elem_gda g;
+    struct bench_elem e = {0};
+    struct bench_elem *const *it;
+    unsigned long sum = 0;
+    size_t i, lookups = bench_lookups(n);
+    clock_t start;
+
+    start = clock();
+    g = elem_gda_create();
+    for(i=0;i<n;i++) {
+        e.key = i;
+        elem_gda_insert(g,&e);
+    }
+    bench_report("typed","insert",n,n,bench_elapsed(start));
+
+    start = clock();
+    for(i=0;i<lookups;i++) {
+        e.key = (i * 7919) % n;
+        sum += elem_gda_search(g,&e) != NULL;
+    }
+    bench_report("typed","hit",n,lookups,bench_elapsed(start));
+
+    start = clock();
+    for(i=0;i<lookups;i++) {
+        e.key = n + i;
+        sum += elem_gda_search(g,&e) != NULL;
+    }
+    bench_report("typed","miss",n,lookups,bench_elapsed(start));
+
+    start = clock();
+    gda_typed_for_each(elem,g,it) {
+        sum += (*it)->key;
+    }
+    bench_report("typed","iterate",n,n,bench_elapsed(start));
+
+    start = clock();
+    elem_gda_destroy(g);
+    bench_report("typed","destroy",n,n,bench_elapsed(start));
+    bench_sink += sum;
+}
+
+/**
+ * @brief an append only buffer of words, like the code and data sections: insert, iterate and destroy.
+ */
+static void bench_run_words(size_t n) {
+    gda g;
+    struct mem_stats snapshot;
+    unsigned short word;
+    void *const *begin;
+    void *const *end;
+    unsigned long sum = 0;
+    size_t i;
+    clock_t start;
+
+    mem_snapshot(&snapshot);
+    start = clock();
+    g = gda_create(bench_word_ctor,bench_elem_dtor,NULL);
+    for(i=0;i<n;i++) {
+        word = (unsigned short)i;
+        gda_insert(g,&word);
+    }
+    bench_report("words","insert",n,n,bench_elapsed(start));
+    bench_report_memory("words","memory",n,&snapshot);
+
+    start = clock();
+    gda_for_each(g,begin,end) {
+        sum += *(unsigned short *)*begin;
+    }
+    bench_report("words","iterate",n,n,bench_elapsed(start));
+
+    start = clock();
+    gda_destroy(g);
+    bench_report("words","destroy",n,n,bench_elapsed(start));
+    bench_sink += sum;
+}
+
+/**
+ * @brief a symbol table: scattered inserts in bulk load mode, one sort, then hit and miss lookups.
+ */
+static void bench_run_symbols(size_t n) {
+    gda g;
+    struct mem_stats snapshot;
+    struct bench_elem e = {0};
+    unsigned long sum = 0;
+    size_t i;
+    clock_t start;
+
+    mem_snapshot(&snapshot);
+    start = clock();
+    g = gda_create(bench_elem_ctor,bench_elem_dtor,bench_elem_order);
+    gda_set_bulk_load(g,1);
+    for(i=0;i<n;i++) {
+        e.key = BENCH_SCATTER(i);
+        gda_insert(g,&e);
+    }
+    bench_report("symtab","insert",n,n,bench_elapsed(start));
+
+    start = clock();
+    gda_sort(g);
+    bench_report("symtab","sort",n,n,bench_elapsed(start));
+    bench_report_memory("symtab","memory",n,&snapshot);
+
+    start = clock();
+    for(i=0;i<SYMBOL_LOOKUPS;i++) {
+        e.key = BENCH_SCATTER(i % n);
+        sum += gda_search(g,&e) != NULL;
+    }
+    bench_report("symtab","hit",n,SYMBOL_LOOKUPS,bench_elapsed(start));
+
+    start = clock();
+    for(i=0;i<SYMBOL_LOOKUPS;i++) {
+        e.key = BENCH_SCATTER(n + i);
+        sum += gda_search(g,&e) != NULL;
+    }
+    bench_report("symtab","miss",n,SYMBOL_LOOKUPS,bench_elapsed(start));
+
+    start = clock();
+    gda_destroy(g);
+    bench_report("symtab","destroy",n,n,bench_elapsed(start));
+    bench_sink += sum;
+}
+
+/**
+ * @brief interleaved deletes and inserts on a full gda, every delete scans and compacts it.
+ */
+static void bench_run_churn(size_t n) {
+    gda g;
+    struct bench_elem e = {0};
+    size_t i, ops = CHURN_WORK / n;
+    clock_t start;
+
+    if(ops > CHURN_OPS)
+        ops = CHURN_OPS;
+    if(ops == 0)
+        ops = 1;
+    g = gda_create(bench_elem_ctor,bench_elem_dtor,bench_elem_compar);
+    for(i=0;i<n;i++) {
+        e.key = i;
+        gda_insert(g,&e);
+    }
+    start = clock();
+    for(i=0;i<ops;i++) {
+        e.key = (i * 7919) % n;
+        gda_delete(g,&e);
+        e.key = n + i;
+        gda_insert(g,&e);
+    }
+    bench_report("churn","del+ins",n,ops,bench_elapsed(start));
+    bench_sink += gda_size(g);
+    gda_destroy(g);
+}
+
+/**
+ * @brief deletes nine tenths of the elements, then iterates over the rest.
+ */
+static void bench_run_sparse(size_t n) {
+    gda g;
+    struct bench_elem e = {0};
+    void *const *begin;
+    void *const *end;
+    unsigned long sum = 0;
+    size_t i;
+    clock_t start;
+
+    g = gda_create(bench_elem_ctor,bench_elem_dtor,bench_elem_class);
+    for(i=0;i<n;i++) {
+        e.key = i;
+        gda_insert(g,&e);
+    }
+    start = clock();
+    for(e.key=1;e.key<10;e.key++)
+        gda_delete(g,&e);
+    bench_report("sparse","delete",n,n,bench_elapsed(start));
+
+    start = clock();
+    gda_for_each(g,begin,end) {
+        sum += ((struct bench_elem *)*begin)->key;
+    }
+    bench_report("sparse","iterate",n,gda_size(g),bench_elapsed(start));
+
+    start = clock();
+    gda_destroy(g);
+    bench_report("sparse","destroy",n,(n + 9) / 10,bench_elapsed(start));
+    bench_sink += sum;
+}
+
+/**
+ * @brief runs every workload at one size.
+ */
+static void bench_run(size_t n) {
+    bench_run_gda(n);
+    bench_run_typed(n);
+    bench_run_words(n);
+    bench_run_symbols(n);
+    bench_run_churn(n);
+    bench_run_sparse(n);
+}
+
+/**
+ * @brief compares gda with the type specialized gda and runs the gda workloads, sizes are given as arguments.
+ * bytes and allocations per element are measured only when built with ASM_MEM.
+ */
+int main(int argc,char **argv) {
+    static const size_t default_sizes[] = {10,100,1000,10000,100000,1000000,10000000};
+    size_t i, n;
+    if(argc > 1) {
+        for(i=1;i<(size_t)argc;i++) {
+            n = strtoul(argv[i],NULL,10);
+            if(n)
+                bench_run(n);
+        }
+    }else {
+        for(i=0;i<sizeof(default_sizes)/sizeof(default_sizes[0]);i++)
+            bench_run(default_sizes[i]);
+    }
+    return 0;
+}
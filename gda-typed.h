@@ -0,0 +1,198 @@
+#ifndef maman14_gda_typed_h
+#define maman14_gda_typed_h
+
+#include <stddef.h>
+#include <string.h>
+#include "../../mem/inc/mem.h"
+
+/*
+ * Type specialized generic dynamic arrays.
+ * GDA_DECLARE(name,type) declares a container of type elements stored by value, GDA_DEFINE(name,type,cmp_fn,hash_fn)
+ * defines its functions in exactly one translation unit. cmp_fn(const type *,const type *) returns zero on equality
+ * and hash_fn(const type *) returns an unsigned long, both may be macros so the compiler can inline them.
+ *
+ * The operations mirror gda.h: insert copies the candidate (by value, instead of calling a ctor), search returns the
+ * first equal element, delete removes every equal element and destroy calls the dtor on every element left.
+ * like gda.h, a pointer returned by insert or search stays valid until its element is deleted: elements live in chunks
+ * that never move, and the container keeps a dense array of pointers to them in insertion order, which iteration walks.
+ * the slots of deleted elements are reused by later inserts. search goes through a hash index so it does not scan.
+ */
+
+/* elements of the first chunk, every chunk after it holds as many elements as all the chunks before it. */
+#define GDA_TYPED_FIRST_CHUNK 16
+
+/* use as the dtor of GDA_DEFINE_WITH_DTOR when the elements own nothing. */
+#define GDA_NO_DTOR(elem) ((void)(elem))
+
+#define GDA_DECLARE(name,type) \
+struct name##_gda_slot { \
+    type           *elem; /* NULL for an empty slot. */ \
+    unsigned long   hash; \
+}; \
+struct name##_gda { \
+    type                   **ptrs; /* the elements in insertion order. */ \
+    size_t                   elem_count; \
+    size_t                   ptrs_capacity; \
+    type                   **chunks; /* the storage of the elements, a chunk never moves. */ \
+    size_t                   chunk_count; \
+    size_t                   chunk_used; /* elements taken from the last chunk. */ \
+    size_t                   chunk_capacity; /* elements the last chunk holds. */ \
+    type                   **free_elems; /* elements that were deleted, taken again by insert. */ \
+    size_t                   free_count; \
+    size_t                   free_capacity; \
+    struct name##_gda_slot  *slots; \
+    size_t                   slots_count; /* always a power of two, at least twice elem_count. */ \
+}; \
+typedef struct name##_gda * name##_gda; \
+name##_gda name##_gda_create(void); \
+type *name##_gda_search(name##_gda gda,const type *candidate); \
+type *name##_gda_insert(name##_gda gda,const type *candidate); \
+void name##_gda_delete(name##_gda gda,const type *candidate); \
+void name##_gda_destroy(name##_gda gda); \
+type *const *name##_gda_get_begin_ptr(name##_gda gda); \
+type *const *name##_gda_get_end_ptr(name##_gda gda); \
+size_t name##_gda_size(name##_gda gda)
+
+#define GDA_DEFINE(name,type,cmp_fn,hash_fn) GDA_DEFINE_WITH_DTOR(name,type,cmp_fn,hash_fn,GDA_NO_DTOR)
+
+#define GDA_DEFINE_WITH_DTOR(name,type,cmp_fn,hash_fn,dtor_fn) \
+static void name##_gda_index_put(name##_gda gda,type *elem,unsigned long h) { \
+    size_t i = h & (gda->slots_count - 1); \
+    while(gda->slots[i].elem) \
+        i = (i + 1) & (gda->slots_count - 1); \
+    gda->slots[i].elem = elem; \
+    gda->slots[i].hash = h; \
+} \
+static int name##_gda_index_rebuild(name##_gda gda,size_t slots_count) { \
+    struct name##_gda_slot *slots = mem_calloc(mem_tag_gda,slots_count,sizeof(struct name##_gda_slot)); \
+    size_t i; \
+    if(!slots) \
+        return -1; \
+    mem_free(gda->slots); \
+    gda->slots       = slots; \
+    gda->slots_count = slots_count; \
+    for(i=0;i<gda->elem_count;i++) \
+        name##_gda_index_put(gda,gda->ptrs[i],hash_fn(gda->ptrs[i])); \
+    return 0; \
+} \
+static type *name##_gda_new_elem(name##_gda gda) { \
+    type **chunks; \
+    size_t capacity; \
+    if(gda->free_count) \
+        return gda->free_elems[--gda->free_count]; \
+    if(gda->chunk_used == gda->chunk_capacity) { \
+        capacity = gda->chunk_count ? gda->chunk_capacity * 2 : GDA_TYPED_FIRST_CHUNK; \
+        chunks = mem_realloc(mem_tag_gda,gda->chunks,(gda->chunk_count + 1) * sizeof(type *)); \
+        if(!chunks) \
+            return NULL; \
+        gda->chunks = chunks; \
+        gda->chunks[gda->chunk_count] = mem_malloc(mem_tag_gda,capacity * sizeof(type)); \
+        if(!gda->chunks[gda->chunk_count]) \
+            return NULL; \
+        gda->chunk_count++; \
+        gda->chunk_used     = 0; \
+        gda->chunk_capacity = capacity; \
+    } \
+    return &gda->chunks[gda->chunk_count - 1][gda->chunk_used++]; \
+} \
+name##_gda name##_gda_create(void) { \
+    name##_gda new_gda = mem_calloc(mem_tag_gda,1,sizeof(struct name##_gda)); \
+    if(!new_gda) \
+        return NULL; \
+    new_gda->ptrs_capacity = 2; \
+    new_gda->ptrs = mem_malloc(mem_tag_gda,new_gda->ptrs_capacity * sizeof(type *)); \
+    new_gda->slots_count = 4; \
+    new_gda->slots = mem_calloc(mem_tag_gda,new_gda->slots_count,sizeof(struct name##_gda_slot)); \
+    if(!new_gda->ptrs || !new_gda->slots) { \
+        mem_free(new_gda->ptrs); \
+        mem_free(new_gda->slots); \
+        mem_free(new_gda); \
+        return NULL; \
+    } \
+    return new_gda; \
+} \
+type *name##_gda_search(name##_gda gda,const type *candidate) { \
+    unsigned long h = hash_fn(candidate); \
+    size_t i = h & (gda->slots_count - 1); \
+    while(gda->slots[i].elem) { \
+        if(gda->slots[i].hash == h && cmp_fn(gda->slots[i].elem,candidate) == 0) \
+            return gda->slots[i].elem; \
+        i = (i + 1) & (gda->slots_count - 1); \
+    } \
+    return NULL; \
+} \
+type *name##_gda_insert(name##_gda gda,const type *candidate) { \
+    type **realloc_ret; \
+    type *elem; \
+    if(gda->elem_count == gda->ptrs_capacity) { \
+        realloc_ret = mem_realloc(mem_tag_gda,gda->ptrs,gda->ptrs_capacity * 2 * sizeof(type *)); \
+        if(!realloc_ret) \
+            return NULL; \
+        gda->ptrs = realloc_ret; \
+        gda->ptrs_capacity *= 2; \
+    } \
+    if((gda->elem_count + 1) * 2 > gda->slots_count) { \
+        if(name##_gda_index_rebuild(gda,gda->slots_count * 2)) \
+            return NULL; \
+    } \
+    elem = name##_gda_new_elem(gda); \
+    if(!elem) \
+        return NULL; \
+    *elem = *candidate; \
+    name##_gda_index_put(gda,elem,hash_fn(elem)); \
+    gda->ptrs[gda->elem_count++] = elem; \
+    return elem; \
+} \
+void name##_gda_delete(name##_gda gda,const type *candidate) { \
+    type **realloc_ret; \
+    size_t i, kept = 0; \
+    for(i=0;i<gda->elem_count;i++) { \
+        if(cmp_fn(gda->ptrs[i],candidate) == 0) { \
+            dtor_fn(gda->ptrs[i]); \
+            /* an element that cannot be kept for reuse is still freed with its chunk */ \
+            if(gda->free_count == gda->free_capacity) { \
+                realloc_ret = mem_realloc(mem_tag_gda,gda->free_elems,(gda->free_capacity * 2 + 16) * sizeof(type *)); \
+                if(realloc_ret) { \
+                    gda->free_elems = realloc_ret; \
+                    gda->free_capacity = gda->free_capacity * 2 + 16; \
+                } \
+            } \
+            if(gda->free_count < gda->free_capacity) \
+                gda->free_elems[gda->free_count++] = gda->ptrs[i]; \
+        }else { \
+            gda->ptrs[kept++] = gda->ptrs[i]; \
+        } \
+    } \
+    if(kept != gda->elem_count) { \
+        gda->elem_count = kept; \
+        memset(gda->slots,0,gda->slots_count * sizeof(struct name##_gda_slot)); \
+        for(i=0;i<gda->elem_count;i++) \
+            name##_gda_index_put(gda,gda->ptrs[i],hash_fn(gda->ptrs[i])); \
+    } \
+} \
+void name##_gda_destroy(name##_gda gda) { \
+    size_t i; \
+    for(i=0;i<gda->elem_count;i++) \
+        dtor_fn(gda->ptrs[i]); \
+    for(i=0;i<gda->chunk_count;i++) \
+        mem_free(gda->chunks[i]); \
+    mem_free(gda->chunks); \
+    mem_free(gda->free_elems); \
+    mem_free(gda->ptrs); \
+    mem_free(gda->slots); \
+    mem_free(gda); \
+} \
+type *const *name##_gda_get_begin_ptr(name##_gda gda) { \
+    return gda->ptrs; \
+} \
+type *const *name##_gda_get_end_ptr(name##_gda gda) { \
+    return gda->ptrs + gda->elem_count; \
+} \
+size_t name##_gda_size(name##_gda gda) { \
+    return gda->elem_count; \
+}
+
+/* iterates over the elements in insertion order, it is a type *const *, so *it is the element. */
+#define gda_typed_for_each(name,gda,it) for(it = name##_gda_get_begin_ptr(gda);it < name##_gda_get_end_ptr(gda);it++)
+
+#endif
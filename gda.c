@@ -1,15 +1,25 @@
 #include <stdlib.h>
-#include "../inc/gda.h"
 #include <string.h>
+#include "../inc/gda.h"
+#include "../../stats/inc/stats.h"
+#include "../../mem/inc/mem.h"
+/* A single allocation that holds elements inserted by gda_insert_n. */
+struct gda_block {
+    char *begin; /* The first byte of the block. */
+    char *end; /* One past the last byte of the block. */
+};
 /* The gda structure representing a generic dynamic array. */
 struct gda {
     void **pointer_array; /* A pointer to an array of void pointers. */
     size_t  pointers_count; /* The total number of pointers in the array. */
-    size_t  elem_count; /* The count of non-null elements in the array. */
+    size_t  elem_count; /* The count of elements, they always occupy the first elem_count pointers. */
     void *(*ctor)(const void *candidate); /* A constructor function pointer for deep copying elements. */
     void (*dtor)(void * candidate); /* A destructor function pointer for cleaning up elements. */
     int (*compar)(const void *candidate1,const void * candidate2); /* A comparison function pointer for searching elements. */
-    
+    int     sorted; /* Sort mode, non zero while the elements are ordered by compar. */
+    int     bulk_load; /* When non zero, an unsorted gda is sorted by the next search. */
+    struct gda_block *blocks; /* The blocks of gda_insert_n, ordered by address. */
+    size_t  block_count; /* The count of blocks. */
 };
 
 /**
@@ -24,22 +34,23 @@ gda gda_create(void *(*ctor)(const void *candidate),
             void (*dtor)(void * candidate),
             int (*compar)(const void *candidate1,const void * candidate2)) {
 
-            gda new_gda = calloc(1,sizeof(struct gda));
+            gda new_gda = mem_calloc(mem_tag_gda,1,sizeof(struct gda));
             if(!new_gda)
                 return NULL;
             new_gda->compar         = compar;
             new_gda->ctor           = ctor;
             new_gda->dtor           = dtor;
             new_gda->pointers_count = 2;
-            new_gda->pointer_array  = calloc(new_gda->pointers_count,sizeof(void *));
+            new_gda->sorted         = compar != NULL;
+            new_gda->pointer_array  = mem_calloc(mem_tag_gda,new_gda->pointers_count,sizeof(void *));
             if(!new_gda->pointer_array) {
-                free(new_gda);
+                mem_free(new_gda);
                 return NULL;
             }
             return new_gda;
 }
 /**
- * @brief Searches for an element in the gda.
+ * @brief Searches for an element in the gda, binary search in sort mode and a linear scan otherwise.
  * 
  * @param gda 
  * @param candidate Element to search for
@@ -47,91 +58,273 @@ gda gda_create(void *(*ctor)(const void *candidate),
  */
 void * gda_search(gda gda,const void *candidate) {
     void **runner;
-    for(runner = gda->pointer_array;runner < gda->pointer_array + gda->pointers_count;runner++) {
-        if(*runner) {
-            if (gda->compar(*runner,candidate) == 0)
-                return *runner;
+    void *found = NULL;
+    size_t low, high, mid;
+    size_t probes = 0;
+    if(!gda->sorted && gda->bulk_load)
+        gda_sort(gda);
+    if(gda->sorted) {
+        /* lower bound, so the first of several equal elements is found like in the linear scan */
+        low = 0;
+        high = gda->elem_count;
+        while(low < high) {
+            mid = low + (high - low) / 2;
+            probes++;
+            if(gda->compar(gda->pointer_array[mid],candidate) < 0)
+                low = mid + 1;
+            else
+                high = mid;
+        }
+        if(low < gda->elem_count && (probes++,gda->compar(gda->pointer_array[low],candidate) == 0))
+            found = gda->pointer_array[low];
+    }else {
+        for(runner = gda->pointer_array;runner < gda->pointer_array + gda->elem_count;runner++) {
+            probes++;
+            if (gda->compar(*runner,candidate) == 0) {
+                found = *runner;
+                break;
+            }
         }
     }
-    return NULL;
+    /* every probe is one comparison */
+    STATS_ADD(stats_gda_searches,1);
+    STATS_ADD(stats_gda_probes,probes);
+    STATS_ADD(stats_gda_compares,probes);
+    return found;
 }
 /**
- * @brief Inserts an element into the gda.
+ * @brief Inserts an element at the end of the gda.
  * 
  * @param gda 
  * @param candidate Element to insert
  * @return void* Inserted element or NULL if insertion failed
  */
 void * gda_insert(gda gda, const void *candidate) {
-    size_t i;
     void * ret;
     void *realloc_ret;
-    for(i=0;i<gda->pointers_count;i++) {
-        if(gda->pointer_array[i] == NULL) {
-            ret = gda->ctor(candidate);
-            if(!ret)
-                return NULL;
-            gda->pointer_array[i] = ret;
-            gda->elem_count++;
-            return ret;
-        }
-    }
-    gda->pointers_count *=2;
-    realloc_ret = realloc(gda->pointer_array,gda->pointers_count * sizeof(void *));
-    if(!realloc_ret) {
-        gda->pointers_count /=2;
-        return NULL;
+    if(gda->elem_count == gda->pointers_count) {
+        realloc_ret = mem_realloc(mem_tag_gda,gda->pointer_array,gda->pointers_count * 2 * sizeof(void *));
+        if(!realloc_ret)
+            return NULL;
+        gda->pointer_array = realloc_ret;
+        gda->pointers_count *=2;
+        STATS_ADD(stats_gda_reallocs,1);
     }
     ret = gda->ctor(candidate);
     if(!ret)
         return NULL;
-    gda->pointer_array = realloc_ret;
-    gda->pointer_array[gda->elem_count] = ret;
-    memset(&gda->pointer_array[gda->elem_count+1],0,(gda->pointers_count - (gda->elem_count+1) ) * sizeof(void *));
-    gda->elem_count++;
+    /* appending in order keeps the sort mode */
+    if(gda->sorted && gda->elem_count > 0 && (STATS_ADD(stats_gda_compares,1),gda->compar(gda->pointer_array[gda->elem_count - 1],ret) > 0))
+        gda->sorted = 0;
+    gda->pointer_array[gda->elem_count++] = ret;
     return ret;
 }
 /**
- * @brief Deletes an element from the gda.
+ * @brief Checks if an element was inserted by gda_insert_n, it then lives in one of the blocks and has no dtor call of its own.
+ * 
+ * @param gda 
+ * @param element 
+ * @return int non zero if the element is inside a block.
+ */
+static int gda_in_block(gda gda,const void *element) {
+    size_t low = 0, high = gda->block_count, mid;
+    while(low < high) {
+        mid = low + (high - low) / 2;
+        if((const char *)element < gda->blocks[mid].begin)
+            high = mid;
+        else if((const char *)element >= gda->blocks[mid].end)
+            low = mid + 1;
+        else
+            return 1;
+    }
+    return 0;
+}
+/**
+ * @brief Inserts count copies of an element at the end of the gda, the copies are made in a single allocation
+ * and the array grows once for all of them.
+ * 
+ * @param gda 
+ * @param candidate Element to insert
+ * @param size Size of the element in bytes
+ * @param count Amount of copies
+ * @return void* The first inserted element, NULL if count is 0 or on allocation failure
+ */
+void * gda_insert_n(gda gda, const void *candidate, size_t size, size_t count) {
+    char *block, *runner;
+    void *realloc_ret;
+    size_t pointers_count = gda->pointers_count, i;
+    if(count == 0)
+        return NULL;
+    while(pointers_count - gda->elem_count < count)
+        pointers_count *= 2;
+    if(pointers_count != gda->pointers_count) {
+        realloc_ret = mem_realloc(mem_tag_gda,gda->pointer_array,pointers_count * sizeof(void *));
+        if(!realloc_ret)
+            return NULL;
+        gda->pointer_array  = realloc_ret;
+        gda->pointers_count = pointers_count;
+        STATS_ADD(stats_gda_reallocs,1);
+    }
+    realloc_ret = mem_realloc(mem_tag_gda,gda->blocks,(gda->block_count + 1) * sizeof(struct gda_block));
+    if(!realloc_ret)
+        return NULL;
+    gda->blocks = realloc_ret;
+    block = mem_malloc(mem_tag_gda,size * count);
+    if(!block)
+        return NULL;
+    /* the blocks stay ordered by address, so gda_in_block is a binary search */
+    for(i = gda->block_count;i > 0 && gda->blocks[i - 1].begin > block;i--)
+        gda->blocks[i] = gda->blocks[i - 1];
+    gda->blocks[i].begin = block;
+    gda->blocks[i].end   = block + size * count;
+    gda->block_count++;
+    for(runner = block;runner < block + size * count;runner += size) {
+        memcpy(runner,candidate,size);
+        if(gda->sorted && gda->elem_count > 0 && (STATS_ADD(stats_gda_compares,1),gda->compar(gda->pointer_array[gda->elem_count - 1],runner) > 0))
+            gda->sorted = 0;
+        gda->pointer_array[gda->elem_count++] = runner;
+    }
+    return block;
+}
+/**
+ * @brief Deletes every matching element from the gda, the remaining elements are moved down so they stay dense and in order.
  * 
  * @param gda 
  * @param candidate Element to delete
  */
 void gda_delete(gda gda, const void *candidate) {
     void **runner;
-    for(runner = gda->pointer_array;runner < gda->pointer_array + gda->pointers_count;runner++) {
-        if(*runner) {
-            if (gda->compar(*runner,candidate) == 0){
-                if(gda->dtor) 
-                    gda->dtor(*runner);
-                *runner = NULL;
-                gda->elem_count--;
-            }
+    void **kept = gda->pointer_array;
+    for(runner = gda->pointer_array;runner < gda->pointer_array + gda->elem_count;runner++) {
+        if (gda->compar(*runner,candidate) == 0){
+            if(gda->dtor && !gda_in_block(gda,*runner)) 
+                gda->dtor(*runner);
+        }else {
+            *kept++ = *runner;
         }
     }
+    gda->elem_count = kept - gda->pointer_array;
 }
 /**
- * @brief Destroys the gda.
+ * @brief Merges two sorted runs of pointers into dest.
  * 
  * @param gda 
+ * @param dest 
+ * @param left 
+ * @param left_count 
+ * @param right 
+ * @param right_count 
  */
-void gda_destroy(gda gda) {
+static void gda_merge(gda gda,void **dest,void **left,size_t left_count,void **right,size_t right_count) {
+    void **left_end = left + left_count;
+    void **right_end = right + right_count;
+    while(left < left_end && right < right_end) {
+        /* taking from the left run on ties keeps the sort stable */
+        STATS_ADD(stats_gda_compares,1);
+        if(gda->compar(*right,*left) < 0)
+            *dest++ = *right++;
+        else
+            *dest++ = *left++;
+    }
+    while(left < left_end)
+        *dest++ = *left++;
+    while(right < right_end)
+        *dest++ = *right++;
+}
+/**
+ * @brief Sorts the gda by compar with a bottom up merge sort and turns sort mode on.
+ * equal elements keep their insertion order.
+ * 
+ * @param gda 
+ * @return int 0 if successful, -1 if the temporary buffer could not be allocated.
+ */
+int gda_sort(gda gda) {
+    void **temp;
+    void **from;
+    void **to;
+    void **swap;
+    size_t width, i, left_count, right_count;
+    if(gda->sorted)
+        return 0;
+    temp = mem_malloc(mem_tag_gda,gda->elem_count * sizeof(void *) + 1);
+    if(!temp)
+        return -1;
+    from = gda->pointer_array;
+    to = temp;
+    for(width = 1;width < gda->elem_count;width *= 2) {
+        for(i = 0;i < gda->elem_count;i += 2 * width) {
+            left_count = gda->elem_count - i < width ? gda->elem_count - i : width;
+            right_count = gda->elem_count - i - left_count < width ? gda->elem_count - i - left_count : width;
+            gda_merge(gda,to + i,from + i,left_count,from + i + left_count,right_count);
+        }
+        swap = from;
+        from = to;
+        to = swap;
+    }
+    if(from != gda->pointer_array) {
+        for(i = 0;i < gda->elem_count;i++)
+            gda->pointer_array[i] = from[i];
+    }
+    mem_free(temp);
+    gda->sorted = 1;
+    return 0;
+}
+/**
+ * @brief Turns bulk load on or off, in bulk load inserts stay unsorted and the gda is sorted once by the next search.
+ * 
+ * @param gda 
+ * @param enable 
+ */
+void gda_set_bulk_load(gda gda,int enable) {
+    gda->bulk_load = enable;
+}
+/**
+ * @brief Returns the sort mode of the gda.
+ * 
+ * @param gda 
+ * @return int non zero if sorted.
+ */
+int gda_is_sorted(gda gda) {
+    return gda->sorted;
+}
+/**
+ * @brief Destroys every element, the pointer array keeps its capacity.
+ * 
+ * @param gda 
+ */
+void gda_clear(gda gda) {
     size_t i;
-    for(i=0;i<gda->pointers_count;i++) {
-        if(gda->pointer_array[i] !=NULL) {
-            gda->dtor(gda->pointer_array[i]);
+    if(gda->dtor) {
+        for(i=0;i<gda->elem_count;i++) {
+            if(gda->block_count == 0 || !gda_in_block(gda,gda->pointer_array[i]))
+                gda->dtor(gda->pointer_array[i]);
         }
     }
-    free(gda->pointer_array);
-    free(gda);
+    for(i=0;i<gda->block_count;i++)
+        mem_free(gda->blocks[i].begin);
+    mem_free(gda->blocks);
+    gda->blocks      = NULL;
+    gda->block_count = 0;
+    gda->elem_count  = 0;
+    gda->sorted      = gda->compar != NULL;
+}
+/**
+ * @brief Destroys the gda.
+ * 
+ * @param gda 
+ */
+void gda_destroy(gda gda) {
+    gda_clear(gda);
+    mem_free(gda->pointer_array);
+    mem_free(gda);
 }
 
 
 /**
- * @brief Gets a pointer to the beginning of the gda.
+ * @brief Gets a pointer to the beginning of the gda, together with gda_size it is a contiguous view of the elements.
  * 
  * @param gda 
- * @return void *const* Pointer to the beginning
+ * @return void *const* Pointer to the first element
  */
 void *const * gda_get_begin_ptr(gda gda) {
     return gda->pointer_array;
@@ -141,10 +334,10 @@ void *const * gda_get_begin_ptr(gda gda) {
  * @brief Gets a pointer to the end of the gda.
  * 
  * @param gda 
- * @return void *const* Pointer to the end
+ * @return void *const* Pointer one past the last element
  */
 void *const * gda_get_end_ptr(gda gda) {
-    return (gda->pointer_array + gda->pointers_count) -1;
+    return gda->pointer_array + gda->elem_count;
 }
 
 /**
@@ -7,12 +7,16 @@ struct gda;
 typedef struct gda * gda;
 
 /**
- * @brief 
+ * @brief creates an empty gda, in sort mode if compar is not NULL.
+ * in sort mode gda_search is a binary search, so compar must be a consistent total order like strcmp:
+ * negative, zero or positive, antisymmetric and transitive.
+ * a comparator that only tells equal from unequal works only if it returns a positive value for unequal elements,
+ * the first insert out of order then leaves sort mode for good and searches scan linearly. gda_sort and bulk load mode need a total order.
  * 
- * @param ctor 
- * @param dtor 
- * @param compar 
- * @return gda 
+ * @param ctor copies a candidate into a new element, returns NULL on allocation failure.
+ * @param dtor destroys an element made by ctor.
+ * @param compar orders two elements, NULL for a gda that is never searched, sorted or deleted from.
+ * @return gda NULL on allocation failure.
  */
 gda gda_create(void *(*ctor)(const void *candidate),
             void (*dtor)(void * candidate),
@@ -20,7 +24,8 @@ gda gda_create(void *(*ctor)(const void *candidate),
 
 
 /**
- * @brief 
+ * @brief binary search in sort mode, linear scan otherwise.
+ * in bulk load mode an unsorted gda is sorted first.
  * 
  * @param gda 
  * @param candidate 
@@ -29,7 +34,7 @@ gda gda_create(void *(*ctor)(const void *candidate),
 void *gda_search(gda gda,const void *candidate);
 
 /**
- * @brief inserts element into gda, changes sort mode to zero (obviously).
+ * @brief inserts element at the end of the gda, changes sort mode to zero unless the element sorts after the last one.
  * 
  * @param gda 
  * @param candidate 
@@ -38,13 +43,59 @@ void *gda_search(gda gda,const void *candidate);
 void * gda_insert(gda gda, const void *candidate);
 
 /**
- * @brief deletes element from gda, changes sort mode to zero (obviouisly).
+ * @brief inserts count copies of element at the end of the gda, the copies are made in one allocation without calling ctor,
+ * so it is meant for plain values that the dtor only frees. the dtor is not called for them, they are freed together when the gda is destroyed.
+ * 
+ * @param gda 
+ * @param candidate 
+ * @param size size of the element in bytes.
+ * @param count 
+ * @return returns a pointer to the first inserted element, returns NULL if count is 0 or on allocation failure, nothing is inserted then.
+ */
+void * gda_insert_n(gda gda, const void *candidate, size_t size, size_t count);
+
+/**
+ * @brief deletes every matching element from gda, keeps the sort mode.
+ * the remaining elements are compacted in order, so the gda never holds empty slots.
  * 
  * @param gda 
  * @param candidate 
  */
 void gda_delete(gda gda, const void *candidate);
 
+/**
+ * @brief sorts the gda by compar (stable) and turns sort mode on.
+ * 
+ * @param gda 
+ * @return int 0 if successful, -1 otherwise.
+ */
+int gda_sort(gda gda);
+
+/**
+ * @brief turns bulk load mode on or off. inserts never sort, the first search after them sorts once.
+ * meant for tables that are filled first and searched later.
+ * 
+ * @param gda 
+ * @param enable 
+ */
+void gda_set_bulk_load(gda gda,int enable);
+
+/**
+ * @brief 
+ * 
+ * @param gda 
+ * @return int non zero if the gda is in sort mode.
+ */
+int gda_is_sorted(gda gda);
+
+/**
+ * @brief destroys every element, an empty gda is left in the same sort mode it was created in.
+ * the pointer array is kept, so refilling it up to the same size does not grow it again.
+ * 
+ * @param gda 
+ */
+void gda_clear(gda gda);
+
 /**
  * @brief destorys the gda.
  * 
@@ -56,7 +107,7 @@ void gda_destroy(gda gda);
  * @brief 
  * 
  * @param gda 
- * @return void* const* 
+ * @return void* const* the first element, the elements are contiguous so [begin, begin + gda_size) are all valid.
  */
 void *const * gda_get_begin_ptr(gda gda);
 
@@ -64,7 +115,7 @@ void *const * gda_get_begin_ptr(gda gda);
  * @brief 
  * 
  * @param gda 
- * @return void* const* 
+ * @return void* const* one past the last element.
  */
 void *const * gda_get_end_ptr(gda gda);
 
@@ -76,5 +127,6 @@ void *const * gda_get_end_ptr(gda gda);
  */
 size_t gda_size(gda gda);
 
-#define gda_for_each(gda,begin_ptr,end_ptr) for(begin_ptr = gda_get_begin_ptr(gda),end_ptr = gda_get_end_ptr(gda);begin_ptr<=end_ptr;begin_ptr++)
+/* iterates over the elements, *begin_ptr is never NULL. */
+#define gda_for_each(gda,begin_ptr,end_ptr) for(begin_ptr = gda_get_begin_ptr(gda),end_ptr = gda_get_end_ptr(gda);begin_ptr<end_ptr;begin_ptr++)
 #endif
@@ -0,0 +1,140 @@
+/* clock_gettime is POSIX */
+#define _POSIX_C_SOURCE 199309L
+#include "../inc/lang-engine.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define LINES 200000
+#define REPEATS 3
+#define BENCH_LINE_LEN 512
+
+/* results are accumulated here so the measured loops are not optimized away. */
+static volatile unsigned long bench_sink;
+
+/**
+ * @brief a category of lines, and the result every line of it must parse to.
+ * @param name
+ * @param expect the dir_or_inst_tag of the result.
+ * @param lines NULL terminated, used in turn.
+ */
+struct bench_category {
+    const char     *name;
+    int             expect;
+    const char     *lines[8];
+};
+
+/* .data lines are built at start up, with this many values. */
+static const int bench_data_counts[] = {1,8,40,80};
+
+static const struct bench_category bench_categories[] = {
+    {"group-a",         tag_inst,           {"mov r3, LENGTH","MAIN: cmp #-6, K","add r1, r2","sub #12, r4","lea STR, r5",NULL}},
+    {"group-b",         tag_inst,           {"inc K","L1: clr r2","not r7","jmp END","prn #-5","jsr W","red STR",NULL}},
+    {"jump-params",     tag_inst,           {"jmp LABEL(r1,#3)","LOOP: bne LOOP(r4,r3)","jsr L3(W,#4)","jmp L1(#-1,r6)",NULL}},
+    {"group-c",         tag_inst,           {"rts","END: stop","stop",NULL}},
+    {"string",          tag_dir,            {"STR: .string \"abcdef\"",".string \"a\"","S1: .string \"hello world, this is a longer string\"",NULL}},
+    {"space-fill",      tag_dir,            {"BUF: .space 2000",".space 1","TAB: .fill 80, -1",".fill 4096,7",NULL}},
+    {"entry-extern",    tag_dir,            {".entry LENGTH",".extern W",".entry LOOP",".extern L3",NULL}},
+    {"comment",         tag_line_null,      {"; file ps.as","   ; indented comment","",NULL}},
+    {"err-colon",       tag_syntax_error,   {"A: B: mov r1, r2",NULL}},
+    {"err-symbol",      tag_syntax_error,   {"1abc: rts","ab$c: rts","abcdefghijklmnopqrstuvwxyzabcdef: rts",NULL}},
+    {"err-keyword",     tag_syntax_error,   {"move r1, r2","MAIN: foo",NULL}},
+    {"err-no-args",     tag_syntax_error,   {"mov","inc",NULL}},
+    {"err-separator",   tag_syntax_error,   {"mov r1 r2",NULL}},
+    {"err-extraneous",  tag_syntax_error,   {"mov r1, r2 r3","inc r1 r2","rts r1",NULL}},
+    {"err-operand",     tag_syntax_error,   {"mov #abc, r1","mov r9, r1","inc 1abc",NULL}},
+    {"err-jump",        tag_syntax_error,   {"jmp L1(r1,#3","jmp L1r1,#3)","jmp L1)r1,#3(","jmp L1 (r1,#3)","jmp L1(r1 #3)",NULL}},
+    {"err-directive",   tag_syntax_error,   {".data",".extern A B",".entry 1abc",NULL}},
+    {"err-string",      tag_syntax_error,   {".string abc\"",".string \"abc",".string abc",NULL}},
+    {"err-data",        tag_syntax_error,   {".data 1 2",".data 1,x",".data 99999999999",NULL}},
+    {"err-fill",        tag_syntax_error,   {".space 0",".space 4097",".fill 10",".fill 10, 9000",".space 5, 1",NULL}}
+};
+
+/**
+ * @brief returns the seconds of the monotonic clock.
+ */
+static double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief parses count lines of a corpus, the fastest of REPEATS runs.
+ *
+ * @param name the category
+ * @param corpus NULL terminated lines, used in turn
+ * @param expect the dir_or_inst_tag every line must parse to
+ * @param count
+ * @param json non zero prints a line of JSON instead of text
+ * @return int 0 if every line parsed as expected
+ */
+static int bench_run(const char *name,const char *const *corpus,int expect,unsigned long count,int json) {
+    char line[BENCH_LINE_LEN];
+    struct syntax_struct ss;
+    size_t lens[8];
+    int corpus_count, c, r, mismatch = 0;
+    unsigned long i;
+    double start, seconds, best = 0;
+    for(corpus_count=0;corpus_count<8 && corpus[corpus_count];corpus_count++) {
+        lens[corpus_count] = strlen(corpus[corpus_count]) + 1;
+        strcpy(line,corpus[corpus_count]);
+        ss = lang_engine_create_ss_from_logical_line(line);
+        if((int)ss.dir_or_inst_tag != expect) {
+            fprintf(stderr,"%s: '%s' parsed as %d, expected %d\n",name,corpus[corpus_count],(int)ss.dir_or_inst_tag,expect);
+            mismatch = 1;
+        }
+    }
+    for(r=0;r<REPEATS;r++) {
+        start = bench_now();
+        for(i=0,c=0;i<count;i++) {
+            /* the parser writes into the line, so it gets a fresh copy every time */
+            memcpy(line,corpus[c],lens[c]);
+            ss = lang_engine_create_ss_from_logical_line(line);
+            bench_sink += ss.dir_or_inst_tag;
+            if(++c == corpus_count)
+                c = 0;
+        }
+        seconds = bench_now() - start;
+        if(r == 0 || seconds < best)
+            best = seconds;
+    }
+    if(json)
+        printf("{\"category\":\"%s\",\"lines\":%lu,\"ns_per_line\":%.1f,\"lines_per_sec\":%.0f}\n",name,count,best * 1e9 / count,count / best);
+    else
+        printf("%-16s n=%-9lu %10.1f ns/line %14.0f lines/s\n",name,count,best * 1e9 / count,count / best);
+    return mismatch;
+}
+
+int main(int argc,char **argv) {
+    static char data_lines[sizeof(bench_data_counts)/sizeof(bench_data_counts[0])][BENCH_LINE_LEN];
+    const char *data_corpus[2];
+    char data_name[16];
+    unsigned long count = LINES;
+    int i, k, json = 0, failed = 0;
+    size_t len;
+    for(i=1;i<argc;i++) {
+        if(strcmp(argv[i],"-j") == 0) {
+            json = 1;
+        }else if(strtoul(argv[i],NULL,10)) {
+            count = strtoul(argv[i],NULL,10);
+        }else {
+            fprintf(stderr,"usage: %s [-j] [lines]\n",argv[0]);
+            return 1;
+        }
+    }
+    for(i=0;i<(int)(sizeof(bench_categories)/sizeof(bench_categories[0]));i++)
+        failed |= bench_run(bench_categories[i].name,bench_categories[i].lines,bench_categories[i].expect,count,json);
+    /* .data with 1 up to max_data_in_a_line values */
+    for(i=0;i<(int)(sizeof(bench_data_counts)/sizeof(bench_data_counts[0]));i++) {
+        len = sprintf(data_lines[i],"D: .data ");
+        for(k=0;k<bench_data_counts[i];k++)
+            len += sprintf(data_lines[i] + len,"%s%d",k ? "," : "",k % 2 ? -k : k);
+        data_corpus[0] = data_lines[i];
+        data_corpus[1] = NULL;
+        sprintf(data_name,"data-%d",bench_data_counts[i]);
+        failed |= bench_run(data_name,data_corpus,tag_dir,count,json);
+    }
+    return failed;
+}
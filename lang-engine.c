@@ -70,10 +70,12 @@ static const char *sst_number_valid_str_error[4] = {
     "invalid number"
 };
 /* Array of assembly directives and their corresponding directive tags */
-static const struct asm_directive asm_dirs[4] = {
+static const struct asm_directive asm_dirs[6] = {
     {".data",tag_data},
     {".entry",tag_entry},
     {".extern",tag_extern},
+    {".fill",tag_fill},
+    {".space",tag_space},
     {".string",tag_string}
 };
 /* Comparison function for CPU instructions used by bsearch() */
@@ -95,7 +97,7 @@ static struct cpu_instruction * lang_engine_is_string_a_cpu_inst(const char * st
 static struct asm_directive * lang_engine_is_string_a_asm_dir(const char * string) {
     struct asm_directive dir;
     dir.dir_name = string;
-    return bsearch(&dir,&asm_dirs[0],4,sizeof(struct asm_directive),cpu_i_compar);
+    return bsearch(&dir,&asm_dirs[0],sizeof(asm_dirs) / sizeof(asm_dirs[0]),sizeof(struct asm_directive),cpu_i_compar);
 }
 /* Function that validates a given symbol */
 static enum sst_symbol_valid_tag lang_engine_symbol_validation(const char * string) {
@@ -533,7 +535,33 @@ struct syntax_struct lang_engine_create_ss_from_logical_line(char *logical_line)
                 }
                 result.asm_directive_and_cpu_inst.asm_directive.directive_union.data_array.num_count = i + 1;
                 break;
-            }        
+            }
+            /* Parse the count of words, and the value they are filled with for .fill, .space fills them with 0 */
+            case tag_space: case tag_fill: {
+                if((number_valid_temp = lang_engine_number_validation(temp1,&temp2,&result.asm_directive_and_cpu_inst.asm_directive.directive_union.fill.count,max_fill_words,1)) != sst_number_ok) {
+                    lang_engine_set_result_as_error(&result,"count is %s",sst_number_valid_str_error[number_valid_temp]);
+                    return result;
+                }
+                result.asm_directive_and_cpu_inst.asm_directive.directive_union.fill.value = 0;
+                SKIP_SPACE(temp2);
+                if(dir->d_tag == tag_fill) {
+                    if(*temp2 != ',') {
+                        lang_engine_set_result_as_error(&result,"expected separator ',' for directive '%s' ",dir->dir_name);
+                        return result;
+                    }
+                    temp1 = temp2 + 1;
+                    if((number_valid_temp = lang_engine_number_validation(temp1,&temp2,&result.asm_directive_and_cpu_inst.asm_directive.directive_union.fill.value,MAX_C_NUMBER,MIN_C_NUMBER)) != sst_number_ok) {
+                        lang_engine_set_result_as_error(&result,"value is %s",sst_number_valid_str_error[number_valid_temp]);
+                        return result;
+                    }
+                    SKIP_SPACE(temp2);
+                }
+                if(*temp2 != '\0' && *temp2 != '\n') {
+                    lang_engine_set_result_as_error(&result,"extraneous text for directive: '%s'.",dir->dir_name);
+                    return result;
+                }
+                break;
+            }
         }
     }
 
@@ -4,6 +4,8 @@
 #define max_symbol_len 30
 #define syntax_error_buf_len 120
 #define max_data_in_a_line 80
+/* words a single .space or .fill may reserve, the whole address space */
+#define max_fill_words 4096
 #define max_line_size 85
 
 #define is_i_tag_groupA(i_tag) (i_tag >= tag_mov && i_tag <= tag_lea)
@@ -38,7 +40,9 @@ enum dir_tag{
     tag_data, 
     tag_string, 
     tag_extern,  
-    tag_entry  
+    tag_entry,
+    tag_space,
+    tag_fill
 };
 enum argument_option{
     tag_arg_tag_constant, 
@@ -67,6 +71,10 @@ struct syntax_struct {
                     int num_array[max_data_in_a_line];
                     int num_count;
                 }data_array;
+                struct {
+                    int count;
+                    int value;
+                }fill;
                 char string[max_line_size + 1];
             }directive_union;
         }asm_directive;
@@ -0,0 +1,190 @@
+/* clock_gettime is POSIX */
+#define _POSIX_C_SOURCE 199309L
+#include "../inc/linker.h"
+#include "../../assembler/inc/assembler.h"
+#include "../../simulator/inc/sim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define REPEATS 5
+#define BENCH_PATH_LEN 512
+/* modules of the generated program, every one takes 6 words so the image fills most of the address space. */
+#define BENCH_MODULES 600
+#define BENCH_THREADS 4
+
+/**
+ * @brief returns the seconds of the monotonic clock.
+ */
+static double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief writes module k of a chain of modules, module 0 calls module 1 and every module calls the next one through an extern.
+ *
+ * @param base_name the file is base_name.as
+ * @param k
+ * @param modules
+ * @return int 0 on success, -1 if it cannot be written.
+ */
+static int bench_generate(const char *base_name,int k,int modules) {
+    char file_name[BENCH_PATH_LEN];
+    FILE *out;
+    sprintf(file_name,"%.*s.as",BENCH_PATH_LEN - 4,base_name);
+    out = fopen(file_name,"w");
+    if(!out)
+        return -1;
+    fprintf(out,"; generated by linker-bench\n");
+    if(k == 0) {
+        fprintf(out,".extern F1\n"
+                    "MAIN: jsr F1\n"
+                    " stop\n");
+    }else {
+        fprintf(out,".entry F%d\n",k);
+        if(k + 1 < modules)
+            fprintf(out,".extern F%d\n",k + 1);
+        fprintf(out,"F%d: inc V%d\n",k,k);
+        if(k + 1 < modules)
+            fprintf(out," jsr F%d\n",k + 1);
+        fprintf(out," rts\n"
+                    "V%d: .data %d\n",k,k);
+    }
+    return fclose(out) ? -1 : 0;
+}
+
+/**
+ * @brief adds an assembled translation unit to the linker it is called with.
+ */
+static void bench_assembled(void *context,const char *base_name,const struct translation_unit *t_unit) {
+    if(linker_add_translation_unit(context,base_name,t_unit))
+        fprintf(stderr,"%s: cannot be added\n",base_name);
+}
+
+/**
+ * @brief runs the linked image, every module runs its instructions once.
+ *
+ * @param base_name
+ * @param modules
+ * @return int 0 if it stopped after the expected instructions, 1 otherwise.
+ */
+static int bench_verify(const char *base_name,int modules) {
+    struct sim_options options = {0};
+    struct sim_result result;
+    simulator sim;
+    int failed;
+    options.out = stdout;
+    sim = sim_create(&options);
+    if(!sim)
+        return 1;
+    failed = sim_load_ob(sim,base_name) != 0;
+    if(!failed) {
+        sim_run(sim,&result);
+        /* jsr and stop, then inc, jsr and rts of every module, the last one does not call */
+        failed = result.status != sim_status_stopped || result.instructions != 3UL * modules - 2;
+        if(failed)
+            fprintf(stderr,"%s: ran %lu instructions and ended at %u, expected %lu\n",base_name,result.instructions,result.pc,3UL * modules - 2);
+    }else {
+        fprintf(stderr,"%s: cannot load %s.ob\n",base_name,base_name);
+    }
+    sim_destroy(sim);
+    return failed;
+}
+
+/**
+ * @brief links repeats times and reports the modules and words per second.
+ *
+ * @param name
+ * @param l
+ * @param output
+ * @param threads
+ * @param repeats
+ * @return int 0 on success, 1 otherwise.
+ */
+static int bench_link(const char *name,linker l,const char *output,int threads,int repeats) {
+    struct linker_stats stats;
+    double start, seconds, best = 0;
+    unsigned long words;
+    int r, failed = 0;
+    for(r=0;r<repeats;r++) {
+        start = bench_now();
+        failed |= linker_link(l,output,threads,&stats) != 0;
+        seconds = bench_now() - start;
+        if(r == 0 || seconds < best)
+            best = seconds;
+    }
+    words = stats.code_words + stats.data_words;
+    printf("%-20s threads=%-2d modules=%-6lu words=%-6lu relocations=%-6lu externs=%-6lu %9.6f s %12.0f modules/s %12.0f words/s\n",
+           name,threads,stats.modules,words,stats.relocations,stats.externs,best,stats.modules / best,words / best);
+    return failed;
+}
+
+int main(int argc,char **argv) {
+    struct assembler_options options = {0};
+    char output[BENCH_PATH_LEN];
+    char **files;
+    const char *dir = "/tmp";
+    linker from_files, from_units;
+    int i, k, modules = BENCH_MODULES, threads = BENCH_THREADS, repeats = REPEATS, failed = 0;
+    for(i=1;i<argc && argv[i][0] == '-';i++) {
+        if(i + 1 < argc && strcmp(argv[i],"-m") == 0) {
+            modules = atoi(argv[++i]);
+        }else if(i + 1 < argc && strcmp(argv[i],"-t") == 0) {
+            threads = atoi(argv[++i]);
+        }else if(i + 1 < argc && strcmp(argv[i],"-r") == 0) {
+            repeats = atoi(argv[++i]);
+        }else if(i + 1 < argc && strcmp(argv[i],"-d") == 0) {
+            dir = argv[++i];
+        }else {
+            fprintf(stderr,"usage: %s [-m modules] [-t threads] [-r repeats] [-d dir]\n",argv[0]);
+            return 1;
+        }
+    }
+    if(repeats < 1)
+        repeats = 1;
+    if(modules < 2)
+        modules = 2;
+    files      = malloc(modules * sizeof(char *));
+    from_files = linker_create(stderr);
+    from_units = linker_create(stderr);
+    if(!files || !from_files || !from_units)
+        return 1;
+    for(k=0;k<modules;k++) {
+        files[k] = malloc(BENCH_PATH_LEN);
+        if(!files[k])
+            return 1;
+        sprintf(files[k],"%.*s/linker-bench-%d",BENCH_PATH_LEN - 32,dir,k);
+        /* the assembler leaves the .ent and .ext files of an earlier run with more modules */
+        sprintf(output,"%s.ent",files[k]);
+        remove(output);
+        sprintf(output,"%s.ext",files[k]);
+        remove(output);
+        if(bench_generate(files[k],k,modules)) {
+            fprintf(stderr,"cannot write %s.as\n",files[k]);
+            return 1;
+        }
+        linker_add_file(from_files,files[k]);
+    }
+    options.parse_threads     = 1;
+    options.diagnostics       = stderr;
+    options.assembled         = bench_assembled;
+    options.assembled_context = from_units;
+    assemble_with_options(files,modules,&options);
+    sprintf(output,"%.*s/linker-bench-image",BENCH_PATH_LEN - 32,dir);
+    /* the files are read by every link, the translation units were copied once */
+    failed |= bench_link("files",from_files,output,1,repeats);
+    failed |= bench_link("files",from_files,output,threads,repeats);
+    failed |= bench_verify(output,modules);
+    failed |= bench_link("translation units",from_units,output,1,repeats);
+    failed |= bench_link("translation units",from_units,output,threads,repeats);
+    failed |= bench_verify(output,modules);
+    linker_destroy(from_files);
+    linker_destroy(from_units);
+    for(k=0;k<modules;k++)
+        free(files[k]);
+    free(files);
+    return failed;
+}
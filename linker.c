@@ -0,0 +1,627 @@
+#include "../inc/linker.h"
+#include "../../lang-engine/inc/lang-engine.h"
+#include "../../utilities/mem/inc/mem.h"
+#include "../../utilities/string-pool/inc/str-pool.h"
+#include "../../utilities/source-buffer/inc/source-buffer.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* characters of a word in the object file, without the new line */
+#define LINKER_OB_WORD_LEN 14
+/* the A,R,E bits of an operand word */
+#define LINKER_ARE_EXTERNAL 1
+#define LINKER_ARE_RELOCATABLE 2
+
+/**
+ * @brief a line of a .ent or .ext file.
+ * @param name
+ * @param address the address of an entry, or of the operand word that refers to an extern.
+ * @param resolved non zero once an extern was patched.
+ */
+struct linker_ref {
+    char            name[max_symbol_len + 1];
+    unsigned int    address;
+    int             resolved;
+};
+
+/* A module, and where the link places it. */
+struct linker_module {
+    char               *name;           /* The base name of its files, or the name of its translation unit. */
+    int                 from_file;      /* Non zero if it is read from its files by the link. */
+    int                 error;          /* Non zero if its files cannot be read. */
+    unsigned short     *words;          /* The code and then the data. */
+    size_t              code_words;
+    size_t              data_words;
+    struct linker_ref  *entries;
+    size_t              entry_count;
+    size_t              entry_capacity;
+    struct linker_ref  *externs;
+    size_t              extern_count;
+    size_t              extern_capacity;
+    size_t              code_base;      /* Where its code starts in the code of the image. */
+    size_t              data_base;      /* Where its data starts in the data of the image. */
+    unsigned long       relocations;
+};
+
+/* The linker structure. */
+struct linker {
+    FILE                   *diagnostics;
+    struct linker_module   *modules;
+    size_t                  module_count;
+    size_t                  module_capacity;
+    /* the link in progress */
+    str_pool                globals;            /* The names of the entries of all the modules. */
+    unsigned int           *global_addresses;   /* The address of every entry in the image, indexed by the id of its name. */
+    size_t                 *global_modules;     /* The index of the module that defines every entry, indexed by the id of its name. */
+    unsigned short         *image;              /* The code and then the data of the image. */
+    size_t                  code_words;
+    size_t                  data_words;
+    size_t                  next;               /* The next module a worker takes. */
+};
+
+/**
+ * @brief Creates a linker.
+ *
+ * @param diagnostics Where errors are printed
+ * @return linker The linker
+ */
+linker linker_create(FILE *diagnostics) {
+    linker l = mem_calloc(mem_tag_linker,1,sizeof(struct linker));
+    if(l)
+        l->diagnostics = diagnostics ? diagnostics : stdout;
+    return l;
+}
+
+/**
+ * @brief Adds a module without contents.
+ *
+ * @param l The linker
+ * @param name The name of the module
+ * @return struct linker_module* The module, NULL on allocation failure
+ */
+static struct linker_module *linker_new_module(linker l,const char *name) {
+    struct linker_module *modules, *m;
+    if(l->module_count == l->module_capacity) {
+        modules = mem_realloc(mem_tag_linker,l->modules,(l->module_capacity * 2 + 16) * sizeof(struct linker_module));
+        if(!modules)
+            return NULL;
+        l->modules = modules;
+        l->module_capacity = l->module_capacity * 2 + 16;
+    }
+    m = &l->modules[l->module_count];
+    memset(m,0,sizeof(struct linker_module));
+    m->name = mem_malloc(mem_tag_linker,strlen(name) + 1);
+    if(!m->name)
+        return NULL;
+    strcpy(m->name,name);
+    l->module_count++;
+    return m;
+}
+
+/**
+ * @brief Removes the module added last, when it could not be filled.
+ *
+ * @param l The linker
+ */
+static void linker_drop_last_module(linker l) {
+    struct linker_module *m = &l->modules[--l->module_count];
+    mem_free(m->name);
+    mem_free(m->words);
+    mem_free(m->entries);
+    mem_free(m->externs);
+    memset(m,0,sizeof(struct linker_module));
+}
+
+/**
+ * @brief Appends a line of a .ent or .ext file.
+ *
+ * @param refs The lines
+ * @param count Amount of lines
+ * @param capacity Room for lines
+ * @param name The name
+ * @param address The address
+ * @return int 0 on success, -1 on allocation failure
+ */
+static int linker_add_ref(struct linker_ref **refs,size_t *count,size_t *capacity,const char *name,unsigned int address) {
+    struct linker_ref *grown;
+    size_t len;
+    if(*count == *capacity) {
+        grown = mem_realloc(mem_tag_linker,*refs,(*capacity * 2 + 8) * sizeof(struct linker_ref));
+        if(!grown)
+            return -1;
+        *refs = grown;
+        *capacity = *capacity * 2 + 8;
+    }
+    len = strlen(name);
+    if(len > max_symbol_len)
+        len = max_symbol_len;
+    memcpy((*refs)[*count].name,name,len);
+    (*refs)[*count].name[len] = '\0';
+    (*refs)[*count].address  = address;
+    (*refs)[*count].resolved = 0;
+    (*count)++;
+    return 0;
+}
+
+/**
+ * @brief Adds a module that is read from its files.
+ *
+ * @param l The linker
+ * @param base_name The base name of its files
+ * @return int 0 on success, -1 otherwise
+ */
+int linker_add_file(linker l,const char *base_name) {
+    struct linker_module *m = linker_new_module(l,base_name);
+    if(!m)
+        return -1;
+    m->from_file = 1;
+    return 0;
+}
+
+/**
+ * @brief Adds a module from a translation unit.
+ *
+ * @param l The linker
+ * @param name The name of the module
+ * @param t_unit The translation unit
+ * @return int 0 on success, -1 otherwise, the module is not added then
+ */
+int linker_add_translation_unit(linker l,const char *name,const struct translation_unit *t_unit) {
+    struct linker_module *m = linker_new_module(l,name);
+    void *const* begin;
+    void *const* end;
+    void *const* begin_addr;
+    void *const* end_addr;
+    const struct symbol *symbol;
+    const struct extern_call *ec;
+    unsigned short *word;
+    int error = 0;
+    if(!m)
+        return -1;
+    m->code_words = gda_size(t_unit->bmc_code);
+    m->data_words = gda_size(t_unit->bmc_data);
+    m->words = mem_malloc(mem_tag_linker,(m->code_words + m->data_words + 1) * sizeof(unsigned short));
+    if(!m->words) {
+        linker_drop_last_module(l);
+        return -1;
+    }
+    word = m->words;
+    gda_for_each(t_unit->bmc_code,begin,end)
+        *word++ = *(unsigned short *)*begin & 0x3fff;
+    gda_for_each(t_unit->bmc_data,begin,end)
+        *word++ = *(unsigned short *)*begin & 0x3fff;
+    /* the same entries and extern references out_print_translation_unit writes to the .ent and .ext files */
+    gda_for_each(t_unit->symbol_table,begin,end) {
+        symbol = *begin;
+        if(symbol->sym_type == sym_type_code_entry || symbol->sym_type == sym_type_data_entry)
+            error |= linker_add_ref(&m->entries,&m->entry_count,&m->entry_capacity,symbol->symbol_name->string,symbol->addr);
+    }
+    gda_for_each(t_unit->extern_usage,begin,end) {
+        ec = *begin;
+        gda_for_each(ec->addresses,begin_addr,end_addr)
+            error |= linker_add_ref(&m->externs,&m->extern_count,&m->extern_capacity,ec->symbol_name->string,*(unsigned short *)*begin_addr);
+    }
+    /* a module without all of its entries and externs would link wrong */
+    if(error)
+        linker_drop_last_module(l);
+    return error;
+}
+
+/**
+ * @brief Reads the lines of a .ent or .ext file, a missing file has none.
+ *
+ * @param file_name The file
+ * @param refs The lines
+ * @param count Amount of lines
+ * @param capacity Room for lines
+ * @return int 0 on success, -1 on allocation failure
+ */
+static int linker_read_refs(const char *file_name,struct linker_ref **refs,size_t *count,size_t *capacity) {
+    char name[max_symbol_len + 2];
+    unsigned int address;
+    int error = 0;
+    FILE *in = fopen(file_name,"r");
+    if(!in)
+        return 0;
+    while(!error && fscanf(in,"%31s %u",name,&address) == 2)
+        error = linker_add_ref(refs,count,capacity,name,address);
+    fclose(in);
+    return error;
+}
+
+/**
+ * @brief Parses a count of the header of an object file, the contents are not null terminated.
+ *
+ * @param it The cursor, advanced past the count
+ * @param end The end of the contents
+ * @return unsigned long The count
+ */
+static unsigned long linker_parse_count(const char **it,const char *end) {
+    unsigned long count = 0;
+    while(*it < end && (**it == ' ' || **it == '\t'))
+        (*it)++;
+    while(*it < end && **it >= '0' && **it <= '9')
+        count = count * 10 + (*(*it)++ - '0');
+    return count;
+}
+
+/**
+ * @brief Reads the object file of a module.
+ *
+ * @param m The module
+ * @param file_name The object file
+ * @return int 0 on success, -1 otherwise
+ */
+static int linker_read_ob(struct linker_module *m,const char *file_name) {
+    source_buffer ob = source_buffer_open(file_name);
+    const char *it, *end;
+    unsigned int word;
+    size_t i, total;
+    int k, error = -1;
+    if(!ob)
+        return -1;
+    it  = source_buffer_begin(ob);
+    end = source_buffer_end(ob);
+    m->code_words = linker_parse_count(&it,end);
+    m->data_words = linker_parse_count(&it,end);
+    total = m->code_words + m->data_words;
+    /* every word takes a line, so a count larger than the file is malformed */
+    if(total < (size_t)(end - it) && (m->words = mem_malloc(mem_tag_linker,(total + 1) * sizeof(unsigned short)))) {
+        for(i=0;i<total;i++) {
+            while(it < end && (*it == '\n' || *it == '\r' || *it == ' ' || *it == '\t'))
+                it++;
+            if(end - it < LINKER_OB_WORD_LEN)
+                break;
+            /* '/' is odd and '.' is even, so the low bit of every character is its bit */
+            for(word=0,k=0;k<LINKER_OB_WORD_LEN && (it[k] == '/' || it[k] == '.');k++)
+                word = (word << 1) | (it[k] & 1);
+            if(k < LINKER_OB_WORD_LEN)
+                break;
+            m->words[i] = word;
+            it += LINKER_OB_WORD_LEN;
+        }
+        error = i < total ? -1 : 0;
+    }
+    source_buffer_close(ob);
+    return error;
+}
+
+/**
+ * @brief Reads the files of a module, a step of the link.
+ *
+ * @param l The linker
+ * @param m The module
+ */
+static void linker_read_module(linker l,struct linker_module *m) {
+    char *file_name;
+    (void)l;
+    if(!m->from_file)
+        return;
+    /* read again by every link, the files may have changed */
+    mem_free(m->words);
+    m->words        = NULL;
+    m->entry_count  = 0;
+    m->extern_count = 0;
+    file_name = mem_malloc(mem_tag_linker,strlen(m->name) + 5);
+    if(!file_name) {
+        m->error = 1;
+        return;
+    }
+    m->error = linker_read_ob(m,strcat(strcpy(file_name,m->name),".ob")) != 0 ||
+               linker_read_refs(strcat(strcpy(file_name,m->name),".ent"),&m->entries,&m->entry_count,&m->entry_capacity) != 0 ||
+               linker_read_refs(strcat(strcpy(file_name,m->name),".ext"),&m->externs,&m->extern_count,&m->extern_capacity) != 0;
+    mem_free(file_name);
+}
+
+/**
+ * @brief Returns where an address of a module is in the image.
+ * the code of the module moves to its place in the code of the image, and its data to its place in the data of the image.
+ *
+ * @param l The linker
+ * @param m The module
+ * @param address The address, as the module was assembled
+ * @return unsigned int The address in the image
+ */
+static unsigned int linker_relocate(const linker l,const struct linker_module *m,unsigned int address) {
+    if(address < LINKER_BASE_ADDR)
+        return address;
+    address -= LINKER_BASE_ADDR;
+    if(address < m->code_words)
+        return LINKER_BASE_ADDR + m->code_base + address;
+    return LINKER_BASE_ADDR + l->code_words + m->data_base + (address - m->code_words);
+}
+
+/**
+ * @brief Copies a module into the image, rebases its relocatable words and patches its extern references, a step of the link.
+ * a module only writes its own part of the image and the entries are only read, so modules are relocated concurrently.
+ *
+ * @param l The linker
+ * @param m The module
+ */
+static void linker_relocate_module(linker l,struct linker_module *m) {
+    unsigned short *code = l->image + m->code_base;
+    struct linker_ref *ref;
+    str_handle name;
+    size_t i, index;
+    m->relocations = 0;
+    memcpy(code,m->words,m->code_words * sizeof(unsigned short));
+    memcpy(l->image + l->code_words + m->data_base,m->words + m->code_words,m->data_words * sizeof(unsigned short));
+    /* only a symbol operand is relocatable, the first word of an instruction and the other operands are absolute */
+    for(i=0;i<m->code_words;i++) {
+        if((code[i] & 3) == LINKER_ARE_RELOCATABLE) {
+            code[i] = (linker_relocate(l,m,code[i] >> 2) << 2) | LINKER_ARE_RELOCATABLE;
+            m->relocations++;
+        }
+    }
+    for(i=0;i<m->extern_count;i++) {
+        ref   = &m->externs[i];
+        index = ref->address - LINKER_BASE_ADDR;
+        ref->resolved = 0;
+        if(ref->address < LINKER_BASE_ADDR || index >= m->code_words || (m->words[index] & 3) != LINKER_ARE_EXTERNAL)
+            continue;
+        name = str_pool_find(l->globals,ref->name);
+        if(name) {
+            code[index]  = (l->global_addresses[name->id] << 2) | LINKER_ARE_RELOCATABLE;
+            ref->resolved = 1;
+        }
+    }
+}
+
+/**
+ * @brief The thread of a step, takes modules until there are none left.
+ */
+struct linker_work {
+    linker l;
+    void (*step)(linker,struct linker_module *);
+};
+static void *linker_worker(void *arg) {
+    struct linker_work *work = arg;
+    size_t i;
+    while((i = __atomic_fetch_add(&work->l->next,1,__ATOMIC_RELAXED)) < work->l->module_count)
+        work->step(work->l,&work->l->modules[i]);
+    return NULL;
+}
+
+/**
+ * @brief Runs a step on every module, on up to threads threads.
+ *
+ * @param l The linker
+ * @param step The step
+ * @param threads The amount of threads, the calling thread is one of them
+ */
+static void linker_parallel(linker l,void (*step)(linker,struct linker_module *),int threads) {
+    struct linker_work work;
+    pthread_t *workers = NULL;
+    int *started = NULL;
+    int t;
+    work.l    = l;
+    work.step = step;
+    l->next   = 0;
+    if(threads > 1 && (size_t)threads > l->module_count)
+        threads = (int)l->module_count;
+    if(threads > 1) {
+        workers = mem_calloc(mem_tag_linker,threads,sizeof(pthread_t));
+        started = mem_calloc(mem_tag_linker,threads,sizeof(int));
+        /* without them the calling thread does it all */
+        if(!workers || !started)
+            threads = 1;
+    }
+    for(t=1;t<threads;t++)
+        started[t] = pthread_create(&workers[t],NULL,linker_worker,&work) == 0;
+    linker_worker(&work);
+    for(t=1;t<threads;t++) {
+        if(started[t])
+            pthread_join(workers[t],NULL);
+    }
+    mem_free(workers);
+    mem_free(started);
+}
+
+/**
+ * @brief Places the modules and makes every entry global.
+ *
+ * @param l The linker
+ * @return int 0 on success, -1 if an entry is defined twice or the image does not fit
+ */
+static int linker_place(linker l) {
+    struct linker_module *m;
+    str_handle name;
+    size_t i, k, entries = 0, defined = 0;
+    int error = 0;
+    l->code_words = 0;
+    l->data_words = 0;
+    for(i=0;i<l->module_count;i++) {
+        m = &l->modules[i];
+        m->code_base  = l->code_words;
+        m->data_base  = l->data_words;
+        l->code_words += m->code_words;
+        l->data_words += m->data_words;
+        entries       += m->entry_count;
+    }
+    if(LINKER_BASE_ADDR + l->code_words + l->data_words > LINKER_MAX_ADDR) {
+        fprintf(l->diagnostics,"error: the image takes %lu words, only %d fit in the address space.\n",
+                (unsigned long)(l->code_words + l->data_words),LINKER_MAX_ADDR - LINKER_BASE_ADDR);
+        return -1;
+    }
+    /* what a previous link left */
+    if(l->globals)
+        str_pool_destroy(l->globals);
+    mem_free(l->global_addresses);
+    mem_free(l->global_modules);
+    l->globals          = str_pool_create();
+    l->global_addresses = mem_malloc(mem_tag_linker,(entries + 1) * sizeof(unsigned int));
+    l->global_modules   = mem_malloc(mem_tag_linker,(entries + 1) * sizeof(size_t));
+    if(!l->globals || !l->global_addresses || !l->global_modules)
+        return -1;
+    /* names are interned in module order, so a new name gets the next id and an entry seen before is defined twice */
+    for(i=0;i<l->module_count;i++) {
+        m = &l->modules[i];
+        for(k=0;k<m->entry_count;k++) {
+            name = str_pool_intern(l->globals,m->entries[k].name);
+            if(!name)
+                return -1;
+            if(name->id < defined) {
+                fprintf(l->diagnostics,"%s: error: entry '%s' is already an entry of %s.\n",m->name,name->string,l->modules[l->global_modules[name->id]].name);
+                error = -1;
+                continue;
+            }
+            l->global_addresses[name->id] = linker_relocate(l,m,m->entries[k].address);
+            l->global_modules[name->id]   = i;
+            defined++;
+        }
+    }
+    return error;
+}
+
+/**
+ * @brief Writes the image as an object file, in the format out_print_translation_unit writes.
+ *
+ * @param l The linker
+ * @param file_name The object file
+ * @return int 0 on success, -1 otherwise
+ */
+static int linker_write_ob(linker l,const char *file_name) {
+    size_t total = l->code_words + l->data_words, i, len;
+    char *text = mem_malloc(mem_tag_linker,total * (LINKER_OB_WORD_LEN + 1) + 64);
+    unsigned int word;
+    int k, error;
+    FILE *out;
+    if(!text)
+        return -1;
+    len = sprintf(text,"%lu\t%lu\n",(unsigned long)l->code_words,(unsigned long)l->data_words);
+    if(l->code_words == 0)
+        text[len++] = '\n';
+    for(i=0;i<total;i++) {
+        for(word=l->image[i],k=LINKER_OB_WORD_LEN - 1;k>=0;k--,word >>= 1)
+            text[len + k] = word & 1 ? '/' : '.';
+        len += LINKER_OB_WORD_LEN;
+        text[len++] = '\n';
+        /* a blank line ends the code and another ends the data */
+        if(i + 1 == l->code_words || i + 1 == total)
+            text[len++] = '\n';
+    }
+    if(total == l->code_words)
+        text[len++] = '\n';
+    out = fopen(file_name,"w");
+    error = !out || fwrite(text,1,len,out) != len;
+    if(out && fclose(out))
+        error = 1;
+    mem_free(text);
+    return error ? -1 : 0;
+}
+
+/**
+ * @brief Writes every entry of the image, in module order.
+ *
+ * @param l The linker
+ * @param file_name The .ent file, not written if there are no entries
+ * @return int 0 on success, -1 otherwise
+ */
+static int linker_write_ent(linker l,const char *file_name) {
+    FILE *out = NULL;
+    const struct linker_module *m;
+    str_handle name;
+    size_t i, k;
+    int error = 0;
+    remove(file_name);
+    for(i=0;i<l->module_count && !error;i++) {
+        m = &l->modules[i];
+        for(k=0;k<m->entry_count;k++) {
+            if(!out && !(out = fopen(file_name,"w")))
+                return -1;
+            name = str_pool_find(l->globals,m->entries[k].name);
+            fprintf(out,"%s\t%u\n",name->string,l->global_addresses[name->id]);
+        }
+    }
+    if(out && fclose(out))
+        error = -1;
+    return error;
+}
+
+/**
+ * @brief Links the modules into a single image.
+ *
+ * @param l The linker
+ * @param output_base_name The base name of the image
+ * @param threads The amount of threads
+ * @param stats Output for the counters, may be NULL
+ * @return int 0 on success, -1 otherwise
+ */
+int linker_link(linker l,const char *output_base_name,int threads,struct linker_stats *stats) {
+    char *file_name = mem_malloc(mem_tag_linker,strlen(output_base_name) + 5);
+    struct linker_module *m;
+    size_t i, k;
+    int error = 0;
+    if(!file_name)
+        return -1;
+    linker_parallel(l,linker_read_module,threads);
+    for(i=0;i<l->module_count;i++) {
+        if(l->modules[i].error) {
+            fprintf(l->diagnostics,"%s: error: cannot read its .ob, .ent or .ext file.\n",l->modules[i].name);
+            error = -1;
+        }
+    }
+    if(!error)
+        error = linker_place(l);
+    if(!error) {
+        mem_free(l->image);
+        l->image = mem_malloc(mem_tag_linker,(l->code_words + l->data_words + 1) * sizeof(unsigned short));
+        if(!l->image)
+            error = -1;
+    }
+    if(!error) {
+        linker_parallel(l,linker_relocate_module,threads);
+        /* reported after the threads are done, in module order */
+        for(i=0;i<l->module_count;i++) {
+            m = &l->modules[i];
+            for(k=0;k<m->extern_count;k++) {
+                if(!m->externs[k].resolved) {
+                    fprintf(l->diagnostics,"%s: error: extern '%s' at %u is not an entry of any module.\n",m->name,m->externs[k].name,m->externs[k].address);
+                    error = -1;
+                }
+            }
+        }
+    }
+    if(!error)
+        error = linker_write_ob(l,strcat(strcpy(file_name,output_base_name),".ob"));
+    if(!error)
+        error = linker_write_ent(l,strcat(strcpy(file_name,output_base_name),".ent"));
+    if(stats) {
+        memset(stats,0,sizeof(struct linker_stats));
+        stats->modules    = l->module_count;
+        stats->code_words = l->code_words;
+        stats->data_words = l->data_words;
+        for(i=0;i<l->module_count;i++) {
+            stats->entries     += l->modules[i].entry_count;
+            stats->relocations += l->modules[i].relocations;
+            stats->externs     += l->modules[i].extern_count;
+        }
+    }
+    mem_free(file_name);
+    return error;
+}
+
+/**
+ * @brief Frees the linker.
+ *
+ * @param l The linker
+ */
+void linker_destroy(linker l) {
+    size_t i;
+    if(!l)
+        return;
+    for(i=0;i<l->module_count;i++) {
+        mem_free(l->modules[i].name);
+        mem_free(l->modules[i].words);
+        mem_free(l->modules[i].entries);
+        mem_free(l->modules[i].externs);
+    }
+    mem_free(l->modules);
+    if(l->globals)
+        str_pool_destroy(l->globals);
+    mem_free(l->global_addresses);
+    mem_free(l->global_modules);
+    mem_free(l->image);
+    mem_free(l);
+}
@@ -0,0 +1,84 @@
+#ifndef maman14_linker_h
+#define maman14_linker_h
+
+#include <stdio.h>
+#include <stddef.h>
+#include "../../assembler/inc/translation_unit.h"
+
+/* the address a linked image starts at, the same address every module was assembled at. */
+#define LINKER_BASE_ADDR 100
+/* words an image may take, an operand word holds a 12 bit address. */
+#define LINKER_MAX_ADDR 4096
+
+/* opaque struct */
+struct linker;
+typedef struct linker * linker;
+
+/**
+ * @brief counters of a link.
+ * @param modules
+ * @param code_words code of the image.
+ * @param data_words data of the image.
+ * @param entries entries of all the modules, every one of them global.
+ * @param relocations operand words rebased to where their module was placed.
+ * @param externs operand words patched with the address of an entry of another module.
+ */
+struct linker_stats {
+    unsigned long modules;
+    unsigned long code_words;
+    unsigned long data_words;
+    unsigned long entries;
+    unsigned long relocations;
+    unsigned long externs;
+};
+
+/**
+ * @brief creates a linker without modules.
+ *
+ * @param diagnostics where errors are printed, NULL prints them to stdout.
+ * @return linker returns NULL on allocation failure.
+ */
+linker linker_create(FILE *diagnostics);
+
+/**
+ * @brief adds the module base_name.ob, with base_name.ent and base_name.ext if there are. the files are read by linker_link.
+ *
+ * @param l
+ * @param base_name
+ * @return int 0 on success, -1 on allocation failure.
+ */
+int linker_add_file(linker l,const char *base_name);
+
+/**
+ * @brief adds a module from an assembled translation unit, it is copied so the translation unit may be destroyed right after.
+ *
+ * @param l
+ * @param name the name of the module in errors.
+ * @param t_unit
+ * @return int 0 on success, -1 on allocation failure, the module is not added then.
+ */
+int linker_add_translation_unit(linker l,const char *name,const struct translation_unit *t_unit);
+
+/**
+ * @brief links the modules in the order they were added into output_base_name.ob, and output_base_name.ent with every entry.
+ * the code of all the modules comes first and then their data, like the code and data of a single module.
+ * the modules are read and relocated on up to threads threads, the outcome does not depend on their amount.
+ * it may be called again, the files of the modules are read again then.
+ *
+ * @param l
+ * @param output_base_name
+ * @param threads 1 or less links on the calling thread.
+ * @param stats output for the counters, may be NULL.
+ * @return int 0 on success, -1 if a module cannot be read, an entry is defined twice, an extern is not an entry of any module,
+ * the image does not fit or the output cannot be written. nothing is written then.
+ */
+int linker_link(linker l,const char *output_base_name,int threads,struct linker_stats *stats);
+
+/**
+ * @brief frees the linker and its modules.
+ *
+ * @param l
+ */
+void linker_destroy(linker l);
+
+#endif
@@ -0,0 +1,367 @@
+#include "../inc/mem.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* names of the subsystems, in the order of enum mem_tag. */
+static const char *mem_tag_labels[mem_tag_count] = {
+    "gda",
+    "names",
+    "symbols",
+    "code",
+    "macros",
+    "first_pass",
+    "incremental",
+    "files",
+    "simulator",
+    "disasm",
+    "linker",
+    "includes",
+    "sources",
+    "rings",
+    "cache",
+    "server",
+    "trace"
+};
+
+/**
+ * @brief malloc as an allocator.
+ */
+static void *mem_libc_alloc(void *context,size_t size) {
+    (void)context;
+    return malloc(size);
+}
+
+/**
+ * @brief realloc as an allocator.
+ */
+static void *mem_libc_resize(void *context,void *block,size_t size) {
+    (void)context;
+    return realloc(block,size);
+}
+
+/**
+ * @brief free as an allocator.
+ */
+static void mem_libc_release(void *context,void *block) {
+    (void)context;
+    free(block);
+}
+
+static struct mem_allocator mem_allocator = {mem_libc_alloc,mem_libc_resize,mem_libc_release,NULL};
+
+#ifdef ASM_MEM
+/* The header in front of every block, the union keeps the block aligned the way malloc does. */
+union mem_header {
+    struct {
+        size_t      size;
+        int         tag;
+    } info;
+    long double     align_long_double;
+    void           *align_pointer;
+    long            align_long;
+};
+
+/* what is in use, index mem_tag_count holds all the subsystems together. */
+static long mem_bytes[mem_tag_count + 1];
+static long mem_blocks[mem_tag_count + 1];
+static long mem_allocations[mem_tag_count + 1];
+/* the peaks since the last snapshot. */
+static long mem_window_peaks[mem_tag_count + 1];
+/* the peak of the process. */
+static long mem_process_peak;
+
+/**
+ * @brief Raises a peak to value if it is lower.
+ *
+ * @param peak The peak
+ * @param value The value
+ */
+static void mem_raise(long *peak,long value) {
+    long old = __atomic_load_n(peak,__ATOMIC_RELAXED);
+    while(value > old && !__atomic_compare_exchange_n(peak,&old,value,1,__ATOMIC_RELAXED,__ATOMIC_RELAXED))
+        ;
+}
+
+/**
+ * @brief Accounts a change in the memory of a subsystem.
+ *
+ * @param tag The subsystem
+ * @param bytes The change in bytes
+ * @param blocks The change in blocks
+ * @param allocations The allocations made
+ */
+static void mem_account(int tag,long bytes,long blocks,long allocations) {
+    int i, indexes[2];
+    long now;
+    indexes[0] = tag;
+    indexes[1] = mem_tag_count;
+    for(i=0;i<2;i++) {
+        now = __atomic_add_fetch(&mem_bytes[indexes[i]],bytes,__ATOMIC_RELAXED);
+        __atomic_add_fetch(&mem_blocks[indexes[i]],blocks,__ATOMIC_RELAXED);
+        __atomic_add_fetch(&mem_allocations[indexes[i]],allocations,__ATOMIC_RELAXED);
+        if(bytes > 0) {
+            mem_raise(&mem_window_peaks[indexes[i]],now);
+            if(indexes[i] == mem_tag_count)
+                mem_raise(&mem_process_peak,now);
+        }
+    }
+}
+
+/**
+ * @brief Reads the usage of a subsystem.
+ *
+ * @param usage Output for the usage
+ * @param index The subsystem, mem_tag_count for all of them
+ */
+static void mem_read(struct mem_usage *usage,int index) {
+    usage->bytes       = __atomic_load_n(&mem_bytes[index],__ATOMIC_RELAXED);
+    usage->peak        = __atomic_load_n(&mem_window_peaks[index],__ATOMIC_RELAXED);
+    usage->allocations = __atomic_load_n(&mem_allocations[index],__ATOMIC_RELAXED);
+    usage->blocks      = __atomic_load_n(&mem_blocks[index],__ATOMIC_RELAXED);
+}
+#endif
+
+/**
+ * @brief Replaces the allocator.
+ *
+ * @param allocator The allocator, NULL for libc
+ */
+void mem_set_allocator(const struct mem_allocator *allocator) {
+    if(allocator) {
+        mem_allocator = *allocator;
+    }else {
+        mem_allocator.alloc   = mem_libc_alloc;
+        mem_allocator.resize  = mem_libc_resize;
+        mem_allocator.release = mem_libc_release;
+        mem_allocator.context = NULL;
+    }
+}
+
+/**
+ * @brief Allocates a block.
+ *
+ * @param tag The subsystem
+ * @param size The size
+ * @return void* The block
+ */
+void *mem_malloc(enum mem_tag tag,size_t size) {
+#ifdef ASM_MEM
+    union mem_header *header = mem_allocator.alloc(mem_allocator.context,sizeof(union mem_header) + size);
+    if(!header)
+        return NULL;
+    header->info.size = size;
+    header->info.tag  = tag;
+    mem_account(tag,(long)size,1,1);
+    return header + 1;
+#else
+    (void)tag;
+    return mem_allocator.alloc(mem_allocator.context,size);
+#endif
+}
+
+/**
+ * @brief Allocates a zeroed block.
+ *
+ * @param tag The subsystem
+ * @param count The amount of elements
+ * @param size The size of an element
+ * @return void* The block
+ */
+void *mem_calloc(enum mem_tag tag,size_t count,size_t size) {
+    void *block;
+    if(size && count > (size_t)-1 / size)
+        return NULL;
+    block = mem_malloc(tag,count * size);
+    if(block)
+        memset(block,0,count * size);
+    return block;
+}
+
+/**
+ * @brief Resizes a block.
+ *
+ * @param tag The subsystem of a new block
+ * @param block The block
+ * @param size The new size
+ * @return void* The resized block
+ */
+void *mem_realloc(enum mem_tag tag,void *block,size_t size) {
+#ifdef ASM_MEM
+    union mem_header *header;
+    size_t old_size;
+    if(!block)
+        return mem_malloc(tag,size);
+    header   = (union mem_header *)block - 1;
+    old_size = header->info.size;
+    header   = mem_allocator.resize(mem_allocator.context,header,sizeof(union mem_header) + size);
+    if(!header)
+        return NULL;
+    header->info.size = size;
+    mem_account(header->info.tag,(long)size - (long)old_size,0,0);
+    return header + 1;
+#else
+    (void)tag;
+    return mem_allocator.resize(mem_allocator.context,block,size);
+#endif
+}
+
+/**
+ * @brief Frees a block.
+ *
+ * @param block The block
+ */
+void mem_free(void *block) {
+#ifdef ASM_MEM
+    union mem_header *header;
+    if(!block)
+        return;
+    header = (union mem_header *)block - 1;
+    mem_account(header->info.tag,-(long)header->info.size,-1,0);
+    mem_allocator.release(mem_allocator.context,header);
+#else
+    mem_allocator.release(mem_allocator.context,block);
+#endif
+}
+
+/**
+ * @brief Takes a snapshot and restarts the peaks.
+ *
+ * @param snapshot Output for the snapshot
+ */
+void mem_snapshot(struct mem_stats *snapshot) {
+#ifdef ASM_MEM
+    int i;
+    for(i=0;i<=mem_tag_count;i++) {
+        __atomic_store_n(&mem_window_peaks[i],__atomic_load_n(&mem_bytes[i],__ATOMIC_RELAXED),__ATOMIC_RELAXED);
+        mem_read(i < mem_tag_count ? &snapshot->tags[i] : &snapshot->total,i);
+    }
+#else
+    memset(snapshot,0,sizeof(struct mem_stats));
+#endif
+}
+
+/**
+ * @brief Sets stats to the change since a snapshot.
+ *
+ * @param stats Output for the change
+ * @param snapshot The snapshot
+ */
+void mem_since(struct mem_stats *stats,const struct mem_stats *snapshot) {
+#ifdef ASM_MEM
+    int i;
+    struct mem_usage *usage;
+    const struct mem_usage *before;
+    for(i=0;i<=mem_tag_count;i++) {
+        usage  = i < mem_tag_count ? &stats->tags[i] : &stats->total;
+        before = i < mem_tag_count ? &snapshot->tags[i] : &snapshot->total;
+        mem_read(usage,i);
+        usage->bytes       -= before->bytes;
+        usage->peak        -= before->bytes;
+        usage->allocations -= before->allocations;
+        usage->blocks      -= before->blocks;
+    }
+#else
+    (void)snapshot;
+    memset(stats,0,sizeof(struct mem_stats));
+#endif
+}
+
+/**
+ * @brief Adds stats to a total.
+ *
+ * @param total The total
+ * @param stats The stats to add
+ */
+void mem_add(struct mem_stats *total,const struct mem_stats *stats) {
+    int i;
+    struct mem_usage *sum;
+    const struct mem_usage *usage;
+    for(i=0;i<=mem_tag_count;i++) {
+        sum   = i < mem_tag_count ? &total->tags[i] : &total->total;
+        usage = i < mem_tag_count ? &stats->tags[i] : &stats->total;
+        sum->bytes       += usage->bytes;
+        sum->allocations += usage->allocations;
+        sum->blocks      += usage->blocks;
+        if(usage->peak > sum->peak)
+            sum->peak = usage->peak;
+    }
+}
+
+/**
+ * @brief Prints a string as a JSON string.
+ *
+ * @param out The stream
+ * @param string The string
+ */
+static void mem_print_json_string(FILE *out,const char *string) {
+    fputc('"',out);
+    for(;*string;string++) {
+        if(*string == '"' || *string == '\\')
+            fprintf(out,"\\%c",*string);
+        else if((unsigned char)*string < 0x20)
+            fprintf(out,"\\u%04x",(unsigned char)*string);
+        else
+            fputc(*string,out);
+    }
+    fputc('"',out);
+}
+
+/**
+ * @brief Prints memory stats.
+ *
+ * @param out The stream
+ * @param name The file, NULL for the batch
+ * @param stats The stats
+ * @param json Non zero for JSON
+ */
+void mem_print(FILE *out,const char *name,const struct mem_stats *stats,int json) {
+    int i;
+    const struct mem_usage *usage;
+    if(json) {
+        if(name) {
+            fprintf(out,"{\"file\":");
+            mem_print_json_string(out,name);
+            fprintf(out,",\"memory\":{");
+        }else {
+            fprintf(out,"{\"batch\":true,\"memory\":{");
+        }
+        for(i=0;i<=mem_tag_count;i++) {
+            usage = i < mem_tag_count ? &stats->tags[i] : &stats->total;
+            fprintf(out,"%s\"%s\":{\"bytes\":%ld,\"peak\":%ld,\"allocations\":%ld,\"blocks\":%ld}",i ? "," : "",
+                    i < mem_tag_count ? mem_tag_labels[i] : "total",usage->bytes,usage->peak,usage->allocations,usage->blocks);
+        }
+        /* the counters are shared by every thread, see mem_snapshot */
+        fprintf(out,"},\"scope\":\"process\"}\n");
+        return;
+    }
+    fprintf(out,"%s memory:\n  %-12s %12s %12s %12s %12s\n",name ? name : "batch","","bytes","peak","allocations","blocks");
+    for(i=0;i<=mem_tag_count;i++) {
+        usage = i < mem_tag_count ? &stats->tags[i] : &stats->total;
+        fprintf(out,"  %-12s %12ld %12ld %12ld %12ld\n",i < mem_tag_count ? mem_tag_labels[i] : "total",
+                usage->bytes,usage->peak,usage->allocations,usage->blocks);
+    }
+    fprintf(out,"  counted for the whole process, work done concurrently by other threads is included\n");
+}
+
+/**
+ * @brief Prints the blocks still in use.
+ *
+ * @param out The stream
+ * @return long The amount of blocks still in use
+ */
+long mem_print_leaks(FILE *out) {
+#ifdef ASM_MEM
+    int i;
+    long blocks;
+    for(i=0;i<mem_tag_count;i++) {
+        blocks = __atomic_load_n(&mem_blocks[i],__ATOMIC_RELAXED);
+        if(blocks)
+            fprintf(out,"leak: %s: %ld blocks, %ld bytes\n",mem_tag_labels[i],blocks,__atomic_load_n(&mem_bytes[i],__ATOMIC_RELAXED));
+    }
+    fprintf(out,"peak: %ld bytes\n",__atomic_load_n(&mem_process_peak,__ATOMIC_RELAXED));
+    return __atomic_load_n(&mem_blocks[mem_tag_count],__ATOMIC_RELAXED);
+#else
+    (void)out;
+    return 0;
+#endif
+}
@@ -0,0 +1,160 @@
+#ifndef maman14_mem_h
+#define maman14_mem_h
+
+#include <stdio.h>
+#include <stddef.h>
+
+/*
+ * Allocations of the assembler, tagged by the subsystem that makes them, through a replaceable allocator.
+ * memory is accounted only when ASM_MEM is defined, every block then carries a small header with its size and tag.
+ * a block must be freed with mem_free, and a block of plain malloc must not be.
+ */
+
+/* the subsystems. */
+enum mem_tag {
+    mem_tag_gda,
+    mem_tag_names,
+    mem_tag_symbols,
+    mem_tag_code,
+    mem_tag_macros,
+    mem_tag_first_pass,
+    mem_tag_incremental,
+    mem_tag_files,
+    mem_tag_simulator,
+    mem_tag_disasm,
+    mem_tag_linker,
+    mem_tag_includes,
+    mem_tag_sources,
+    mem_tag_rings,
+    mem_tag_cache,
+    mem_tag_server,
+    mem_tag_trace,
+    mem_tag_count
+};
+
+/**
+ * @brief an allocator, the three functions have the semantics of malloc, realloc and free.
+ * @param alloc
+ * @param resize
+ * @param release
+ * @param context passed to the three of them.
+ */
+struct mem_allocator {
+    void   *(*alloc)(void *context,size_t size);
+    void   *(*resize)(void *context,void *block,size_t size);
+    void    (*release)(void *context,void *block);
+    void   *context;
+};
+
+/**
+ * @brief memory of a subsystem, or of all of them.
+ * @param bytes bytes in use, or the change in them.
+ * @param peak the most bytes in use at once.
+ * @param allocations blocks allocated.
+ * @param blocks blocks in use, or the change in them.
+ */
+struct mem_usage {
+    long    bytes;
+    long    peak;
+    long    allocations;
+    long    blocks;
+};
+
+/**
+ * @brief memory of every subsystem, and of all of them together.
+ * @param tags indexed by enum mem_tag.
+ * @param total
+ */
+struct mem_stats {
+    struct mem_usage    tags[mem_tag_count];
+    struct mem_usage    total;
+};
+
+/**
+ * @brief replaces the allocator, only while nothing allocated with the current one is in use.
+ *
+ * @param allocator copied, NULL restores malloc, realloc and free.
+ */
+void mem_set_allocator(const struct mem_allocator *allocator);
+
+/**
+ * @brief allocates size bytes.
+ *
+ * @param tag the subsystem.
+ * @param size
+ * @return void* NULL on allocation failure.
+ */
+void *mem_malloc(enum mem_tag tag,size_t size);
+
+/**
+ * @brief allocates count zeroed elements of size bytes.
+ *
+ * @param tag the subsystem.
+ * @param count
+ * @param size
+ * @return void* NULL on allocation failure.
+ */
+void *mem_calloc(enum mem_tag tag,size_t count,size_t size);
+
+/**
+ * @brief resizes a block, the way realloc does.
+ *
+ * @param tag the subsystem, used if block is NULL.
+ * @param block may be NULL.
+ * @param size
+ * @return void* NULL on allocation failure, block is then left as is.
+ */
+void *mem_realloc(enum mem_tag tag,void *block,size_t size);
+
+/**
+ * @brief frees a block.
+ *
+ * @param block may be NULL.
+ */
+void mem_free(void *block);
+
+/**
+ * @brief copies the memory in use into snapshot, and starts measuring the peaks from now.
+ * the counters are those of the process, not of the caller: what other threads allocate meanwhile is counted too,
+ * and a snapshot taken by another thread, e.g. for another file of the server, restarts the peaks of every open window.
+ * the stats of a window are exact only while no other work runs concurrently, mem_print says so.
+ *
+ * @param snapshot
+ */
+void mem_snapshot(struct mem_stats *snapshot);
+
+/**
+ * @brief sets stats to the change since snapshot, and the peaks to the most bytes in use above it.
+ *
+ * @param stats
+ * @param snapshot
+ */
+void mem_since(struct mem_stats *stats,const struct mem_stats *snapshot);
+
+/**
+ * @brief adds stats to total, the peaks are the higher of the two.
+ *
+ * @param total
+ * @param stats
+ */
+void mem_add(struct mem_stats *total,const struct mem_stats *stats);
+
+/**
+ * @brief prints stats as text, or as a single line of JSON, with a note that they are of the whole process.
+ *
+ * @param out
+ * @param name the file the stats belong to, NULL for the batch.
+ * @param stats
+ * @param json non zero prints JSON.
+ */
+void mem_print(FILE *out,const char *name,const struct mem_stats *stats,int json);
+
+/**
+ * @brief prints the blocks still in use by every subsystem, and the peak of the process. meant for shutdown.
+ *
+ * @param out
+ * @return long the amount of blocks still in use, 0 without ASM_MEM.
+ */
+long mem_print_leaks(FILE *out);
+
+#endif
@@ -1,8 +1,13 @@
 
 #include "../inc/out.h"
+#include "../../utilities/stats/inc/stats.h"
+#include "../../utilities/trace/inc/trace.h"
+#include "../../utilities/mem/inc/mem.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+/* characters of a word in the object file, without the new line */
+#define OUT_OB_WORD_LEN 14
 /**
  * @brief called only if there are externs for the program.
  * 
@@ -16,47 +21,60 @@ static void out_print_externs(gda externs_list,FILE * const ext_file) {
     void *const* end_addr;
     const struct extern_call * ec;
     gda_for_each(externs_list,begin,end) {
-        if(*begin !=NULL) {
-            ec = *begin;
-            gda_for_each(ec->addresses,begin_addr,end_addr) {
-                if(*begin_addr)
-                    fprintf(ext_file,"%s\t%hu\n",ec->symbol_name,*(unsigned short *)(*begin_addr));
-            }
+        ec = *begin;
+        gda_for_each(ec->addresses,begin_addr,end_addr) {
+            fprintf(ext_file,"%s\t%hu\n",ec->symbol_name->string,*(unsigned short *)(*begin_addr));
         }
     }
 }
 
 /**
- * @brief Prints the entry symbols and their addresses to a file with the extension .ent.
+ * @brief Prints the entry symbols and their addresses.
  * 
  * @param symbol_table the symbol table
- * @param base_name the base name of the output files
- * @return int 0 if successful, -1 otherwise 
+ * @param ent_file where they are printed, NULL only counts them.
+ * @return int the amount of entry symbols
  */
-
-static int out_print_entry(gda symbol_table, const char *base_name) {
+static int out_print_entries(gda symbol_table, FILE * const ent_file) {
     void *const* begin;
     void *const* end;
     const struct symbol *symbol;
-    FILE * ent_file = NULL;
-    char * ent_file_name = NULL;
+    int count = 0;
     gda_for_each(symbol_table, begin, end) {
-        if (*begin != NULL) {
-            symbol = *begin;
-            if (symbol->sym_type == sym_type_code_entry || symbol->sym_type == sym_type_data_entry) {
-                if(ent_file == NULL) {
-                    ent_file_name = malloc(strlen(base_name) + 5);
-                    strcat(strcpy(ent_file_name,base_name),".ent");
-                    ent_file = fopen(ent_file_name,"w");
-                }
-                fprintf(ent_file, "%s\t%u\n", symbol->symbol_name, symbol->addr);
-            }
+        symbol = *begin;
+        if (symbol->sym_type == sym_type_code_entry || symbol->sym_type == sym_type_data_entry) {
+            if(ent_file)
+                fprintf(ent_file, "%s\t%u\n", symbol->symbol_name->string, symbol->addr);
+            count++;
         }
     }
-    if(ent_file)
-        free(ent_file_name);
-    if(ent_file)
-        fclose(ent_file);
+    return count;
+}
+
+/**
+ * @brief Prints the entry symbols and their addresses to a file with the extension .ent, only if there are entries.
+ * 
+ * @param symbol_table the symbol table
+ * @param base_name the base name of the output files
+ * @return int 0 if successful, -1 otherwise 
+ */
+
+static int out_print_entry(gda symbol_table, const char *base_name) {
+    FILE * ent_file = NULL;
+    char * ent_file_name = NULL;
+    if(out_print_entries(symbol_table,NULL) == 0)
+        return 0;
+    ent_file_name = mem_malloc(mem_tag_files,strlen(base_name) + 5);
+    if(ent_file_name == NULL)
+        return -1;
+    strcat(strcpy(ent_file_name,base_name),".ent");
+    ent_file = fopen(ent_file_name,"w");
+    mem_free(ent_file_name);
+    if(ent_file == NULL)
+        return -1;
+    out_print_entries(symbol_table,ent_file);
+    STATS_ADD(stats_bytes_written,ftell(ent_file));
+    fclose(ent_file);
     return 0;
 }
 
@@ -65,7 +83,7 @@ static int out_print_entry(gda symbol_table, const char *base_name) {
  * 
  * @param bmc_code Binary machine code for the program code. 
  * @param bmc_data Binary machine code for the program data. 
- * @param ob_file ob_file Pointer to the output file for the object file.
+ * @param ob_file ob_file Pointer to the output file for the object file, left open.
  * @return int 
  */
 static int out_print_ob(gda bmc_code, gda bmc_data, FILE * const ob_file) {
@@ -73,53 +91,196 @@ static int out_print_ob(gda bmc_code, gda bmc_data, FILE * const ob_file) {
     void *const* bmc_it_end;
     gda it;
     int i;
-    unsigned short code;
+    unsigned short code, last = 0;
+    char line[OUT_OB_WORD_LEN + 1];
+    int formatted = 0;
     fprintf(ob_file,"%d\t%d\n",gda_size(bmc_code),gda_size(bmc_data));
+    line[OUT_OB_WORD_LEN] = '\n';
     for(it = bmc_code ;1;it=bmc_data){
         gda_for_each(it, bmc_it_begin, bmc_it_end) {
-            if (*bmc_it_begin != NULL) {
-                code = *(unsigned short *)*bmc_it_begin;
-                for(i=0;i<14;i++, code <<=1) {
-                    fprintf(ob_file,code & 0x2000 ? "/" : ".");
-                }
-                fprintf(ob_file,"\n");
+            code = *(unsigned short *)*bmc_it_begin;
+            /* a run of the same word, e.g. of .space or .fill, is formatted once */
+            if(!formatted || code != last) {
+                last = code;
+                formatted = 1;
+                for(i=0;i<OUT_OB_WORD_LEN;i++, code <<=1)
+                    line[i] = code & 0x2000 ? '/' : '.';
             }
+            fwrite(line,1,OUT_OB_WORD_LEN + 1,ob_file);
         }
         fprintf(ob_file,"\n");
         if(it == bmc_data)
             break;
     }
-    fclose(ob_file);
     return 0;
 }
- /**
-  * @brief Prints the output files (.ext, .ent, .ob) for a given translation unit
-
-@param tu Pointer to the translation unit to print output files for
-
-@param base_name Base name for the output files
-
-@return int Returns 0 upon successful completion, non-zero otherwise
+/**
+ * @brief Prints the .ext file, only if there are externs for the program.
+ * 
+ * @param tu the translation unit
+ * @param base_name the base name of the output files
  */
-int out_print_translation_unit(const struct translation_unit * tu,const char *base_name) {
+static void out_print_ext_file(const struct translation_unit * tu,const char *base_name) {
     FILE * out;
     char * out_file_name;
     if(gda_size(tu->extern_usage) > 0) {
-        out_file_name = malloc(strlen(base_name) + 5);
+        out_file_name = mem_malloc(mem_tag_files,strlen(base_name) + 5);
         strcat(strcpy(out_file_name,base_name),".ext");
         out = fopen(out_file_name,"w");
         if(out) {
             out_print_externs(tu->extern_usage,out);
+            STATS_ADD(stats_bytes_written,ftell(out));
+            fclose(out);
         }else {
 
         }
-        free(out_file_name);
-        fclose(out);
+        mem_free(out_file_name);
     }
+}
+/**
+ * @brief Rewrites a single word of an object file in place.
+ * 
+ * @param ob_file the object file, opened for update.
+ * @param offset the offset of the word line.
+ * @param code the word.
+ * @return int 0 if successful, -1 otherwise
+ */
+static int out_patch_word(FILE * ob_file,long offset,unsigned short code) {
+    char word[OUT_OB_WORD_LEN];
+    int i;
+    for(i=0;i<OUT_OB_WORD_LEN;i++, code <<=1) {
+        word[i] = code & 0x2000 ? '/' : '.';
+    }
+    if(fseek(ob_file,offset,SEEK_SET) != 0)
+        return -1;
+    STATS_ADD(stats_bytes_written,OUT_OB_WORD_LEN);
+    return fwrite(word,1,OUT_OB_WORD_LEN,ob_file) == OUT_OB_WORD_LEN ? 0 : -1;
+}
+/**
+ * @brief Patches the words of an object file that differ from the previous ones.
+ * 
+ * @param bmc the new words.
+ * @param old the previous words, as many as there are new ones.
+ * @param ob_file the object file, opened for update.
+ * @param offset the offset of the line of the first word.
+ * @return int 0 if successful, -1 otherwise
+ */
+static int out_patch_section(gda bmc,const unsigned short * old,FILE * ob_file,long offset) {
+    void *const* bmc_it_begin;
+    void *const* bmc_it_end;
+    unsigned short code;
+    gda_for_each(bmc, bmc_it_begin, bmc_it_end) {
+        code = *(unsigned short *)*bmc_it_begin;
+        if(code != *old && out_patch_word(ob_file,offset,code))
+            return -1;
+        old++;
+        offset += OUT_OB_WORD_LEN + 1;
+    }
+    return 0;
+}
+/**
+ * @brief Patches the object file in place, only the words that changed are written.
+ * 
+ * @param tu the translation unit
+ * @param base_name the base name of the output files
+ * @param old_code the words of the code section the object file holds.
+ * @param old_data the words of the data section the object file holds.
+ * @return int 0 if successful, -1 if the object file does not have the expected layout or on allocation failure.
+ */
+static int out_patch_ob(const struct translation_unit * tu,const char *base_name,const unsigned short * old_code,const unsigned short * old_data) {
+    char header[32];
+    char * out_file_name;
+    FILE * ob_file;
+    long header_len, data_offset;
+    int error = -1;
+    out_file_name = mem_malloc(mem_tag_files,strlen(base_name) + 4);
+    /* the caller falls back to rewriting the whole .ob file */
+    if(!out_file_name)
+        return -1;
+    strcat(strcpy(out_file_name,base_name),".ob");
+    ob_file = fopen(out_file_name,"r+");
+    mem_free(out_file_name);
+    if(!ob_file)
+        return -1;
+    /* the layout is the header line, a line per code word, an empty line, a line per data word and an empty line */
+    header_len  = sprintf(header,"%lu\t%lu\n",(unsigned long)gda_size(tu->bmc_code),(unsigned long)gda_size(tu->bmc_data));
+    data_offset = header_len + (long)gda_size(tu->bmc_code) * (OUT_OB_WORD_LEN + 1) + 1;
+    if(fseek(ob_file,0,SEEK_END) == 0 && ftell(ob_file) == data_offset + (long)gda_size(tu->bmc_data) * (OUT_OB_WORD_LEN + 1) + 1) {
+        error = out_patch_section(tu->bmc_code,old_code,ob_file,header_len);
+        if(error == 0)
+            error = out_patch_section(tu->bmc_data,old_data,ob_file,data_offset);
+    }
+    if(fclose(ob_file))
+        error = -1;
+    return error;
+}
+ /**
+  * @brief Prints the output files (.ext, .ent, .ob) for a given translation unit
+
+@param tu Pointer to the translation unit to print output files for
+
+@param base_name Base name for the output files
+
+@return int Returns 0 upon successful completion, non-zero otherwise
+ */
+int out_print_translation_unit(const struct translation_unit * tu,const char *base_name) {
+    char * out_file_name;
+    FILE * ob_file;
+    TRACE_BEGIN("write .ext",base_name);
+    out_print_ext_file(tu,base_name);
+    TRACE_END();
+    TRACE_BEGIN("write .ent",base_name);
     out_print_entry(tu->symbol_table,base_name);
-    out_file_name = malloc(strlen(base_name) + 4);
+    TRACE_END();
+    out_file_name = mem_malloc(mem_tag_files,strlen(base_name) + 4);
     strcat(strcpy(out_file_name,base_name),".ob");
-    out_print_ob(tu->bmc_code,tu->bmc_data,fopen(out_file_name,"w"));
-    free(out_file_name);
+    TRACE_BEGIN("write .ob",base_name);
+    ob_file = fopen(out_file_name,"w");
+    if(ob_file) {
+        out_print_ob(tu->bmc_code,tu->bmc_data,ob_file);
+        STATS_ADD(stats_bytes_written,ftell(ob_file));
+        fclose(ob_file);
+    }
+    TRACE_END();
+    mem_free(out_file_name);
     return 0;
-}
\ No newline at end of file
+}
+/**
+ * @brief Writes what the output files of a translation unit hold to streams.
+
+@param tu Pointer to the translation unit
+
+@param ob_file Receives the object file
+
+@param ent_file Receives the entries, nothing is written if there are none
+
+@param ext_file Receives the extern usages, nothing is written if there are none
+
+@return int Returns 0 upon successful completion, non-zero otherwise
+ */
+int out_write_translation_unit(const struct translation_unit * tu,FILE * ob_file,FILE * ent_file,FILE * ext_file) {
+    out_print_externs(tu->extern_usage,ext_file);
+    out_print_entries(tu->symbol_table,ent_file);
+    out_print_ob(tu->bmc_code,tu->bmc_data,ob_file);
+    return ferror(ob_file) || ferror(ent_file) || ferror(ext_file);
+}
+/**
+ * @brief Prints the .ext and .ent files and patches the .ob file in place, it is printed from scratch if it cannot be patched.
+ * 
+ * @param tu the translation unit
+ * @param base_name the base name of the output files
+ * @param old_code the words of the code section the .ob file holds, as many as tu has.
+ * @param old_data the words of the data section the .ob file holds, as many as tu has.
+ * @return int 0 if successful, non-zero otherwise
+ */
+int out_patch_translation_unit(const struct translation_unit * tu,const char *base_name,const unsigned short *old_code,const unsigned short *old_data) {
+    int patch_error;
+    TRACE_BEGIN("patch .ob",base_name);
+    patch_error = out_patch_ob(tu,base_name,old_code,old_data);
+    TRACE_END();
+    if(patch_error)
+        return out_print_translation_unit(tu,base_name);
+    out_print_ext_file(tu,base_name);
+    out_print_entry(tu->symbol_table,base_name);
+    return 0;
+}
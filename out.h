@@ -13,6 +13,28 @@
  */
 int out_print_translation_unit(const struct translation_unit * tu,const char *base_name);
 
+/**
+ * @brief writes what the .ob, .ent and .ext files of tu hold to the given streams instead of files, the streams are left open.
+ * 
+ * @param tu 
+ * @param ob_file 
+ * @param ent_file nothing is written if tu has no entries.
+ * @param ext_file nothing is written if tu has no externs.
+ * @return int 0 if successful, non zero if a stream has an error.
+ */
+int out_write_translation_unit(const struct translation_unit * tu,FILE * ob_file,FILE * ent_file,FILE * ext_file);
+
+/**
+ * @brief same as out_print_translation_unit, but the .ob file is patched in place, only the words that differ from the ones it holds are written.
+ * 
+ * @param tu 
+ * @param base_name 
+ * @param old_code the code words the .ob file holds, gda_size(tu->bmc_code) of them.
+ * @param old_data the data words the .ob file holds, gda_size(tu->bmc_data) of them.
+ * @return int 
+ */
+int out_patch_translation_unit(const struct translation_unit * tu,const char *base_name,const unsigned short *old_code,const unsigned short *old_data);
+
 
 
 
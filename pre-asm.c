@@ -3,17 +3,87 @@
 #include <string.h>
 #include <stdlib.h>
 #include "../../utilities/generic-dynamic-array/inc/gda.h"
+#include "../../utilities/source-buffer/inc/source-buffer.h"
+#include "../../utilities/stats/inc/stats.h"
+#include "../../utilities/trace/inc/trace.h"
+#include "../../utilities/mem/inc/mem.h"
+#include "../../utilities/terminal/inc/terminal.h"
 #include <ctype.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 #define MAX_LINE_LEN 80
 #define SPACES "\n \r\t\f\v"
 #define SKIP_SPACE(ptr) while(isspace(*ptr)) ptr++
+#define INCLUDE_DIRECTIVE ".include"
 /*
  * The macro structure represents a macro definition,
  * containing the macro's name and the lines it is composed of.
+ * the lines of a macro an included file defines are borrowed from the include cache.
  */
 struct macro {
-    char *macro_name;
+    str_handle macro_name;
     gda lines;
+    int borrowed;
+};
+
+/* The states of an included file, the errors of a broken file were printed while it was read. */
+enum include_state {
+    include_loading,
+    include_loaded,
+    include_unreadable,
+    include_broken
+};
+
+/*
+ * An item of the expanded text of an included file,
+ * either a line of text or another file it includes at that point.
+ */
+struct include_item {
+    char *line;
+    struct include_file *file;
+};
+
+/*
+ * An included file, read and expanded once for the whole cache.
+ * its macro table holds its own macros and those of the files it includes, named in the pool of the cache.
+ * emitted_in is the generation of the last .am file it was inserted into.
+ * mtime and size are the ones the file had when it was read, a cache kept between runs compares them to the file on disk.
+ * a file is found by its device and inode, whatever path reaches it, path is the first one it was read through.
+ * only a file that cannot be found on disk is found by its path.
+ */
+struct include_file {
+    char *path;
+    int identified;
+    dev_t device;
+    ino_t inode;
+    enum include_state state;
+    gda items;
+    gda macro_table;
+    unsigned long emitted_in;
+    time_t mtime;
+    long size;
+};
+
+/*
+ * The cache of included files, a generation is counted for every file that is pre-assembled with it.
+ */
+struct pre_asm_includes {
+    FILE *diagnostics;
+    str_pool names;
+    gda files;
+    unsigned long generation;
+};
+
+/*
+ * Where expanded text goes, the .am file and the sink,
+ * or the items of an included file while it is read.
+ */
+struct pre_asm_output {
+    FILE *am_file;
+    void (*sink)(void *context,const char *text);
+    void *context;
+    gda items;
 };
 
 /**
@@ -23,7 +93,7 @@ struct macro {
  * @return A pointer to the newly created line object.
  */
 static void line_dtor(void * candidate) {
-    free(candidate);
+    mem_free(candidate);
 }
 /**
  * @brief Create a new line object by deep copying the contents of the given line object.
@@ -34,7 +104,7 @@ static void line_dtor(void * candidate) {
 static void *line_ctor(const void *candidate) {
     void *ret;
     size_t str_len = strlen((const char *)candidate);
-    ret = calloc(str_len + 1, sizeof(char));
+    ret = mem_calloc(mem_tag_macros, str_len + 1, sizeof(char));
     if (!ret)
         return NULL;
     strcpy((char *)ret, (const char *)candidate);
@@ -50,16 +120,12 @@ static void *line_ctor(const void *candidate) {
  */
 static void * macro_ctor(const void *candidate) {
     const struct macro * c = candidate;
-    struct macro * ret = malloc(sizeof(struct macro));
+    struct macro * ret = mem_malloc(mem_tag_macros, sizeof(struct macro));
     if(ret ==NULL)
         return NULL;
-    ret->macro_name = malloc(strlen(c->macro_name) + 1);
-    if(ret->macro_name == NULL) {
-        free(ret);
-        return NULL;
-    }
-    strcpy(ret->macro_name,c->macro_name);
-    ret->lines = gda_create(line_ctor,line_dtor,NULL);
+    ret->macro_name = c->macro_name;
+    ret->borrowed = c->lines != NULL;
+    ret->lines = ret->borrowed ? c->lines : gda_create(line_ctor,line_dtor,NULL);
     return ret;
 }
 
@@ -70,12 +136,13 @@ static void * macro_ctor(const void *candidate) {
  */
 static void macro_dtor(void *candidate) {
     struct macro * c = candidate;
-    free(c->macro_name);
-    gda_destroy(c->lines);
+    if(!c->borrowed)
+        gda_destroy(c->lines);
+    mem_free(c);
 }
 
 /**
- * @brief Compare two macro objects based on their macro names.
+ * @brief Compare two macro objects based on the ids of their interned macro names.
  *
  * @param c1 A pointer to the first macro object.
  * @param c2 A pointer to the second macro object.
@@ -84,7 +151,107 @@ static void macro_dtor(void *candidate) {
 static int macro_cmpr(const void *c1,const void *c2) {
     const struct macro * mc1 = c1;
     const struct macro * mc2 = c2;
-    return strncmp(mc1->macro_name,mc2->macro_name, strlen(mc1->macro_name));
+    return (mc1->macro_name->id > mc2->macro_name->id) - (mc1->macro_name->id < mc2->macro_name->id);
+}
+
+/**
+ * @brief Create a new include item by copying the given one, its line is deep copied.
+ *
+ * @param candidate A pointer to the include item to copy.
+ * @return A pointer to the newly created include item.
+ */
+static void * include_item_ctor(const void *candidate) {
+    const struct include_item * c = candidate;
+    struct include_item * ret = mem_malloc(mem_tag_includes, sizeof(struct include_item));
+    if(ret == NULL)
+        return NULL;
+    ret->file = c->file;
+    ret->line = NULL;
+    if(c->line) {
+        ret->line = mem_malloc(mem_tag_includes, strlen(c->line) + 1);
+        if(ret->line == NULL) {
+            mem_free(ret);
+            return NULL;
+        }
+        strcpy(ret->line, c->line);
+    }
+    return ret;
+}
+
+/**
+ * @brief Destroy the given include item and its line.
+ *
+ * @param candidate A pointer to the include item to destroy.
+ */
+static void include_item_dtor(void *candidate) {
+    struct include_item * c = candidate;
+    mem_free(c->line);
+    mem_free(c);
+}
+
+/**
+ * @brief Create a new included file that is not read yet, with a copy of the path of the given one.
+ *
+ * @param candidate A pointer to the included file whose path is copied.
+ * @return A pointer to the newly created included file.
+ */
+static void * include_file_ctor(const void *candidate) {
+    const struct include_file * c = candidate;
+    struct include_file * ret = mem_calloc(mem_tag_includes, 1, sizeof(struct include_file));
+    if(ret == NULL)
+        return NULL;
+    ret->path        = mem_malloc(mem_tag_includes, strlen(c->path) + 1);
+    ret->items       = gda_create(include_item_ctor, include_item_dtor, NULL);
+    ret->macro_table = gda_create(macro_ctor, macro_dtor, macro_cmpr);
+    ret->state       = include_loading;
+    ret->identified  = c->identified;
+    ret->device      = c->device;
+    ret->inode       = c->inode;
+    if(ret->path == NULL || ret->items == NULL || ret->macro_table == NULL) {
+        if(ret->items)
+            gda_destroy(ret->items);
+        if(ret->macro_table)
+            gda_destroy(ret->macro_table);
+        mem_free(ret->path);
+        mem_free(ret);
+        return NULL;
+    }
+    strcpy(ret->path, c->path);
+    return ret;
+}
+
+/**
+ * @brief Destroy the given included file, its items and its macros.
+ *
+ * @param candidate A pointer to the included file to destroy.
+ */
+static void include_file_dtor(void *candidate) {
+    struct include_file * c = candidate;
+    gda_destroy(c->macro_table);
+    gda_destroy(c->items);
+    mem_free(c->path);
+    mem_free(c);
+}
+
+/**
+ * @brief Compare two included files based on their device and inode, files that cannot be found on disk come after them by their paths.
+ *
+ * @param c1 A pointer to the first included file.
+ * @param c2 A pointer to the second included file.
+ * @return An integer representing the comparison result.
+ */
+static int include_file_cmpr(const void *c1,const void *c2) {
+    const struct include_file * f1 = c1;
+    const struct include_file * f2 = c2;
+    if(f1->identified != f2->identified)
+        return f2->identified - f1->identified;
+    if(!f1->identified)
+        return strcmp(f1->path, f2->path);
+    if(f1->device != f2->device)
+        return f1->device < f2->device ? -1 : 1;
+    if(f1->inode != f2->inode)
+        return f1->inode < f2->inode ? -1 : 1;
+    return 0;
 }
 
 
@@ -100,10 +267,12 @@ enum line_type {
  * @brief Analyze a given line and determine its type, extracting the macro name if applicable, assuming no syntax error.
  *
  * @param line The input line to analyze.
- * @param macro_name A pointer to a char pointer that will hold the macro name (if applicable).
+ * @param macro_name A pointer to a handle that will hold the interned macro name (if applicable).
+ * @param macro_table The macros defined so far.
+ * @param names The pool macro names are interned into.
  * @return The line_type of the analyzed line.
  */
-static enum line_type determine_line_type(char *line, char **macro_name,gda macro_table) {
+static enum line_type determine_line_type(char *line, str_handle *macro_name,gda macro_table,str_pool names) {
     enum line_type type = macro_any_line;
     struct macro * find;
     struct macro temp = {0};
@@ -118,7 +287,7 @@ static enum line_type determine_line_type(char *line, char **macro_name,gda macr
         line = temp1;
         temp1 = strpbrk(line,SPACES);
         if(temp1) *temp1 = '\0';
-        (*macro_name) = line;
+        (*macro_name) = str_pool_intern(names,line);
         type = macro_def;
     }else {
         SKIP_SPACE(line);
@@ -135,10 +304,13 @@ static enum line_type determine_line_type(char *line, char **macro_name,gda macr
             }
 
         }
-        temp.macro_name = line;
+        /* a name that was never interned cannot be a macro */
+        temp.macro_name = str_pool_find(names,line_buffer);
+        if(temp.macro_name == NULL)
+            return type;
         find = gda_search(macro_table,&temp);
         if(find) {
-            *macro_name = line;
+            *macro_name = temp.macro_name;
             type = macro_call;
         }
     }
@@ -146,47 +318,212 @@ static enum line_type determine_line_type(char *line, char **macro_name,gda macr
 }
 
 /**
- * @brief Process the input assembly code and replace macro calls with their definitions, writing the result to an output file.
+ * @brief Writes expanded text to the .am file and hands it to the sink, if there is one,
+ * or adds it to the items of the included file being read.
  *
- * @param base_name The base name of the input assembly file.
- * @return A pointer to the string containing the output file name.
+ * @param out Where the text goes.
+ * @param text The text to write.
  */
-const char * asm_pre_asm(const char *base_name) {
-    gda macro_table;
-
-    struct macro *macro_context = NULL;
-    struct macro *sm  = NULL;
-    char *as_name = NULL, *am_name = NULL;
-    struct macro local_macro = {0};
-    FILE *as_file = NULL, *am_file = NULL;
-    size_t len;
+static void pre_asm_emit(struct pre_asm_output *out,const char *text) {
+    struct include_item item = {0};
+    if(out->items) {
+        item.line = (char *)text;
+        gda_insert(out->items, &item);
+    } else {
+        if(out->am_file)
+            fprintf(out->am_file, "%s", text);
+        if(out->sink)
+            out->sink(out->context,text);
+    }
+}
 
-    char line_buffer[MAX_LINE_LEN] = {0};
+/**
+ * @brief Writes the expanded text of an included file, and of the files it includes, unless it was already written into the same .am file.
+ * while another included file is read, only a reference to the file is added to its items.
+ *
+ * @param includes The include cache.
+ * @param out Where the text goes.
+ * @param file The included file.
+ */
+static void pre_asm_emit_file(pre_asm_includes includes,struct pre_asm_output *out,struct include_file *file) {
+    struct include_item item = {0};
+    const struct include_item *runner;
     void *const *begin;
     void *const *end;
-    len = strlen(base_name) + 3;
-    as_name = malloc(len + 1);
-    am_name = malloc(len + 1);
+    if(out->items) {
+        item.file = file;
+        gda_insert(out->items, &item);
+    } else if(file->emitted_in != includes->generation) {
+        file->emitted_in = includes->generation;
+        gda_for_each(file->items, begin, end) {
+            runner = *begin;
+            if(runner->line)
+                pre_asm_emit(out, runner->line);
+            else
+                pre_asm_emit_file(includes, out, runner->file);
+        }
+    }
+}
 
-    if (as_name == NULL || am_name == NULL)
-        return NULL;
+/**
+ * @brief Makes the macros of an included file visible, a macro that is already defined keeps its definition.
+ * the lines of the macros are borrowed, not copied.
+ *
+ * @param macro_table The macros defined so far.
+ * @param names The pool the names of macro_table are interned into.
+ * @param file The included file.
+ */
+static void pre_asm_merge_macros(gda macro_table,str_pool names,const struct include_file *file) {
+    struct macro borrowed = {0};
+    const struct macro *runner;
+    void *const *begin;
+    void *const *end;
+    gda_for_each(file->macro_table, begin, end) {
+        runner = *begin;
+        borrowed.macro_name = str_pool_intern(names, runner->macro_name->string);
+        borrowed.lines = runner->lines;
+        if(borrowed.macro_name && gda_search(macro_table, &borrowed) == NULL)
+            gda_insert(macro_table, &borrowed);
+    }
+}
 
-    strcat(strcpy(as_name, base_name), ".as");
-    strcat(strcpy(am_name, base_name), ".am");
+/**
+ * @brief Returns the path of the file an .include line names, a relative path starts from the directory of the including file.
+ *
+ * @param line The line.
+ * @param file_name The path of the including file.
+ * @param path Output for the path, freed with mem_free. NULL if the line is not an .include line.
+ * @return 0 if the line is a well formed .include line or not an .include line at all, -1 if it is malformed or on allocation failure.
+ */
+static int pre_asm_include_path(const char *line,const char *file_name,char **path) {
+    const char *name, *name_end, *dir_end;
+    size_t dir_len, len = strlen(INCLUDE_DIRECTIVE);
+    *path = NULL;
+    SKIP_SPACE(line);
+    if(strncmp(line, INCLUDE_DIRECTIVE, len) != 0 || (line[len] != '\0' && !isspace(line[len])))
+        return 0;
+    line += len;
+    SKIP_SPACE(line);
+    if(*line != '"')
+        return -1;
+    name = line + 1;
+    name_end = strchr(name, '"');
+    if(name_end == NULL || name_end == name)
+        return -1;
+    line = name_end + 1;
+    SKIP_SPACE(line);
+    if(*line != '\0')
+        return -1;
+    dir_end = strrchr(file_name, '/');
+    dir_len = *name != '/' && dir_end ? (size_t)(dir_end - file_name + 1) : 0;
+    *path = mem_malloc(mem_tag_files, dir_len + (name_end - name) + 1);
+    if(*path == NULL)
+        return -1;
+    memcpy(*path, file_name, dir_len);
+    memcpy(*path + dir_len, name, name_end - name);
+    (*path)[dir_len + (name_end - name)] = '\0';
+    return 0;
+}
 
+static int pre_asm_expand(pre_asm_includes includes,const char *file_name,source_buffer source,gda macro_table,str_pool names,struct pre_asm_output *out);
 
-    as_file = fopen(as_name, "r");
-    am_file = fopen(am_name, "w");
-    if (as_file == NULL || am_file == NULL) {
-        /* error printing...*/
-        free(as_name);
-        free(am_name);
+/**
+ * @brief Returns the included file of a path, reading and expanding it if it is not in the cache yet.
+ * two paths of the same file, like a.inc and sub/../a.inc, return the same included file, so it is expanded once and a cycle through either is found.
+ *
+ * @param includes The include cache.
+ * @param path The path of the file, as the .include line wrote it.
+ * @return The included file, its state tells if it was read, could not be read, had errors or is still being read. NULL on allocation failure.
+ */
+static struct include_file * pre_asm_include_load(pre_asm_includes includes,const char *path) {
+    struct include_file key = {0};
+    struct include_file *file;
+    struct pre_asm_output out = {0};
+    struct stat st;
+    source_buffer source;
+    key.path = (char *)path;
+    if(stat(path, &st) == 0) {
+        key.identified = 1;
+        key.device     = st.st_dev;
+        key.inode      = st.st_ino;
+    }
+    file = gda_search(includes->files, &key);
+    if(file) {
+        STATS_ADD(stats_include_hits, 1);
+        return file;
+    }
+    file = gda_insert(includes->files, &key);
+    if(file == NULL)
         return NULL;
+    if(key.identified) {
+        file->mtime = st.st_mtime;
+        file->size  = (long)st.st_size;
+    }
+    source = source_buffer_open(path);
+    if(source) {
+        STATS_ADD(stats_includes_read, 1);
+        TRACE_BEGIN("include", file->path);
+        out.items = file->items;
+        file->state = pre_asm_expand(includes, file->path, source, file->macro_table, includes->names, &out) == 0 ? include_loaded : include_broken;
+        TRACE_END();
+        source_buffer_close(source);
+    } else {
+        file->state = include_unreadable;
     }
+    return file;
+}
 
-    macro_table = gda_create(macro_ctor, macro_dtor, macro_cmpr);
-    while (fgets(line_buffer, MAX_LINE_LEN, as_file)) {
-        switch (determine_line_type(line_buffer, &local_macro.macro_name,macro_table)) {
+/**
+ * @brief Expands a file, writing every line that is not part of a macro definition and the lines of every macro call to out.
+ *
+ * @param includes The include cache the files it includes are read through.
+ * @param file_name The path of the file, for errors and to resolve the paths it includes.
+ * @param source The contents of the file.
+ * @param macro_table The macros defined so far, the macros of the file are added to it.
+ * @param names The pool macro names are interned into.
+ * @param out Where the expanded text goes.
+ * @return 0 on success, -1 if an .include is malformed or names a file that cannot be read.
+ */
+static int pre_asm_expand(pre_asm_includes includes,const char *file_name,source_buffer source,gda macro_table,str_pool names,struct pre_asm_output *out) {
+    struct macro *macro_context = NULL;
+    struct macro *sm  = NULL;
+    struct macro local_macro = {0};
+    struct include_file *file;
+    const char *cursor;
+    char *path;
+    char line_buffer[MAX_LINE_LEN] = {0};
+    void *const *begin;
+    void *const *end;
+    int line = 0, error = 0;
+
+    /* the file is read once, lines are copied out of it with the splitting fgets(line_buffer,MAX_LINE_LEN,...) does */
+    cursor = source_buffer_begin(source);
+    while (source_buffer_next_line(&cursor, source_buffer_end(source), line_buffer, MAX_LINE_LEN)) {
+        STATS_ADD(stats_lines_read, 1);
+        line++;
+        if (pre_asm_include_path(line_buffer, file_name, &path) != 0 || (path && macro_context)) {
+            fprintf(includes->diagnostics, "%s:%d: " TERMINAL_RED "error: " TERMINAL_RESET "%s\n", file_name, line,
+                    path ? ".include inside a macro definition" : "expected .include \"file\"");
+            mem_free(path);
+            error = -1;
+            continue;
+        }
+        if (path) {
+            file = pre_asm_include_load(includes, path);
+            if (file == NULL || file->state != include_loaded) {
+                /* the errors of a broken file were already printed where they are */
+                if (file == NULL || file->state != include_broken)
+                    fprintf(includes->diagnostics, "%s:%d: " TERMINAL_RED "error: " TERMINAL_RESET "cannot include '%s'%s\n", file_name, line, path,
+                            file && file->state == include_loading ? ", it includes itself" : "");
+                error = -1;
+            } else {
+                pre_asm_merge_macros(macro_table, names, file);
+                pre_asm_emit_file(includes, out, file);
+            }
+            mem_free(path);
+            continue;
+        }
+        switch (determine_line_type(line_buffer, &local_macro.macro_name,macro_table,names)) {
             case macro_def:
                 /* assuming no nested macro defs are given....*/
                 /*local_macro.lines = gda_create(line_ctor, line_dtor, (int (*)(const void *, const void *)) strcmp); */
@@ -206,27 +543,285 @@ const char * asm_pre_asm(const char *base_name) {
                 if (sm == NULL) {
                     /* no such macro... error.*/
                 } else {
+                    STATS_ADD(stats_macro_expansions, 1);
+                    TRACE_BEGIN("mcr", sm->macro_name->string);
                     gda_for_each(sm->lines, begin, end) {
-                        if (*begin) {
-                            fprintf(am_file, "%s", (char *)(*begin));
-                        }
+                        pre_asm_emit(out, (char *)(*begin));
                     }
+                    TRACE_END();
                 }
                 break;
 
             case macro_any_line:
                 if (macro_context == NULL) {
-                        fprintf(am_file, "%s", line_buffer);
+                        pre_asm_emit(out, line_buffer);
                 } else {
                     gda_insert(macro_context->lines, line_buffer);
                 }
                 break;
         }
-        memset(line_buffer,0,sizeof(line_buffer));
     }
-    fclose(as_file);
-    fclose(am_file);
-    free(as_name);
+    return error;
+}
+
+/**
+ * @brief Creates an empty include cache.
+ *
+ * @param diagnostics Where errors are printed, NULL prints them to stdout.
+ * @return The include cache, NULL on allocation failure.
+ */
+pre_asm_includes pre_asm_includes_create(FILE *diagnostics) {
+    pre_asm_includes includes = mem_malloc(mem_tag_includes, sizeof(struct pre_asm_includes));
+    if(includes == NULL)
+        return NULL;
+    includes->diagnostics = diagnostics ? diagnostics : stdout;
+    includes->names       = str_pool_create();
+    includes->files       = gda_create(include_file_ctor, include_file_dtor, include_file_cmpr);
+    includes->generation  = 0;
+    if(includes->names == NULL || includes->files == NULL) {
+        if(includes->names)
+            str_pool_destroy(includes->names);
+        if(includes->files)
+            gda_destroy(includes->files);
+        mem_free(includes);
+        return NULL;
+    }
+    return includes;
+}
+
+/**
+ * @brief Calls visit with an included file and the files it includes, unless it was visited in the current generation.
+ *
+ * @param includes The include cache.
+ * @param file The included file.
+ * @param visit Called with the path of every file.
+ * @param context Passed to visit.
+ */
+static void pre_asm_includes_visit(pre_asm_includes includes,struct include_file *file,void (*visit)(void *context,const char *path),void *context) {
+    const struct include_item *runner;
+    void *const *begin;
+    void *const *end;
+    if(file->emitted_in == includes->generation)
+        return;
+    file->emitted_in = includes->generation;
+    visit(context, file->path);
+    gda_for_each(file->items, begin, end) {
+        runner = *begin;
+        if(runner->file)
+            pre_asm_includes_visit(includes, runner->file, visit, context);
+    }
+}
+
+/**
+ * @brief Calls visit with the path of every file base_name.as includes, directly or through another included file, once each.
+ *
+ * @param includes The include cache the files are read into.
+ * @param base_name The base name of the input assembly file.
+ * @param visit Called with the path of every file.
+ * @param context Passed to visit.
+ * @return 0 on success, -1 if a file cannot be read, an .include is malformed or a file includes itself.
+ */
+int pre_asm_includes_of(pre_asm_includes includes,const char *base_name,void (*visit)(void *context,const char *path),void *context) {
+    struct include_file *file;
+    source_buffer as_file;
+    const char *cursor;
+    char *as_name, *path;
+    char line_buffer[MAX_LINE_LEN] = {0};
+    int error = 0;
+    as_name = mem_malloc(mem_tag_files, strlen(base_name) + 4);
+    if(as_name == NULL)
+        return -1;
+    strcat(strcpy(as_name, base_name), ".as");
+    as_file = source_buffer_open(as_name);
+    if(as_file == NULL) {
+        mem_free(as_name);
+        return -1;
+    }
+    includes->generation++;
+    cursor = source_buffer_begin(as_file);
+    while (error == 0 && source_buffer_next_line(&cursor, source_buffer_end(as_file), line_buffer, MAX_LINE_LEN)) {
+        if(pre_asm_include_path(line_buffer, as_name, &path) != 0) {
+            error = -1;
+        } else if(path) {
+            file = pre_asm_include_load(includes, path);
+            if(file && file->state == include_loaded)
+                pre_asm_includes_visit(includes, file, visit, context);
+            else
+                error = -1;
+            mem_free(path);
+        }
+    }
+    source_buffer_close(as_file);
+    mem_free(as_name);
+    return error;
+}
+
+/**
+ * @brief Tells if every file in the cache was read without errors and is unchanged on disk since.
+ *
+ * @param includes The include cache.
+ * @return 1 if the cache can be used for another run, 0 otherwise.
+ */
+int pre_asm_includes_unchanged(pre_asm_includes includes) {
+    const struct include_file *file;
+    struct stat st;
+    void *const *begin;
+    void *const *end;
+    gda_for_each(includes->files, begin, end) {
+        file = *begin;
+        /* the errors of a file that was not loaded are printed only when it is read, so it is read again */
+        if(file->state != include_loaded || stat(file->path, &st) != 0 || st.st_dev != file->device || st.st_ino != file->inode ||
+           st.st_mtime != file->mtime || (long)st.st_size != file->size)
+            return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Sets where the errors of the files read from now on are printed.
+ *
+ * @param includes The include cache.
+ * @param diagnostics NULL prints them to stdout.
+ */
+void pre_asm_includes_set_diagnostics(pre_asm_includes includes,FILE *diagnostics) {
+    includes->diagnostics = diagnostics ? diagnostics : stdout;
+}
+
+/**
+ * @brief Destroys the include cache, every file in it and the pool their macro names are interned into.
+ *
+ * @param includes The include cache.
+ */
+void pre_asm_includes_destroy(pre_asm_includes includes) {
+    gda_destroy(includes->files);
+    str_pool_destroy(includes->names);
+    mem_free(includes);
+}
+
+/**
+ * @brief Process the input assembly code and replace macro calls with their definitions, writing the result to an output file.
+ *
+ * @param base_name The base name of the input assembly file.
+ * @param names The pool macro names are interned into.
+ * @return A pointer to the string containing the output file name.
+ */
+const char * asm_pre_asm(const char *base_name,str_pool names) {
+    return asm_pre_asm_with_includes(base_name,names,NULL,NULL,NULL);
+}
+
+/**
+ * @brief Same as asm_pre_asm, and every piece of text written to the .am file is also handed to sink as soon as it is expanded.
+ *
+ * @param base_name The base name of the input assembly file.
+ * @param names The pool macro names are interned into.
+ * @param sink Called with each piece of expanded text, in order. may be NULL.
+ * @param context Passed to sink.
+ * @return A pointer to the string containing the output file name.
+ */
+const char * asm_pre_asm_to_sink(const char *base_name,str_pool names,void (*sink)(void *context,const char *text),void *context) {
+    return asm_pre_asm_with_includes(base_name,names,NULL,sink,context);
+}
+
+/**
+ * @brief Expands base_name.as, writing the expanded text to base_name.am and handing it to the sink.
+ *
+ * @param base_name The base name of the input assembly file.
+ * @param names The pool macro names are interned into.
+ * @param includes The include cache, NULL reads the included files for this file alone.
+ * @param write_am Zero does not write the .am file, the text only goes to the sink.
+ * @param sink Called with each piece of expanded text, in order. may be NULL.
+ * @param context Passed to sink.
+ * @return A pointer to the string containing the name of the .am file, NULL on failure.
+ */
+static const char * pre_asm_run(const char *base_name,str_pool names,pre_asm_includes includes,int write_am,void (*sink)(void *context,const char *text),void *context) {
+    gda macro_table;
+    pre_asm_includes own_includes = NULL;
+    struct pre_asm_output out = {0};
+    char *as_name = NULL, *am_name = NULL;
+    source_buffer as_file = NULL;
+    FILE *am_file = NULL;
+    size_t len;
+    int error;
+
+    len = strlen(base_name) + 3;
+    as_name = mem_malloc(mem_tag_files, len + 1);
+    am_name = mem_malloc(mem_tag_files, len + 1);
+    if (includes == NULL)
+        includes = own_includes = pre_asm_includes_create(NULL);
+
+    if (as_name == NULL || am_name == NULL || includes == NULL) {
+        if (own_includes)
+            pre_asm_includes_destroy(own_includes);
+        mem_free(as_name);
+        mem_free(am_name);
+        return NULL;
+    }
+
+    strcat(strcpy(as_name, base_name), ".as");
+    strcat(strcpy(am_name, base_name), ".am");
+
+
+    as_file = source_buffer_open(as_name);
+    if (write_am)
+        am_file = fopen(am_name, "w");
+    if (as_file == NULL || (write_am && am_file == NULL)) {
+        /* error printing...*/
+        if (as_file)
+            source_buffer_close(as_file);
+        if (am_file)
+            fclose(am_file);
+        if (own_includes)
+            pre_asm_includes_destroy(own_includes);
+        mem_free(as_name);
+        mem_free(am_name);
+        return NULL;
+    }
+
+    /* every file the .as file includes is inserted once into this .am file */
+    includes->generation++;
+    macro_table = gda_create(macro_ctor, macro_dtor, macro_cmpr);
+    out.am_file = am_file;
+    out.sink    = sink;
+    out.context = context;
+    error = pre_asm_expand(includes, as_name, as_file, macro_table, names, &out);
+    source_buffer_close(as_file);
+    if (am_file)
+        fclose(am_file);
+    mem_free(as_name);
     gda_destroy(macro_table);
+    if (own_includes)
+        pre_asm_includes_destroy(own_includes);
+    if (error) {
+        mem_free(am_name);
+        return NULL;
+    }
     return am_name;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Same as asm_pre_asm_to_sink, the included files are read through an include cache.
+ *
+ * @param base_name The base name of the input assembly file.
+ * @param names The pool macro names are interned into.
+ * @param includes The include cache, NULL reads the included files for this file alone.
+ * @param sink Called with each piece of expanded text, in order. may be NULL.
+ * @param context Passed to sink.
+ * @return A pointer to the string containing the output file name, NULL on failure.
+ */
+const char * asm_pre_asm_with_includes(const char *base_name,str_pool names,pre_asm_includes includes,void (*sink)(void *context,const char *text),void *context) {
+    return pre_asm_run(base_name,names,includes,1,sink,context);
+}
+
+/**
+ * @brief Same as asm_pre_asm_with_includes, without writing the .am file.
+ *
+ * @param base_name The base name of the input assembly file.
+ * @param names The pool macro names are interned into.
+ * @param includes The include cache, NULL reads the included files for this file alone.
+ * @param sink Called with each piece of expanded text, in order.
+ * @param context Passed to sink.
+ * @return The name the .am file would have, NULL on failure.
+ */
+const char * asm_pre_asm_to_memory(const char *base_name,str_pool names,pre_asm_includes includes,void (*sink)(void *context,const char *text),void *context) {
+    return pre_asm_run(base_name,names,includes,0,sink,context);
+}
@@ -1,15 +1,107 @@
 #ifndef maman14_pre_asm_h
 #define maman14_pre_asm_h
+#include <stdio.h>
+#include "../../utilities/string-pool/inc/str-pool.h"
 
+/*
+ * .include "file" on a line of its own inserts the expanded text of file, a path relative to the directory of the including file.
+ * an included file is expanded on its own, with its own macros and those of the files it includes, and those macros can be called
+ * by the including file after the .include line. a file is inserted at most once into the .am file, a later .include of it
+ * only makes its macros visible.
+ */
+
+/* opaque struct */
+struct pre_asm_includes;
+typedef struct pre_asm_includes * pre_asm_includes;
+
+/**
+ * @brief creates a cache of included files, every file is read and its macros scanned once however many files include it.
+ *
+ * @param diagnostics where errors are printed, NULL prints them to stdout.
+ * @return pre_asm_includes returns NULL on allocation failure.
+ */
+pre_asm_includes pre_asm_includes_create(FILE *diagnostics);
+
+/**
+ * @brief calls visit with the path of every file base_name.as includes, directly or through another included file, once each.
+ * the files are read into includes, so the pre-asm of base_name does not read them again.
+ *
+ * @param includes
+ * @param base_name
+ * @param visit
+ * @param context passed to visit.
+ * @return int 0 on success, -1 if base_name.as or a file it includes cannot be read, or a file includes itself.
+ */
+int pre_asm_includes_of(pre_asm_includes includes,const char *base_name,void (*visit)(void *context,const char *path),void *context);
+
+/**
+ * @brief tells if the cache can serve another run: every file in it was read without errors and has the same
+ * modification time and size on disk as when it was read. a cache kept between runs is destroyed and created again otherwise.
+ *
+ * @param includes
+ * @return int 1 if it can, 0 otherwise.
+ */
+int pre_asm_includes_unchanged(pre_asm_includes includes);
+
+/**
+ * @brief sets where errors of the files read from now on are printed.
+ *
+ * @param includes
+ * @param diagnostics NULL prints them to stdout.
+ */
+void pre_asm_includes_set_diagnostics(pre_asm_includes includes,FILE *diagnostics);
+
+/**
+ * @brief frees the cache and every file in it.
+ *
+ * @param includes
+ */
+void pre_asm_includes_destroy(pre_asm_includes includes);
 
 
 /**
  * @brief 
  * 
  * @param am_file 
+ * @param names pool the macro names are interned into.
+ * @return const char* the name of the .am file, freed with mem_free. NULL on failure.
+ */
+const char * asm_pre_asm(const char *base_name,str_pool names);
+
+/**
+ * @brief same as asm_pre_asm, every piece of expanded text is also handed to sink, in order, as soon as it is produced.
+ * 
+ * @param base_name 
+ * @param names pool the macro names are interned into.
+ * @param sink may be NULL.
+ * @param context passed to sink.
  * @return const char* 
  */
-const char * asm_pre_asm(const char *base_name);
+const char * asm_pre_asm_to_sink(const char *base_name,str_pool names,void (*sink)(void *context,const char *text),void *context);
+
+/**
+ * @brief same as asm_pre_asm_to_sink, the files base_name includes are taken from includes.
+ * 
+ * @param base_name 
+ * @param names pool the macro names are interned into.
+ * @param includes may be NULL, the included files are then read for this file alone.
+ * @param sink may be NULL.
+ * @param context passed to sink.
+ * @return const char* NULL on failure, also if an included file cannot be read.
+ */
+const char * asm_pre_asm_with_includes(const char *base_name,str_pool names,pre_asm_includes includes,void (*sink)(void *context,const char *text),void *context);
+
+/**
+ * @brief same as asm_pre_asm_with_includes, but the .am file is not written, the expanded text only goes to sink.
+ * 
+ * @param base_name 
+ * @param names pool the macro names are interned into.
+ * @param includes may be NULL, the included files are then read for this file alone.
+ * @param sink 
+ * @param context passed to sink.
+ * @return const char* the name the .am file would have, for diagnostics, freed with mem_free. NULL on failure.
+ */
+const char * asm_pre_asm_to_memory(const char *base_name,str_pool names,pre_asm_includes includes,void (*sink)(void *context,const char *text),void *context);
 
 
 #endif
\ No newline at end of file
@@ -0,0 +1,326 @@
+/* fdopen and open_memstream are POSIX */
+#define _POSIX_C_SOURCE 200809L
+#include "../inc/server.h"
+#include "../../out/inc/out.h"
+#include "../../utilities/trace/inc/trace.h"
+#include "../../utilities/mem/inc/mem.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+/* a payload larger than this is a malformed request */
+#define SERVER_MAX_PAYLOAD (64UL * 1024 * 1024)
+/* the longest header line */
+#define SERVER_MAX_HEADER 64
+/* default amount of sessions served at once */
+#define SERVER_DEFAULT_WORKERS 4
+
+/* the outputs of a job, in the order they are replied. */
+static const char *server_parts[3] = {"ob","ent","ext"};
+
+/* numbers the scratch files of SOURCE jobs, shared by every session. */
+static unsigned long server_scratch_count;
+
+/* The outputs of a job, filled by the assembled callback. */
+struct server_job {
+    char           *contents[3];
+    size_t          sizes[3];
+    int             assembled;
+};
+
+/* The state of a socket server, shared by its workers. */
+struct server_pool {
+    const struct server_options    *options;
+    int                             listen_fd;
+    int                             stopping;
+};
+
+/**
+ * @brief Replies a single part.
+ *
+ * @param out The reply stream
+ * @param name The name of the part
+ * @param contents The payload
+ * @param size The size of the payload
+ */
+static void server_reply_part(FILE *out,const char *name,const char *contents,unsigned long size) {
+    fprintf(out,"%s %lu\n",name,size);
+    fwrite(contents,1,size,out);
+}
+
+/**
+ * @brief Joins a base name and an extension into a new string.
+ *
+ * @param base_name The base name
+ * @param ext The extension, with the dot
+ * @return char* The file name, or NULL on allocation failure
+ */
+static char *server_file_name(const char *base_name,const char *ext) {
+    char *file_name = mem_malloc(mem_tag_server,strlen(base_name) + strlen(ext) + 1);
+    if(file_name)
+        strcat(strcpy(file_name,base_name),ext);
+    return file_name;
+}
+
+/**
+ * @brief The assembled callback of a job, writes the outputs of the translation unit to memory.
+ *
+ * @param context Pointer to the struct server_job
+ * @param base_name The base name of the file
+ * @param t_unit Its translation unit
+ */
+static void server_assembled(void *context,const char *base_name,const struct translation_unit *t_unit) {
+    struct server_job *job = context;
+    FILE *parts[3];
+    int i, error = 0;
+    (void)base_name;
+    for(i=0;i<3;i++) {
+        parts[i] = open_memstream(&job->contents[i],&job->sizes[i]);
+        error |= parts[i] == NULL;
+    }
+    if(!error)
+        error = out_write_translation_unit(t_unit,parts[0],parts[1],parts[2]);
+    for(i=0;i<3;i++) {
+        if(parts[i])
+            error |= fclose(parts[i]) != 0;
+    }
+    job->assembled = !error;
+}
+
+/**
+ * @brief Runs a job on an .as file and replies its outputs and diagnostics.
+ * the outputs are taken from memory, nothing is written next to the file.
+ *
+ * @param base_name The base name of the .as file
+ * @param job The number of the job
+ * @param out The reply stream
+ * @param session The warm state of the worker
+ * @param options The server options
+ */
+static void server_run_job(const char *base_name,unsigned long job,FILE *out,assembler_session session,const struct server_options *options) {
+    struct assembler_options assembler = {0};
+    struct server_job outputs = {0};
+    char *diagnostics_text = NULL;
+    size_t diagnostics_size = 0;
+    char *name = (char *)base_name;
+    FILE *diagnostics = open_memstream(&diagnostics_text,&diagnostics_size);
+    int i, parts = 0;
+    if(options->assembler)
+        assembler = *options->assembler;
+    else
+        assembler.parse_threads = 1;
+    assembler.diagnostics = diagnostics;
+    assembler.in_memory = 1;
+    assembler.assembled = server_assembled;
+    assembler.assembled_context = &outputs;
+    assemble_in_session(session,&name,1,&assembler);
+    if(diagnostics)
+        fclose(diagnostics);
+    /* an .ent or .ext part is replied only if its file would have been written */
+    for(i=0;i<3;i++)
+        parts += outputs.assembled && (i == 0 || outputs.sizes[i] > 0);
+    parts += diagnostics_size > 0;
+    fprintf(out,"RESULT %lu %d %d\n",job,!outputs.assembled,parts);
+    for(i=0;i<3;i++) {
+        if(outputs.assembled && (i == 0 || outputs.sizes[i] > 0))
+            server_reply_part(out,server_parts[i],outputs.contents[i],outputs.sizes[i]);
+    }
+    if(diagnostics_size > 0)
+        server_reply_part(out,"diagnostics",diagnostics_text,diagnostics_size);
+    /* the buffers of a memory stream are allocated by the C library, not through mem */
+    for(i=0;i<3;i++)
+        free(outputs.contents[i]);
+    free(diagnostics_text);
+}
+
+/**
+ * @brief Writes an inline source to a scratch file, runs a job on it and removes the file.
+ *
+ * @param source The .as source
+ * @param size The size of the source
+ * @param job The number of the job
+ * @param out The reply stream
+ * @param session The warm state of the worker
+ * @param options The server options
+ */
+static void server_run_source_job(const char *source,unsigned long size,unsigned long job,FILE *out,assembler_session session,const struct server_options *options) {
+    const char *dir = options->scratch_dir ? options->scratch_dir : "/tmp";
+    char *base_name = mem_malloc(mem_tag_server,strlen(dir) + 64);
+    char *file_name = NULL;
+    FILE *file = NULL;
+    if(base_name) {
+        sprintf(base_name,"%s/asm-server-%ld-%lu",dir,(long)getpid(),__atomic_fetch_add(&server_scratch_count,1,__ATOMIC_RELAXED));
+        file_name = server_file_name(base_name,".as");
+        if(file_name)
+            file = fopen(file_name,"wb");
+    }
+    if(!file || fwrite(source,1,size,file) != size) {
+        if(file)
+            fclose(file);
+        fprintf(out,"RESULT %lu 1 0\n",job);
+    }else {
+        fclose(file);
+        server_run_job(base_name,job,out,session,options);
+    }
+    /* the job writes nothing else, only the source is left to remove */
+    if(file_name)
+        remove(file_name);
+    mem_free(file_name);
+    mem_free(base_name);
+}
+
+/**
+ * @brief Serves a session with the warm state of a worker.
+ *
+ * @param in The request stream
+ * @param out The reply stream
+ * @param session The include cache and translation unit the jobs reuse
+ * @param options The server options
+ * @return int 1 on SHUTDOWN, -1 on a malformed request, 0 otherwise
+ */
+static int server_serve_session(FILE *in,FILE *out,assembler_session session,const struct server_options *options) {
+    char header[SERVER_MAX_HEADER];
+    char command[SERVER_MAX_HEADER];
+    char *payload;
+    unsigned long size, job = 0;
+    int fields, ret = 0;
+    while(fgets(header,sizeof(header),in)) {
+        fields = sscanf(header,"%63s %lu",command,&size);
+        if(fields == 1 && strcmp(command,"QUIT") == 0)
+            break;
+        if(fields == 1 && strcmp(command,"SHUTDOWN") == 0) {
+            ret = 1;
+            break;
+        }
+        if(fields != 2 || (strcmp(command,"PATH") && strcmp(command,"SOURCE")) || size > SERVER_MAX_PAYLOAD) {
+            fprintf(out,"ERROR malformed request\n");
+            ret = -1;
+            break;
+        }
+        payload = mem_malloc(mem_tag_server,size + 1);
+        if(!payload || fread(payload,1,size,in) != size) {
+            mem_free(payload);
+            fprintf(out,"ERROR truncated payload\n");
+            ret = -1;
+            break;
+        }
+        payload[size] = '\0';
+        job++;
+        if(strcmp(command,"PATH") == 0)
+            server_run_job(payload,job,out,session,options);
+        else
+            server_run_source_job(payload,size,job,out,session,options);
+        mem_free(payload);
+        /* the client waits for the reply before it sends the next job */
+        fflush(out);
+    }
+    fflush(out);
+    return ret;
+}
+
+/**
+ * @brief Serves a session.
+ *
+ * @param in The request stream
+ * @param out The reply stream
+ * @param options The server options
+ * @return int 1 on SHUTDOWN, -1 on a malformed request, 0 otherwise
+ */
+int server_serve_stream(FILE *in,FILE *out,const struct server_options *options) {
+    assembler_session session = assembler_session_create();
+    int ret;
+    if(!session) {
+        fprintf(out,"ERROR out of memory\n");
+        fflush(out);
+        return -1;
+    }
+    ret = server_serve_session(in,out,session,options);
+    assembler_session_destroy(session);
+    return ret;
+}
+
+/**
+ * @brief A worker of the socket server, serves a connection at a time until the server stops.
+ * a worker that cannot allocate its session serves nothing, the other workers serve for it.
+ *
+ * @param arg Pointer to the struct server_pool
+ * @return void* NULL
+ */
+static void *server_worker(void *arg) {
+    struct server_pool *pool = arg;
+    /* the include cache and the translation unit stay warm across the connections the worker serves */
+    assembler_session session = assembler_session_create();
+    FILE *in, *out;
+    int fd, out_fd;
+    TRACE_THREAD("server worker");
+    while(session && !__atomic_load_n(&pool->stopping,__ATOMIC_ACQUIRE)) {
+        fd = accept(pool->listen_fd,NULL,NULL);
+        if(fd < 0)
+            continue;
+        out_fd = dup(fd);
+        in  = fdopen(fd,"rb");
+        out = out_fd < 0 ? NULL : fdopen(out_fd,"wb");
+        if(in && out && server_serve_session(in,out,session,pool->options) == 1) {
+            /* wakes the workers blocked in accept */
+            __atomic_store_n(&pool->stopping,1,__ATOMIC_RELEASE);
+            shutdown(pool->listen_fd,SHUT_RDWR);
+        }
+        if(in)
+            fclose(in);
+        else
+            close(fd);
+        if(out)
+            fclose(out);
+        else if(out_fd >= 0)
+            close(out_fd);
+    }
+    if(session)
+        assembler_session_destroy(session);
+    TRACE_RELEASE();
+    return NULL;
+}
+
+/**
+ * @brief Serves a unix socket.
+ *
+ * @param socket_path The path of the socket
+ * @param options The server options
+ * @return int 0 on success, -1 otherwise
+ */
+int server_serve_unix(const char *socket_path,const struct server_options *options) {
+    struct sockaddr_un addr;
+    struct server_pool pool;
+    pthread_t *workers;
+    int worker_count = options->workers > 0 ? options->workers : SERVER_DEFAULT_WORKERS;
+    int i, started = 0;
+    if(strlen(socket_path) >= sizeof(addr.sun_path))
+        return -1;
+    memset(&addr,0,sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path,socket_path);
+    pool.options   = options;
+    pool.stopping  = 0;
+    pool.listen_fd = socket(AF_UNIX,SOCK_STREAM,0);
+    if(pool.listen_fd < 0)
+        return -1;
+    unlink(socket_path);
+    if(bind(pool.listen_fd,(struct sockaddr *)&addr,sizeof(addr)) != 0 || listen(pool.listen_fd,worker_count * 4) != 0) {
+        close(pool.listen_fd);
+        return -1;
+    }
+    workers = mem_calloc(mem_tag_server,worker_count,sizeof(pthread_t));
+    for(i=0;workers && i<worker_count;i++)
+        started += pthread_create(&workers[started],NULL,server_worker,&pool) == 0;
+    /* without a single worker the calling thread serves */
+    if(started == 0)
+        server_worker(&pool);
+    for(i=0;i<started;i++)
+        pthread_join(workers[i],NULL);
+    mem_free(workers);
+    close(pool.listen_fd);
+    unlink(socket_path);
+    return 0;
+}
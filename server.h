@@ -0,0 +1,58 @@
+#ifndef maman14_server_h
+#define maman14_server_h
+
+#include <stdio.h>
+#include "../../assembler/inc/assembler.h"
+
+/*
+ * The server protocol, every request and every reply is a header line, maybe followed by a payload of the given length.
+ *
+ * requests:
+ *   PATH <length>\n<length bytes>     assembles the file with this base name, as assemble() would, but its outputs
+ *                                     are only replied, nothing is written next to it.
+ *   SOURCE <length>\n<length bytes>   assembles the given .as source, nothing is left on disk.
+ *   QUIT\n                            ends the session.
+ *   SHUTDOWN\n                        ends the session and stops the socket server.
+ *
+ * a job is replied with
+ *   RESULT <job> <status> <parts>\n   job counts from 1 in every session, status is 0 if the file assembled without errors and
+ *                                     1 otherwise, and parts is the amount of parts that follow.
+ *   <name> <length>\n<length bytes>   a part, name is ob, ent, ext or diagnostics.
+ * a malformed request is replied with ERROR <message>\n and ends the session.
+ */
+
+/**
+ * @brief options of a server.
+ * @param assembler options every job is assembled with, its diagnostics field is ignored. may be NULL.
+ * @param scratch_dir where the sources of SOURCE jobs are written while they are assembled, NULL for /tmp.
+ * @param workers amount of sessions the socket server serves at once.
+ */
+struct server_options {
+    const struct assembler_options *assembler;
+    const char *scratch_dir;
+    int workers;
+};
+
+/**
+ * @brief serves a single session, until QUIT, SHUTDOWN or the end of in. the include cache and the translation unit
+ * are kept warm across the jobs of the session.
+ * 
+ * @param in requests are read from it.
+ * @param out replies are written to it.
+ * @param options 
+ * @return int 1 if the session ended with SHUTDOWN, -1 if it ended with a malformed request, 0 otherwise.
+ */
+int server_serve_stream(FILE *in,FILE *out,const struct server_options *options);
+
+/**
+ * @brief listens on a unix socket and serves every connection as a session, on a pool of worker threads that live
+ * as long as the server. every worker keeps its include cache and translation unit warm across the sessions it serves.
+ * returns after a session ends with SHUTDOWN.
+ * 
+ * @param socket_path created, and removed when the server stops.
+ * @param options 
+ * @return int 0 on success, -1 if the socket cannot be created.
+ */
+int server_serve_unix(const char *socket_path,const struct server_options *options);
+
+#endif
@@ -0,0 +1,187 @@
+/* clock_gettime is POSIX */
+#define _POSIX_C_SOURCE 199309L
+#include "../inc/sim.h"
+#include "../../assembler/inc/assembler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define REPEATS 5
+#define BENCH_PATH_LEN 512
+/* iterations of the outer loop of the generated program, it is loaded from a .data word so it may take 13 bits. */
+#define BENCH_COUNT 4000
+
+static const char *const bench_status[] = {"stopped","limit","fault"};
+
+/**
+ * @brief returns the seconds of the monotonic clock.
+ */
+static double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief writes a program that runs every instruction, a subroutine, a parameterized jump and an extern call in nested loops.
+ *
+ * @param base_name the file is base_name.as
+ * @param count iterations of the outer loop
+ * @return int 0 on success, -1 if it cannot be written.
+ */
+static int bench_generate(const char *base_name,int count) {
+    char file_name[BENCH_PATH_LEN];
+    FILE *out;
+    sprintf(file_name,"%.*s.as",BENCH_PATH_LEN - 4,base_name);
+    out = fopen(file_name,"w");
+    if(!out)
+        return -1;
+    fprintf(out,"; generated by sim-bench\n"
+                ".entry MAIN\n"
+                ".extern HOOK\n"
+                "MAIN: clr r1\n"
+                " mov COUNT, r2\n"
+                "OUTER: mov #100, r3\n"
+                "INNER: add #3, r1\n"
+                " sub r4, r1\n"
+                " not r5\n"
+                " inc r4\n"
+                " dec r3\n"
+                " cmp #0, r3\n"
+                " bne INNER(r1,#2)\n"
+                " jsr SUB\n"
+                " dec r2\n"
+                " cmp r2, #0\n"
+                " bne OUTER\n"
+                " jsr HOOK\n"
+                " lea STR, r6\n"
+                " prn r1\n"
+                " stop\n"
+                "SUB: mov r1, VAL\n"
+                " clr r7\n"
+                " add VAL, r7\n"
+                " rts\n"
+                "COUNT: .data %d\n"
+                "VAL: .data 0\n"
+                "STR: .string \"done\"\n",count);
+    return fclose(out) ? -1 : 0;
+}
+
+/**
+ * @brief loads an assembled translation unit into the simulator it is called with.
+ */
+static void bench_assembled(void *context,const char *base_name,const struct translation_unit *t_unit) {
+    if(sim_load_translation_unit(context,t_unit))
+        fprintf(stderr,"%s: does not fit in memory\n",base_name);
+}
+
+/**
+ * @brief runs a program repeats times.
+ *
+ * @param sim
+ * @param repeats
+ * @param result receives the outcome of the last run.
+ * @return double the seconds of the fastest run.
+ */
+static double bench_run(simulator sim,int repeats,struct sim_result *result) {
+    double start, seconds, best = 0;
+    int r;
+    for(r=0;r<repeats;r++) {
+        start = bench_now();
+        sim_run(sim,result);
+        seconds = bench_now() - start;
+        if(r == 0 || seconds < best)
+            best = seconds;
+    }
+    return best;
+}
+
+/**
+ * @brief assembles a program, runs it loaded from memory and from its .ob file, and reports the instructions per second.
+ *
+ * @param base_name
+ * @param sim_options
+ * @param repeats
+ * @return int 0 if both loads ran the same way, 1 otherwise.
+ */
+static int bench_program(char *base_name,const struct sim_options *sim_options,int repeats) {
+    struct assembler_options options = {0};
+    struct sim_result from_memory, from_ob;
+    simulator sim = sim_create(sim_options), sim_ob = sim_create(sim_options);
+    double seconds;
+    int r, failed = 0;
+    if(!sim || !sim_ob) {
+        sim_destroy(sim);
+        sim_destroy(sim_ob);
+        return 1;
+    }
+    options.parse_threads     = 1;
+    options.diagnostics       = stderr;
+    options.assembled         = bench_assembled;
+    options.assembled_context = sim;
+    assemble_with_options(&base_name,1,&options);
+    if(sim_load_ob(sim_ob,base_name)) {
+        fprintf(stderr,"%s: cannot load %s.ob\n",base_name,base_name);
+        failed = 1;
+    }else {
+        seconds = bench_run(sim,repeats,&from_memory);
+        sim_run(sim_ob,&from_ob);
+        /* the translation unit and the .ob file are the same image, so they run the same way */
+        failed = from_memory.status != from_ob.status || from_memory.instructions != from_ob.instructions || from_memory.pc != from_ob.pc;
+        for(r=0;r<8;r++)
+            failed |= sim_register(sim,r) != sim_register(sim_ob,r);
+        if(failed)
+            fprintf(stderr,"%s: the translation unit and the .ob file ran differently\n",base_name);
+        printf("%-24s instructions=%-10lu %9.4f s %14.0f instructions/s %s",base_name,from_memory.instructions,seconds,
+               from_memory.instructions / seconds,bench_status[from_memory.status]);
+        if(from_memory.status == sim_status_fault)
+            printf(" at %u: %s",from_memory.pc,from_memory.fault);
+        printf("\n");
+    }
+    sim_destroy(sim);
+    sim_destroy(sim_ob);
+    return failed;
+}
+
+int main(int argc,char **argv) {
+    struct sim_options options = {0};
+    char base_name[BENCH_PATH_LEN];
+    const char *dir = "/tmp";
+    int i, count = BENCH_COUNT, repeats = REPEATS, programs = 0, verbose = 0, failed = 0;
+    for(i=1;i<argc && argv[i][0] == '-';i++) {
+        if(strcmp(argv[i],"-v") == 0) {
+            verbose = 1;
+        }else if(i + 1 < argc && strcmp(argv[i],"-c") == 0) {
+            count = atoi(argv[++i]);
+        }else if(i + 1 < argc && strcmp(argv[i],"-r") == 0) {
+            repeats = atoi(argv[++i]);
+        }else if(i + 1 < argc && strcmp(argv[i],"-m") == 0) {
+            options.max_instructions = strtoul(argv[++i],NULL,10);
+        }else if(i + 1 < argc && strcmp(argv[i],"-d") == 0) {
+            dir = argv[++i];
+        }else {
+            fprintf(stderr,"usage: %s [-c count] [-r repeats] [-m max_instructions] [-d dir] [-v] [base_name]...\n",argv[0]);
+            return 1;
+        }
+    }
+    if(repeats < 1)
+        repeats = 1;
+    /* what the programs print is only shown with -v, it would be printed every repeat */
+    options.out = verbose ? stdout : fopen("/dev/null","w");
+    if(!options.out)
+        options.out = stdout;
+    for(;i<argc;i++,programs++)
+        failed |= bench_program(argv[i],&options,repeats);
+    if(programs == 0) {
+        sprintf(base_name,"%.*s/sim-bench-loop",BENCH_PATH_LEN - 32,dir);
+        if(bench_generate(base_name,count)) {
+            fprintf(stderr,"cannot write %s.as\n",base_name);
+            return 1;
+        }
+        failed |= bench_program(base_name,&options,repeats);
+    }
+    if(options.out != stdout)
+        fclose(options.out);
+    return failed;
+}
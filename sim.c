@@ -0,0 +1,538 @@
+#include "../inc/sim.h"
+#include "../../lang-engine/inc/lang-engine.h"
+#include "../../utilities/mem/inc/mem.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* characters of a word in the object file, without the new line */
+#define SIM_OB_WORD_LEN 14
+/* the addressing mode of a jump with parameters, the assembler encodes it as a plain 2 */
+#define SIM_MODE_JUMP 2
+/* the A,R,E bits of an operand word that refers to an extern */
+#define SIM_ARE_EXTERNAL 1
+/* a 14 bit word, sign extended */
+#define SIM_WORD(value) ((short)((int)(((value) & 0x3fff) ^ 0x2000) - 0x2000))
+/* the 12 bit value of an immediate operand word, sign extended */
+#define SIM_IMMEDIATE(word) ((short)((int)((((word) >> 2) & 0xfff) ^ 0x800) - 0x800))
+
+/* the labels as values extension of gcc and clang dispatches through a table of labels instead of a switch */
+#if defined(__GNUC__) && !defined(__STRICT_ANSI__) && !defined(SIM_SWITCH_DISPATCH)
+#define SIM_THREADED
+#endif
+
+/* the handlers of the decoded instructions, lea is decoded to a mov of the address. */
+enum sim_op {
+    sim_op_mov,
+    sim_op_cmp,
+    sim_op_add,
+    sim_op_sub,
+    sim_op_not,
+    sim_op_clr,
+    sim_op_inc,
+    sim_op_dec,
+    sim_op_red,
+    sim_op_prn,
+    sim_op_jsr,
+    sim_op_jmp,
+    sim_op_bne,
+    sim_op_rts,
+    sim_op_stop,
+    sim_op_next,
+    sim_op_fault,
+    sim_op_count
+};
+
+/* how an instruction uses an operand. */
+enum sim_use {
+    sim_use_read,
+    sim_use_write,
+    sim_use_address,
+    sim_use_target
+};
+
+/**
+ * @brief an instruction decoded from the word at its address.
+ * @param src what the instruction reads, a register, a word of memory or imm[0].
+ * @param dst what the instruction writes, or the address a jump goes to.
+ * @param imm immediate values and addresses of the operands, also what a stub reads and where it writes.
+ * @param size words of the instruction.
+ * @param op enum sim_op
+ * @param fault what is wrong with the instruction when op is sim_op_fault.
+ */
+struct sim_inst {
+    short          *src;
+    short          *dst;
+    short           imm[2];
+    unsigned short  size;
+    unsigned char   op;
+    const char     *fault;
+};
+
+/* The simulator structure. */
+struct simulator {
+    struct sim_options  options;
+    short               memory[SIM_MEMORY_WORDS];   /* What a run reads and writes. */
+    short               image[SIM_MEMORY_WORDS];    /* The memory as it was loaded. */
+    short               registers[8];
+    unsigned int        stack[SIM_STACK_WORDS];
+    struct sim_inst    *code;                       /* One decoded instruction per code word and a fault past the end. */
+    unsigned int        code_words;
+    unsigned int        data_words;
+};
+
+/**
+ * @brief Creates a simulator.
+ *
+ * @param options The options, NULL for the defaults
+ * @return simulator The simulator
+ */
+simulator sim_create(const struct sim_options *options) {
+    simulator sim = mem_calloc(mem_tag_simulator,1,sizeof(struct simulator));
+    if(sim && options)
+        sim->options = *options;
+    return sim;
+}
+
+/**
+ * @brief Clears the image before a program is loaded.
+ *
+ * @param sim The simulator
+ * @param code_words Words of code the program has
+ * @param data_words Words of data the program has
+ * @return int 0 on success, -1 if the program does not fit in memory
+ */
+static int sim_reset(simulator sim,unsigned long code_words,unsigned long data_words) {
+    mem_free(sim->code);
+    sim->code       = NULL;
+    sim->code_words = 0;
+    sim->data_words = 0;
+    memset(sim->image,0,sizeof(sim->image));
+    if(code_words + data_words > SIM_MEMORY_WORDS - SIM_BASE_ADDR)
+        return -1;
+    sim->code_words = code_words;
+    sim->data_words = data_words;
+    return 0;
+}
+
+/**
+ * @brief Binds a reference to an extern through the linker hook, a reference left unbound stays a stub.
+ *
+ * @param sim The simulator
+ * @param name The extern
+ * @param address The address of the operand word that refers to it
+ */
+static void sim_link(simulator sim,const char *name,unsigned int address) {
+    unsigned int target;
+    if(address < SIM_BASE_ADDR || address >= SIM_BASE_ADDR + sim->code_words)
+        return;
+    if(sim->options.resolve && sim->options.resolve(sim->options.context,name,&target) == 0)
+        sim->image[address] = SIM_WORD((target << 2) | 2);
+}
+
+/**
+ * @brief Decodes an operand of an instruction.
+ * a fault is recorded in the instruction and an operand that refers to an unbound extern makes a jump go on to the next instruction.
+ *
+ * @param sim The simulator
+ * @param inst The instruction
+ * @param which 0 for the source operand, 1 for the destination operand
+ * @param mode The addressing mode
+ * @param address The address of the operand word
+ * @param shift Where the register number is in the word
+ * @param use How the instruction uses the operand
+ * @return short* What the operand refers to
+ */
+static short *sim_operand(simulator sim,struct sim_inst *inst,int which,int mode,unsigned int address,int shift,enum sim_use use) {
+    unsigned int word = sim->image[address] & 0x3fff;
+    const char *fault = NULL;
+    inst->imm[which] = 0;
+    switch(mode) {
+    case tag_arg_tag_register:
+        if(use == sim_use_address)
+            fault = "the address of a register";
+        else
+            return &sim->registers[(word >> shift) & 7];
+        break;
+    case tag_arg_tag_constant:
+        if(use == sim_use_read) {
+            inst->imm[which] = SIM_IMMEDIATE(word);
+            return &inst->imm[which];
+        }
+        fault = "an immediate operand where an address is needed";
+        break;
+    case tag_arg_tag_symbol:
+        if((word & 3) == SIM_ARE_EXTERNAL) {
+            if(use == sim_use_target && inst->op != sim_op_fault)
+                inst->op = sim_op_next;
+            return &inst->imm[which];
+        }
+        word >>= 2;
+        if(use == sim_use_address || use == sim_use_target) {
+            inst->imm[which] = word;
+            return &inst->imm[which];
+        }
+        /* the code is decoded once, so it must not change under it */
+        if(use == sim_use_write && word >= SIM_BASE_ADDR && word < SIM_BASE_ADDR + sim->code_words)
+            fault = "a write to the code";
+        else
+            return &sim->memory[word];
+        break;
+    default:
+        fault = "a jump with parameters where it is not allowed";
+        break;
+    }
+    inst->op    = sim_op_fault;
+    inst->fault = fault;
+    return &inst->imm[which];
+}
+
+/**
+ * @brief Decodes the word at a code address as the first word of an instruction, the same layout assembler_encode_line writes.
+ *
+ * @param sim The simulator
+ * @param index The index of the word in the code
+ * @param inst Output for the instruction
+ */
+static void sim_decode(simulator sim,unsigned int index,struct sim_inst *inst) {
+    unsigned int address = SIM_BASE_ADDR + index;
+    unsigned int word = sim->image[address] & 0x3fff;
+    int opcode = (word >> 6) & 0xf, src_mode = (word >> 4) & 3, dst_mode = (word >> 2) & 3;
+    int params[2];
+    static const unsigned char ops[] = {
+        sim_op_mov,sim_op_cmp,sim_op_add,sim_op_sub,sim_op_mov,
+        sim_op_not,sim_op_clr,sim_op_inc,sim_op_dec,sim_op_jmp,sim_op_bne,sim_op_red,sim_op_prn,sim_op_jsr,
+        sim_op_rts,sim_op_stop
+    };
+    memset(inst,0,sizeof(struct sim_inst));
+    inst->op   = ops[opcode];
+    inst->size = 1;
+    if(word & 3) {
+        inst->op    = sim_op_fault;
+        inst->fault = "an operand word executed as an instruction";
+    }else if(is_i_tag_groupA(opcode)) {
+        inst->size = src_mode == tag_arg_tag_register && dst_mode == tag_arg_tag_register ? 2 : 3;
+        if(index + inst->size <= sim->code_words) {
+            inst->src = sim_operand(sim,inst,0,src_mode,address + 1,8,opcode == tag_lea ? sim_use_address : sim_use_read);
+            inst->dst = sim_operand(sim,inst,1,dst_mode,address + inst->size - 1,2,opcode == tag_cmp ? sim_use_read : sim_use_write);
+        }
+    }else if(is_i_tag_groupB(opcode)) {
+        inst->size = 2;
+        if(dst_mode == SIM_MODE_JUMP && (opcode == tag_jmp || opcode == tag_bne || opcode == tag_jsr)) {
+            /* the parameters are checked, the instruction set leaves what they do to the program */
+            params[0]   = (word >> 12) & 3;
+            params[1]   = (word >> 10) & 3;
+            inst->size  = params[0] == tag_arg_tag_register && params[1] == tag_arg_tag_register ? 3 : 4;
+            dst_mode    = tag_arg_tag_symbol;
+            if(params[0] == SIM_MODE_JUMP || params[1] == SIM_MODE_JUMP) {
+                inst->op    = sim_op_fault;
+                inst->fault = "a jump with parameters as a parameter";
+            }
+        }
+        if(index + inst->size <= sim->code_words) {
+            switch(opcode) {
+            case tag_jmp: case tag_bne: case tag_jsr:
+                inst->dst = sim_operand(sim,inst,1,dst_mode,address + 1,2,sim_use_target);
+                break;
+            case tag_prn:
+                inst->dst = sim_operand(sim,inst,1,dst_mode,address + 1,2,sim_use_read);
+                break;
+            default:
+                inst->dst = sim_operand(sim,inst,1,dst_mode,address + 1,2,sim_use_write);
+                break;
+            }
+        }
+    }
+    if(index + inst->size > sim->code_words) {
+        inst->op    = sim_op_fault;
+        inst->fault = "an instruction past the end of the code";
+    }
+}
+
+/**
+ * @brief Decodes every word of the code, and a fault past its end.
+ *
+ * @param sim The simulator
+ * @return int 0 on success, -1 on allocation failure
+ */
+static int sim_decode_code(simulator sim) {
+    unsigned int i;
+    sim->code = mem_malloc(mem_tag_simulator,(sim->code_words + 1) * sizeof(struct sim_inst));
+    if(!sim->code)
+        return -1;
+    /* any word can be jumped to, so every word is decoded as the start of an instruction */
+    for(i=0;i<sim->code_words;i++)
+        sim_decode(sim,i,&sim->code[i]);
+    memset(&sim->code[i],0,sizeof(struct sim_inst));
+    sim->code[i].op    = sim_op_fault;
+    sim->code[i].fault = "ran past the end of the code";
+    return 0;
+}
+
+/**
+ * @brief Reads the next word of an object file.
+ *
+ * @param ob_file The object file
+ * @param word Output for the word
+ * @return int 0 on success, -1 at the end of the file or on a malformed line
+ */
+static int sim_read_ob_word(FILE *ob_file,short *word) {
+    char line[SIM_OB_WORD_LEN + 8];
+    unsigned int value = 0;
+    int i;
+    /* the code and the data are separated by an empty line */
+    do {
+        if(!fgets(line,sizeof(line),ob_file))
+            return -1;
+    } while(line[0] == '\n');
+    for(i=0;i<SIM_OB_WORD_LEN;i++) {
+        if(line[i] != '.' && line[i] != '/')
+            return -1;
+        value = (value << 1) | (line[i] == '/');
+    }
+    *word = SIM_WORD(value);
+    return 0;
+}
+
+/**
+ * @brief Loads an object file and its extern references.
+ *
+ * @param sim The simulator
+ * @param base_name The base name of the files
+ * @return int 0 on success, -1 otherwise
+ */
+int sim_load_ob(simulator sim,const char *base_name) {
+    char *file_name = mem_malloc(mem_tag_simulator,strlen(base_name) + 5);
+    char name[max_symbol_len + 2];
+    FILE *in;
+    unsigned long code_words, data_words, i;
+    unsigned int address;
+    int error = 0;
+    if(!file_name)
+        return -1;
+    in = fopen(strcat(strcpy(file_name,base_name),".ob"),"r");
+    if(!in || fscanf(in,"%lu %lu\n",&code_words,&data_words) != 2 || sim_reset(sim,code_words,data_words)) {
+        error = -1;
+    }else {
+        for(i=0;i<code_words + data_words && !error;i++)
+            error = sim_read_ob_word(in,&sim->image[SIM_BASE_ADDR + i]);
+    }
+    if(in)
+        fclose(in);
+    /* a program without externs has no .ext file */
+    in = error ? NULL : fopen(strcat(strcpy(file_name,base_name),".ext"),"r");
+    if(in) {
+        while(fscanf(in,"%31s %u",name,&address) == 2)
+            sim_link(sim,name,address);
+        fclose(in);
+    }
+    mem_free(file_name);
+    if(!error)
+        error = sim_decode_code(sim);
+    if(error)
+        sim_reset(sim,0,0);
+    return error;
+}
+
+/**
+ * @brief Loads an assembled translation unit.
+ *
+ * @param sim The simulator
+ * @param t_unit The translation unit
+ * @return int 0 on success, -1 otherwise
+ */
+int sim_load_translation_unit(simulator sim,const struct translation_unit *t_unit) {
+    void *const* begin;
+    void *const* end;
+    void *const* begin_addr;
+    void *const* end_addr;
+    const struct extern_call * ec;
+    short *word;
+    if(sim_reset(sim,gda_size(t_unit->bmc_code),gda_size(t_unit->bmc_data)))
+        return -1;
+    word = &sim->image[SIM_BASE_ADDR];
+    gda_for_each(t_unit->bmc_code,begin,end)
+        *word++ = SIM_WORD(*(unsigned short *)*begin);
+    gda_for_each(t_unit->bmc_data,begin,end)
+        *word++ = SIM_WORD(*(unsigned short *)*begin);
+    gda_for_each(t_unit->extern_usage,begin,end) {
+        ec = *begin;
+        gda_for_each(ec->addresses,begin_addr,end_addr)
+            sim_link(sim,ec->symbol_name->string,*(unsigned short *)*begin_addr);
+    }
+    if(sim_decode_code(sim)) {
+        sim_reset(sim,0,0);
+        return -1;
+    }
+    return 0;
+}
+
+#ifdef SIM_THREADED
+#define SIM_HANDLER(op) sim_handler_##op:
+#define SIM_NEXT() do { inst = code + pc; count++; goto *sim_handlers[inst->op]; } while(0)
+#define SIM_DISPATCH_BEGIN() SIM_NEXT();
+#define SIM_DISPATCH_END()
+#else
+#define SIM_HANDLER(op) case sim_op_##op:
+#define SIM_NEXT() goto sim_dispatch
+#define SIM_DISPATCH_BEGIN() sim_dispatch: inst = code + pc; count++; switch(inst->op) {
+#define SIM_DISPATCH_END() }
+#endif
+
+/**
+ * @brief Runs the loaded program.
+ *
+ * @param sim The simulator
+ * @param result Output for the outcome, may be NULL
+ * @return enum sim_status How the run ended
+ */
+enum sim_status sim_run(simulator sim,struct sim_result *result) {
+#ifdef SIM_THREADED
+    static const void *const sim_handlers[sim_op_count] = {
+        &&sim_handler_mov,&&sim_handler_cmp,&&sim_handler_add,&&sim_handler_sub,&&sim_handler_not,&&sim_handler_clr,
+        &&sim_handler_inc,&&sim_handler_dec,&&sim_handler_red,&&sim_handler_prn,&&sim_handler_jsr,&&sim_handler_jmp,
+        &&sim_handler_bne,&&sim_handler_rts,&&sim_handler_stop,&&sim_handler_next,&&sim_handler_fault
+    };
+#endif
+    const struct sim_inst *code = sim->code, *inst = NULL;
+    unsigned int *stack = sim->stack;
+    unsigned int pc = 0, sp = 0, target, code_words = sim->code_words;
+    unsigned long count = 0, limit = sim->options.max_instructions ? sim->options.max_instructions : (unsigned long)-1;
+    FILE *in  = sim->options.in ? sim->options.in : stdin;
+    FILE *out = sim->options.out ? sim->options.out : stdout;
+    enum sim_status status = sim_status_fault;
+    const char *fault = "nothing is loaded";
+    int z = 0, c;
+    if(!code)
+        goto sim_done;
+    memcpy(sim->memory,sim->image,sizeof(sim->memory));
+    memset(sim->registers,0,sizeof(sim->registers));
+    SIM_DISPATCH_BEGIN()
+    SIM_HANDLER(mov)
+        *inst->dst = *inst->src;
+        pc += inst->size;
+        SIM_NEXT();
+    SIM_HANDLER(cmp)
+        z = *inst->src == *inst->dst;
+        pc += inst->size;
+        SIM_NEXT();
+    SIM_HANDLER(add)
+        *inst->dst = SIM_WORD(*inst->dst + *inst->src);
+        pc += inst->size;
+        SIM_NEXT();
+    SIM_HANDLER(sub)
+        *inst->dst = SIM_WORD(*inst->dst - *inst->src);
+        pc += inst->size;
+        SIM_NEXT();
+    SIM_HANDLER(not)
+        *inst->dst = SIM_WORD(~*inst->dst);
+        pc += inst->size;
+        SIM_NEXT();
+    SIM_HANDLER(clr)
+        *inst->dst = 0;
+        pc += inst->size;
+        SIM_NEXT();
+    SIM_HANDLER(inc)
+        *inst->dst = SIM_WORD(*inst->dst + 1);
+        pc += inst->size;
+        SIM_NEXT();
+    SIM_HANDLER(dec)
+        *inst->dst = SIM_WORD(*inst->dst - 1);
+        pc += inst->size;
+        SIM_NEXT();
+    SIM_HANDLER(red)
+        c = getc(in);
+        *inst->dst = c == EOF ? -1 : SIM_WORD(c);
+        pc += inst->size;
+        SIM_NEXT();
+    SIM_HANDLER(prn)
+        fprintf(out,"%d\n",*inst->dst);
+        pc += inst->size;
+        SIM_NEXT();
+    SIM_HANDLER(jsr)
+        if(sp == SIM_STACK_WORDS) {
+            fault = "stack overflow";
+            goto sim_fault;
+        }
+        stack[sp++] = pc + inst->size;
+        goto sim_jump;
+    SIM_HANDLER(jmp)
+    sim_jump:
+        target = (unsigned int)(*inst->dst - SIM_BASE_ADDR);
+        if(target >= code_words) {
+            fault = "a jump outside the code";
+            goto sim_fault;
+        }
+        pc = target;
+        /* a program only loops through jumps, so the limit is checked here */
+        if(count >= limit) {
+            status = sim_status_limit;
+            goto sim_done;
+        }
+        SIM_NEXT();
+    SIM_HANDLER(bne)
+        if(!z)
+            goto sim_jump;
+        pc += inst->size;
+        SIM_NEXT();
+    SIM_HANDLER(rts)
+        if(sp == 0) {
+            fault = "rts with an empty stack";
+            goto sim_fault;
+        }
+        pc = stack[--sp];
+        SIM_NEXT();
+    SIM_HANDLER(next)
+        pc += inst->size;
+        SIM_NEXT();
+    SIM_HANDLER(stop)
+        status = sim_status_stopped;
+        goto sim_done;
+    SIM_HANDLER(fault)
+        fault = inst->fault;
+        goto sim_fault;
+    SIM_DISPATCH_END()
+sim_fault:
+    status = sim_status_fault;
+sim_done:
+    if(result) {
+        result->status       = status;
+        result->instructions = count;
+        result->pc           = SIM_BASE_ADDR + pc;
+        result->fault        = status == sim_status_fault ? fault : NULL;
+    }
+    return status;
+}
+
+/**
+ * @brief Returns a register.
+ *
+ * @param sim The simulator
+ * @param reg The register
+ * @return int The value
+ */
+int sim_register(simulator sim,int reg) {
+    return sim->registers[reg & 7];
+}
+
+/**
+ * @brief Returns a word of memory.
+ *
+ * @param sim The simulator
+ * @param address The address
+ * @return int The value
+ */
+int sim_word(simulator sim,unsigned int address) {
+    return address < SIM_MEMORY_WORDS ? sim->memory[address] : 0;
+}
+
+/**
+ * @brief Frees the simulator.
+ *
+ * @param sim The simulator
+ */
+void sim_destroy(simulator sim) {
+    if(!sim)
+        return;
+    mem_free(sim->code);
+    mem_free(sim);
+}
@@ -0,0 +1,126 @@
+#ifndef maman14_sim_h
+#define maman14_sim_h
+
+#include <stdio.h>
+#include "../../assembler/inc/translation_unit.h"
+
+/* the address the code is loaded at, the same address the assembler counts from. */
+#define SIM_BASE_ADDR 100
+/* words of memory, an operand word holds a 12 bit address. */
+#define SIM_MEMORY_WORDS 4096
+/* return addresses jsr can push before the stack overflows. */
+#define SIM_STACK_WORDS 1024
+
+/* opaque struct */
+struct simulator;
+typedef struct simulator * simulator;
+
+/**
+ * @brief the linker hook, binds a reference to an extern.
+ *
+ * @param context sim_options.context
+ * @param name the extern
+ * @param address output, the address the reference is bound to.
+ * @return int 0 if address was set, non zero leaves the reference a stub.
+ */
+typedef int (*sim_extern_resolver)(void *context,const char *name,unsigned int *address);
+
+/**
+ * @brief options of a simulator.
+ * @param in what red reads from, NULL for stdin.
+ * @param out what prn prints to, NULL for stdout.
+ * @param max_instructions a run stops once it executed about this many instructions, 0 for no limit.
+ * @param resolve called for every reference to an extern when a program is loaded, NULL leaves every reference a stub.
+ * a stub reads as 0, discards what is written to it, and jumping to or calling it goes on to the next instruction.
+ * @param context passed to resolve.
+ */
+struct sim_options {
+    FILE *in;
+    FILE *out;
+    unsigned long max_instructions;
+    sim_extern_resolver resolve;
+    void *context;
+};
+
+enum sim_status {
+    sim_status_stopped,
+    sim_status_limit,
+    sim_status_fault
+};
+
+/**
+ * @brief the outcome of a run.
+ * @param status
+ * @param instructions amount of instructions executed.
+ * @param pc the address of the instruction the run ended at.
+ * @param fault what went wrong, NULL unless status is sim_status_fault.
+ */
+struct sim_result {
+    enum sim_status status;
+    unsigned long instructions;
+    unsigned int pc;
+    const char *fault;
+};
+
+/**
+ * @brief creates a simulator with nothing loaded.
+ *
+ * @param options copied, NULL for the defaults.
+ * @return simulator returns NULL on allocation failure.
+ */
+simulator sim_create(const struct sim_options *options);
+
+/**
+ * @brief loads base_name.ob, and the extern references of base_name.ext if there is one.
+ * the code is loaded at SIM_BASE_ADDR with the data right after it, and every word of the code is decoded once, here.
+ *
+ * @param sim
+ * @param base_name
+ * @return int 0 on success, -1 if the files cannot be read, are malformed or do not fit in memory.
+ */
+int sim_load_ob(simulator sim,const char *base_name);
+
+/**
+ * @brief loads the code, data and extern references of an assembled translation unit, the same image sim_load_ob loads from its outputs.
+ *
+ * @param sim
+ * @param t_unit
+ * @return int 0 on success, -1 if it does not fit in memory.
+ */
+int sim_load_translation_unit(simulator sim,const struct translation_unit *t_unit);
+
+/**
+ * @brief runs the loaded program from its first word, with cleared registers and the memory it was loaded with.
+ *
+ * @param sim
+ * @param result output, may be NULL.
+ * @return enum sim_status
+ */
+enum sim_status sim_run(simulator sim,struct sim_result *result);
+
+/**
+ * @brief returns a register as the last run left it.
+ *
+ * @param sim
+ * @param reg 0 to 7
+ * @return int
+ */
+int sim_register(simulator sim,int reg);
+
+/**
+ * @brief returns a word of memory as the last run left it.
+ *
+ * @param sim
+ * @param address below SIM_MEMORY_WORDS
+ * @return int
+ */
+int sim_word(simulator sim,unsigned int address);
+
+/**
+ * @brief frees the simulator.
+ *
+ * @param sim
+ */
+void sim_destroy(simulator sim);
+
+#endif
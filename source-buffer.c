@@ -0,0 +1,159 @@
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "../inc/source-buffer.h"
+#include "../../mem/inc/mem.h"
+/* The source_buffer structure. */
+struct source_buffer {
+    char   *contents; /* The file contents. */
+    size_t  size;     /* Amount of characters in contents. */
+    int     mapped;   /* Non zero if contents is mapped, zero if it was allocated. */
+};
+
+/**
+ * @brief Reads the whole file into allocated memory.
+ *
+ * @param sb
+ * @param fd Open file descriptor, at its start.
+ * @param size_hint Expected size of the file, may be 0.
+ * @return int 0 on success, -1 otherwise
+ */
+static int source_buffer_read(source_buffer sb, int fd, size_t size_hint) {
+    size_t capacity = size_hint + 1;
+    ssize_t n;
+    char *realloc_ret;
+    sb->contents = mem_malloc(mem_tag_sources,capacity);
+    if(!sb->contents)
+        return -1;
+    /* a single read when the size is known, the loop only runs again for files that grow or have no size */
+    while((n = read(fd,sb->contents + sb->size,capacity - sb->size)) > 0) {
+        sb->size += n;
+        if(sb->size == capacity) {
+            realloc_ret = mem_realloc(mem_tag_sources,sb->contents,capacity * 2);
+            if(!realloc_ret)
+                return -1;
+            sb->contents = realloc_ret;
+            capacity *= 2;
+        }
+    }
+    return n < 0 ? -1 : 0;
+}
+
+/**
+ * @brief Opens a file as a source buffer.
+ *
+ * @param file_name The name of the file
+ * @return source_buffer The buffer
+ */
+source_buffer source_buffer_open(const char *file_name) {
+    struct stat st;
+    size_t size_hint = 0;
+    source_buffer sb;
+    int fd = open(file_name,O_RDONLY);
+    if(fd < 0)
+        return NULL;
+    sb = mem_calloc(mem_tag_sources,1,sizeof(struct source_buffer));
+    if(!sb) {
+        close(fd);
+        return NULL;
+    }
+    if(fstat(fd,&st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        size_hint = st.st_size;
+        sb->contents = mmap(NULL,st.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+        if(sb->contents != MAP_FAILED) {
+            sb->size   = st.st_size;
+            sb->mapped = 1;
+            close(fd);
+            return sb;
+        }
+        sb->contents = NULL;
+    }
+    if(source_buffer_read(sb,fd,size_hint)) {
+        mem_free(sb->contents);
+        mem_free(sb);
+        sb = NULL;
+    }
+    close(fd);
+    return sb;
+}
+
+/**
+ * @brief Makes a buffer of allocated contents.
+ *
+ * @param contents The contents, freed with the buffer
+ * @param size The amount of characters
+ * @return source_buffer The buffer, NULL on allocation failure
+ */
+source_buffer source_buffer_adopt(char *contents,size_t size) {
+    source_buffer sb = mem_calloc(mem_tag_sources,1,sizeof(struct source_buffer));
+    if(!sb) {
+        mem_free(contents);
+        return NULL;
+    }
+    sb->contents = contents;
+    sb->size     = size;
+    return sb;
+}
+
+/**
+ * @brief Returns the first character.
+ *
+ * @param sb
+ * @return const char*
+ */
+const char *source_buffer_begin(source_buffer sb) {
+    return sb->contents;
+}
+
+/**
+ * @brief Returns one past the last character.
+ *
+ * @param sb
+ * @return const char*
+ */
+const char *source_buffer_end(source_buffer sb) {
+    return sb->contents + sb->size;
+}
+
+/**
+ * @brief Copies the next line.
+ *
+ * @param cursor Position in the contents
+ * @param end End of the contents
+ * @param buffer Output buffer
+ * @param buffer_size Size of the output buffer
+ * @return int 1 if a line was copied, 0 at the end
+ */
+int source_buffer_next_line(const char **cursor,const char *end,char *buffer,size_t buffer_size) {
+    const char *line = *cursor;
+    const char *new_line;
+    size_t len;
+    if(line >= end || buffer_size < 2)
+        return 0;
+    len = end - line;
+    if(len > buffer_size - 1)
+        len = buffer_size - 1;
+    new_line = memchr(line,'\n',len);
+    if(new_line)
+        len = new_line - line + 1;
+    memcpy(buffer,line,len);
+    buffer[len] = '\0';
+    *cursor = line + len;
+    return 1;
+}
+
+/**
+ * @brief Closes the buffer.
+ *
+ * @param sb
+ */
+void source_buffer_close(source_buffer sb) {
+    if(sb->mapped)
+        munmap(sb->contents,sb->size);
+    else
+        mem_free(sb->contents);
+    mem_free(sb);
+}
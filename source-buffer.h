@@ -0,0 +1,60 @@
+#ifndef maman14_source_buffer_h
+#define maman14_source_buffer_h
+
+#include <stddef.h>
+/* opaque struct */
+struct source_buffer;
+typedef struct source_buffer * source_buffer;
+
+/**
+ * @brief maps a whole file into memory, falls back to reading it with a single bulk read if it cannot be mapped.
+ *
+ * @param file_name
+ * @return source_buffer returns NULL if the file cannot be opened or read.
+ */
+source_buffer source_buffer_open(const char *file_name);
+
+/**
+ * @brief makes a buffer of text that is already in memory, e.g. text produced without writing it to a file.
+ *
+ * @param contents allocated with mem_malloc, owned by the buffer from now on, also if NULL is returned.
+ * @param size amount of characters in contents.
+ * @return source_buffer returns NULL on allocation failure.
+ */
+source_buffer source_buffer_adopt(char *contents,size_t size);
+
+/**
+ * @brief returns the first character of the file, the contents are read only and not null terminated.
+ *
+ * @param sb
+ * @return const char*
+ */
+const char *source_buffer_begin(source_buffer sb);
+
+/**
+ * @brief returns one past the last character of the file.
+ *
+ * @param sb
+ * @return const char*
+ */
+const char *source_buffer_end(source_buffer sb);
+
+/**
+ * @brief copies the next line of [*cursor,end) into buffer, split the same way fgets(buffer,buffer_size,...) splits it.
+ *
+ * @param cursor advanced past the line.
+ * @param end
+ * @param buffer null terminated on return, at least buffer_size characters.
+ * @param buffer_size
+ * @return int 1 if a line was copied, 0 at the end.
+ */
+int source_buffer_next_line(const char **cursor,const char *end,char *buffer,size_t buffer_size);
+
+/**
+ * @brief unmaps or frees the contents.
+ *
+ * @param sb
+ */
+void source_buffer_close(source_buffer sb);
+
+#endif
@@ -0,0 +1,93 @@
+#include <stdlib.h>
+#include <sched.h>
+#include "../inc/spsc-ring.h"
+#include "../../mem/inc/mem.h"
+/* spins this many times on a full or empty ring before yielding the cpu */
+#define SPSC_RING_SPINS 64
+#define CACHE_LINE 64
+/* The spsc_ring structure, head and tail sit on separate cache lines so the two threads do not share one. */
+struct spsc_ring {
+    void  **items; /* The slots, capacity of them. */
+    size_t  mask; /* capacity - 1. */
+    char    pad0[CACHE_LINE];
+    size_t  head; /* The next slot to pop, written by the consumer only. */
+    char    pad1[CACHE_LINE];
+    size_t  tail; /* The next slot to push, written by the producer only. */
+    char    pad2[CACHE_LINE];
+};
+
+/**
+ * @brief Creates a new ring.
+ *
+ * @param capacity Minimum amount of slots
+ * @return spsc_ring The created ring
+ */
+spsc_ring spsc_ring_create(size_t capacity) {
+    size_t slots = 2;
+    spsc_ring ring = mem_calloc(mem_tag_rings,1,sizeof(struct spsc_ring));
+    if(!ring)
+        return NULL;
+    while(slots < capacity)
+        slots *= 2;
+    ring->items = mem_calloc(mem_tag_rings,slots,sizeof(void *));
+    if(!ring->items) {
+        mem_free(ring);
+        return NULL;
+    }
+    ring->mask = slots - 1;
+    return ring;
+}
+
+/**
+ * @brief Waits a little, spinning first and then yielding.
+ *
+ * @param spins The amount of times the caller already waited.
+ */
+static void spsc_ring_wait(unsigned int *spins) {
+    if(++(*spins) > SPSC_RING_SPINS)
+        sched_yield();
+}
+
+/**
+ * @brief Pushes an item.
+ *
+ * @param ring
+ * @param item Item to push
+ */
+void spsc_ring_push(spsc_ring ring, void *item) {
+    size_t tail = ring->tail;
+    unsigned int spins = 0;
+    while(tail - __atomic_load_n(&ring->head,__ATOMIC_ACQUIRE) > ring->mask)
+        spsc_ring_wait(&spins);
+    ring->items[tail & ring->mask] = item;
+    /* publishes the item to the consumer */
+    __atomic_store_n(&ring->tail,tail + 1,__ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Pops an item.
+ *
+ * @param ring
+ * @return void* The oldest item
+ */
+void *spsc_ring_pop(spsc_ring ring) {
+    size_t head = ring->head;
+    unsigned int spins = 0;
+    void *item;
+    while(__atomic_load_n(&ring->tail,__ATOMIC_ACQUIRE) == head)
+        spsc_ring_wait(&spins);
+    item = ring->items[head & ring->mask];
+    /* hands the slot back to the producer */
+    __atomic_store_n(&ring->head,head + 1,__ATOMIC_RELEASE);
+    return item;
+}
+
+/**
+ * @brief Destroys the ring.
+ *
+ * @param ring
+ */
+void spsc_ring_destroy(spsc_ring ring) {
+    mem_free(ring->items);
+    mem_free(ring);
+}
@@ -0,0 +1,40 @@
+#ifndef maman14_spsc_ring_h
+#define maman14_spsc_ring_h
+
+#include <stddef.h>
+/* opaque struct */
+struct spsc_ring;
+typedef struct spsc_ring * spsc_ring;
+
+/**
+ * @brief creates a bounded lock free ring of pointers, for exactly one producer thread and one consumer thread.
+ *
+ * @param capacity rounded up to a power of two.
+ * @return spsc_ring returns NULL on allocation failure.
+ */
+spsc_ring spsc_ring_create(size_t capacity);
+
+/**
+ * @brief pushes item, waits while the ring is full. only the producer thread may call it.
+ *
+ * @param ring
+ * @param item may be NULL, e.g. to mark the end of the stream.
+ */
+void spsc_ring_push(spsc_ring ring, void *item);
+
+/**
+ * @brief pops the oldest item, waits while the ring is empty. only the consumer thread may call it.
+ *
+ * @param ring
+ * @return void* the item.
+ */
+void *spsc_ring_pop(spsc_ring ring);
+
+/**
+ * @brief destroys the ring, the items left in it are not freed.
+ *
+ * @param ring
+ */
+void spsc_ring_destroy(spsc_ring ring);
+
+#endif
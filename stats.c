@@ -0,0 +1,155 @@
+/* clock_gettime is POSIX */
+#define _POSIX_C_SOURCE 199309L
+#include "../inc/stats.h"
+#include <string.h>
+#include <time.h>
+
+/* names of the counters, in the order of enum stats_counter. */
+static const char *stats_counter_names[stats_counter_count] = {
+    "lines_read",
+    "macro_expansions",
+    "includes_read",
+    "include_hits",
+    "gda_searches",
+    "gda_probes",
+    "gda_compares",
+    "gda_reallocs",
+    "symbols",
+    "words_emitted",
+    "words_saved",
+    "bytes_written"
+};
+
+/* names of the phases, in the order of enum stats_phase. */
+static const char *stats_phase_names[stats_phase_count] = {
+    "pre_asm",
+    "first_pass",
+    "optimize",
+    "second_pass",
+    "output"
+};
+
+#ifdef ASM_STATS
+__thread unsigned long stats_local[stats_counter_count];
+#endif
+
+/* the flushed counters of every thread. */
+static unsigned long stats_totals[stats_counter_count];
+
+/**
+ * @brief Flushes the calling thread.
+ */
+void stats_flush(void) {
+#ifdef ASM_STATS
+    int i;
+    for(i=0;i<stats_counter_count;i++) {
+        if(stats_local[i]) {
+            __atomic_fetch_add(&stats_totals[i],stats_local[i],__ATOMIC_RELAXED);
+            stats_local[i] = 0;
+        }
+    }
+#endif
+}
+
+/**
+ * @brief Takes a snapshot of the totals.
+ *
+ * @param snapshot Output for the snapshot
+ */
+void stats_snapshot(struct stats *snapshot) {
+    int i;
+    stats_flush();
+    memset(snapshot,0,sizeof(struct stats));
+    for(i=0;i<stats_counter_count;i++)
+        snapshot->counters[i] = __atomic_load_n(&stats_totals[i],__ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Sets the counters to what was counted since a snapshot.
+ *
+ * @param stats Output for the counters
+ * @param snapshot The snapshot
+ */
+void stats_since(struct stats *stats,const struct stats *snapshot) {
+    int i;
+    stats_flush();
+    for(i=0;i<stats_counter_count;i++)
+        stats->counters[i] = __atomic_load_n(&stats_totals[i],__ATOMIC_RELAXED) - snapshot->counters[i];
+}
+
+/**
+ * @brief Adds stats to a total.
+ *
+ * @param total The total
+ * @param stats The stats to add
+ */
+void stats_add(struct stats *total,const struct stats *stats) {
+    int i;
+    for(i=0;i<stats_counter_count;i++)
+        total->counters[i] += stats->counters[i];
+    for(i=0;i<stats_phase_count;i++)
+        total->seconds[i] += stats->seconds[i];
+}
+
+/**
+ * @brief Returns the monotonic clock.
+ *
+ * @return double Seconds
+ */
+double stats_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Prints a string as a JSON string.
+ *
+ * @param out The stream
+ * @param string The string
+ */
+static void stats_print_json_string(FILE *out,const char *string) {
+    fputc('"',out);
+    for(;*string;string++) {
+        if(*string == '"' || *string == '\\')
+            fprintf(out,"\\%c",*string);
+        else if((unsigned char)*string < 0x20)
+            fprintf(out,"\\u%04x",(unsigned char)*string);
+        else
+            fputc(*string,out);
+    }
+    fputc('"',out);
+}
+
+/**
+ * @brief Prints stats.
+ *
+ * @param out The stream
+ * @param name The file, NULL for the batch
+ * @param stats The stats
+ * @param json Non zero for JSON
+ */
+void stats_print(FILE *out,const char *name,const struct stats *stats,int json) {
+    int i;
+    if(json) {
+        if(name) {
+            fprintf(out,"{\"file\":");
+            stats_print_json_string(out,name);
+            fprintf(out,",\"phases\":{");
+        }else {
+            fprintf(out,"{\"batch\":true,\"phases\":{");
+        }
+        for(i=0;i<stats_phase_count;i++)
+            fprintf(out,"%s\"%s\":%.9f",i ? "," : "",stats_phase_names[i],stats->seconds[i]);
+        fprintf(out,"},\"counters\":{");
+        for(i=0;i<stats_counter_count;i++)
+            fprintf(out,"%s\"%s\":%lu",i ? "," : "",stats_counter_names[i],stats->counters[i]);
+        fprintf(out,"}}\n");
+        return;
+    }
+    fprintf(out,"%s:\n",name ? name : "batch");
+    for(i=0;i<stats_phase_count;i++)
+        fprintf(out,"  %-18s %12.3f ms\n",stats_phase_names[i],stats->seconds[i] * 1e3);
+    for(i=0;i<stats_counter_count;i++)
+        fprintf(out,"  %-18s %12lu\n",stats_counter_names[i],stats->counters[i]);
+}
@@ -0,0 +1,109 @@
+#ifndef maman14_stats_h
+#define maman14_stats_h
+
+#include <stdio.h>
+
+/*
+ * Phase timings and counters, built only when ASM_STATS is defined. without it every STATS_ macro expands to nothing
+ * or to the bare call, so the instrumentation costs nothing.
+ * counters are added on the thread that counts them without any synchronization, and moved to process wide totals
+ * by stats_flush, which every thread that counts calls before it ends.
+ */
+
+/* the counters. */
+enum stats_counter {
+    stats_lines_read,
+    stats_macro_expansions,
+    stats_includes_read,
+    stats_include_hits,
+    stats_gda_searches,
+    stats_gda_probes,
+    stats_gda_compares,
+    stats_gda_reallocs,
+    stats_symbols,
+    stats_words_emitted,
+    stats_words_saved,
+    stats_bytes_written,
+    stats_counter_count
+};
+
+/* the timed phases. */
+enum stats_phase {
+    stats_phase_pre_asm,
+    stats_phase_first_pass,
+    stats_phase_optimize,
+    stats_phase_second_pass,
+    stats_phase_output,
+    stats_phase_count
+};
+
+/**
+ * @brief the counters and phase timings of a file, or of a batch.
+ * @param counters indexed by enum stats_counter.
+ * @param seconds indexed by enum stats_phase, monotonic wall clock time.
+ */
+struct stats {
+    unsigned long   counters[stats_counter_count];
+    double          seconds[stats_phase_count];
+};
+
+#ifdef ASM_STATS
+/* the counters of the calling thread that were not flushed yet. */
+extern __thread unsigned long stats_local[stats_counter_count];
+#define STATS_ADD(counter,n) (stats_local[counter] += (n))
+#define STATS_FLUSH() stats_flush()
+/* runs call, and adds the time it took to the phase of stats. */
+#define STATS_PHASE(stats,phase,call) do { double stats_start_ = stats_now(); call; (stats)->seconds[phase] += stats_now() - stats_start_; } while(0)
+#else
+#define STATS_ADD(counter,n) ((void)0)
+#define STATS_FLUSH() ((void)0)
+#define STATS_PHASE(stats,phase,call) do { call; } while(0)
+#endif
+
+/**
+ * @brief moves the counters of the calling thread to the process wide totals.
+ */
+void stats_flush(void);
+
+/**
+ * @brief flushes the calling thread, and copies the process wide totals into snapshot.
+ * 
+ * @param snapshot its timings are zeroed.
+ */
+void stats_snapshot(struct stats *snapshot);
+
+/**
+ * @brief flushes the calling thread, and sets the counters of stats to what was counted since snapshot.
+ * counts of files assembled concurrently, e.g. by the server, are mixed.
+ * 
+ * @param stats its timings are kept.
+ * @param snapshot 
+ */
+void stats_since(struct stats *stats,const struct stats *snapshot);
+
+/**
+ * @brief adds the counters and timings of stats to total.
+ * 
+ * @param total 
+ * @param stats 
+ */
+void stats_add(struct stats *total,const struct stats *stats);
+
+/**
+ * @brief returns the monotonic clock, in seconds.
+ * 
+ * @return double 
+ */
+double stats_now(void);
+
+/**
+ * @brief prints stats as text, or as a single line of JSON.
+ * 
+ * @param out 
+ * @param name the file the stats belong to, NULL for the batch.
+ * @param stats 
+ * @param json non zero prints JSON.
+ */
+void stats_print(FILE *out,const char *name,const struct stats *stats,int json);
+
+#endif
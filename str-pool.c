@@ -0,0 +1,209 @@
+#include <stdlib.h>
+#include "../inc/str-pool.h"
+#include "../../mem/inc/mem.h"
+#include <string.h>
+/* The str_pool structure, an open addressing hash set of interned strings. */
+struct str_pool {
+    struct str_pool_entry **slots; /* Hash slots, NULL when empty. */
+    size_t slots_count; /* The total number of slots, always a power of two. */
+    size_t elem_count; /* The count of interned strings. */
+};
+
+/**
+ * @brief FNV-1a hash of a null terminated string.
+ *
+ * @param string
+ * @param len Output for the length of the string.
+ * @return unsigned long
+ */
+static unsigned long str_pool_hash(const char *string, size_t *len) {
+    unsigned long hash = 2166136261UL;
+    const char *runner;
+    for(runner = string; *runner; runner++) {
+        hash ^= (unsigned char)*runner;
+        hash *= 16777619UL;
+        hash &= 0xffffffffUL;
+    }
+    *len = runner - string;
+    return hash;
+}
+
+/**
+ * @brief FNV-1a hash of the first len characters of a string.
+ *
+ * @param string
+ * @param len
+ * @return unsigned long
+ */
+static unsigned long str_pool_hash_n(const char *string, size_t len) {
+    unsigned long hash = 2166136261UL;
+    size_t i;
+    for(i = 0; i < len; i++) {
+        hash ^= (unsigned char)string[i];
+        hash *= 16777619UL;
+        hash &= 0xffffffffUL;
+    }
+    return hash;
+}
+
+/**
+ * @brief Finds the slot that holds string, or the empty slot it should be placed in.
+ *
+ * @param pool
+ * @param string
+ * @param len
+ * @param hash
+ * @return struct str_pool_entry** the slot
+ */
+static struct str_pool_entry **str_pool_probe(str_pool pool, const char *string, size_t len, unsigned long hash) {
+    size_t i = hash & (pool->slots_count - 1);
+    struct str_pool_entry **slot;
+    while(1) {
+        slot = &pool->slots[i];
+        if(*slot == NULL)
+            return slot;
+        if((*slot)->hash == hash && (*slot)->len == len && memcmp((*slot)->string, string, len) == 0)
+            return slot;
+        i = (i + 1) & (pool->slots_count - 1);
+    }
+}
+
+/**
+ * @brief Doubles the slot array and rehashes every entry.
+ *
+ * @param pool
+ * @return int 0 if successful, -1 otherwise
+ */
+static int str_pool_grow(str_pool pool) {
+    struct str_pool_entry **old_slots = pool->slots;
+    size_t old_count = pool->slots_count;
+    size_t i, j;
+    pool->slots = mem_calloc(mem_tag_names,old_count * 2, sizeof(struct str_pool_entry *));
+    if(!pool->slots) {
+        pool->slots = old_slots;
+        return -1;
+    }
+    pool->slots_count = old_count * 2;
+    for(i = 0; i < old_count; i++) {
+        if(old_slots[i]) {
+            j = old_slots[i]->hash & (pool->slots_count - 1);
+            while(pool->slots[j])
+                j = (j + 1) & (pool->slots_count - 1);
+            pool->slots[j] = old_slots[i];
+        }
+    }
+    mem_free(old_slots);
+    return 0;
+}
+
+/**
+ * @brief Creates a new string pool.
+ *
+ * @return str_pool The created pool
+ */
+str_pool str_pool_create(void) {
+    str_pool pool = mem_calloc(mem_tag_names,1, sizeof(struct str_pool));
+    if(!pool)
+        return NULL;
+    pool->slots_count = 64;
+    pool->slots = mem_calloc(mem_tag_names,pool->slots_count, sizeof(struct str_pool_entry *));
+    if(!pool->slots) {
+        mem_free(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+/**
+ * @brief Interns a string.
+ *
+ * @param pool
+ * @param string String to intern
+ * @return str_handle Handle of the interned string or NULL if allocation failed
+ */
+str_handle str_pool_intern(str_pool pool, const char *string) {
+    return str_pool_intern_n(pool, string, strlen(string));
+}
+
+/**
+ * @brief Interns the first len characters of a string.
+ *
+ * @param pool
+ * @param string Text to intern, does not have to be null terminated
+ * @param len Length of the text
+ * @return str_handle Handle of the interned string or NULL if allocation failed
+ */
+str_handle str_pool_intern_n(str_pool pool, const char *string, size_t len) {
+    unsigned long hash = str_pool_hash_n(string, len);
+    struct str_pool_entry **slot = str_pool_probe(pool, string, len, hash);
+    struct str_pool_entry *entry;
+    char *text;
+    if(*slot)
+        return *slot;
+    /* the text is stored right after the entry, one allocation per distinct string */
+    entry = mem_malloc(mem_tag_names,sizeof(struct str_pool_entry) + len + 1);
+    if(!entry)
+        return NULL;
+    text = memcpy((char *)(entry + 1), string, len);
+    text[len] = '\0';
+    entry->string = text;
+    entry->len = len;
+    entry->hash = hash;
+    entry->id = pool->elem_count;
+    *slot = entry;
+    pool->elem_count++;
+    if(pool->elem_count * 2 > pool->slots_count)
+        str_pool_grow(pool);
+    return entry;
+}
+
+/**
+ * @brief Finds an interned string.
+ *
+ * @param pool
+ * @param string String to search for
+ * @return str_handle Handle of the string or NULL if it was never interned
+ */
+str_handle str_pool_find(str_pool pool, const char *string) {
+    size_t len;
+    unsigned long hash = str_pool_hash(string, &len);
+    return *str_pool_probe(pool, string, len, hash);
+}
+
+/**
+ * @brief Returns the number of distinct strings in the pool.
+ *
+ * @param pool
+ * @return size_t Size of the pool
+ */
+size_t str_pool_size(str_pool pool) {
+    return pool->elem_count;
+}
+
+/**
+ * @brief Removes every string, the slots keep their capacity.
+ *
+ * @param pool
+ */
+void str_pool_clear(str_pool pool) {
+    size_t i;
+    for(i = 0; i < pool->slots_count; i++) {
+        mem_free(pool->slots[i]);
+        pool->slots[i] = NULL;
+    }
+    pool->elem_count = 0;
+}
+
+/**
+ * @brief Destroys the pool.
+ *
+ * @param pool
+ */
+void str_pool_destroy(str_pool pool) {
+    size_t i;
+    for(i = 0; i < pool->slots_count; i++) {
+        mem_free(pool->slots[i]);
+    }
+    mem_free(pool->slots);
+    mem_free(pool);
+}
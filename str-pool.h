@@ -0,0 +1,76 @@
+#ifndef maman14_str_pool_h
+#define maman14_str_pool_h
+
+#include <stddef.h>
+/* opaque struct */
+struct str_pool;
+typedef struct str_pool * str_pool;
+
+/* A single interned string, owned by the pool and stable until the pool is destroyed. */
+struct str_pool_entry {
+    const char     *string; /* The interned text. */
+    size_t          len;    /* Length of the text, without the terminating null. */
+    unsigned long   hash;   /* Precomputed hash of the text. */
+    unsigned int    id;     /* Dense id, in order of interning. */
+};
+/* two handles from the same pool are equal if and only if the pointers are equal. */
+typedef const struct str_pool_entry * str_handle;
+
+/**
+ * @brief Creates an empty string pool.
+ *
+ * @return str_pool returns NULL on allocation failure.
+ */
+str_pool str_pool_create(void);
+
+/**
+ * @brief returns the handle of string, copying it into the pool if it was not interned before.
+ *
+ * @param pool
+ * @param string
+ * @return str_handle returns NULL on allocation failure.
+ */
+str_handle str_pool_intern(str_pool pool, const char *string);
+
+/**
+ * @brief returns the handle of the first len characters of string, copying them into the pool if they were not interned before.
+ *
+ * @param pool
+ * @param string does not have to be null terminated.
+ * @param len
+ * @return str_handle returns NULL on allocation failure.
+ */
+str_handle str_pool_intern_n(str_pool pool, const char *string, size_t len);
+
+/**
+ * @brief returns the handle of string without interning it.
+ *
+ * @param pool
+ * @param string
+ * @return str_handle if not exists returns NULL.
+ */
+str_handle str_pool_find(str_pool pool, const char *string);
+
+/**
+ * @brief
+ *
+ * @param pool
+ * @return size_t returns number of distinct strings inside the pool.
+ */
+size_t str_pool_size(str_pool pool);
+
+/**
+ * @brief removes every string from the pool, all handles become invalid. ids count from 0 again.
+ *
+ * @param pool
+ */
+void str_pool_clear(str_pool pool);
+
+/**
+ * @brief destroys the pool and every string in it, all handles become invalid.
+ *
+ * @param pool
+ */
+void str_pool_destroy(str_pool pool);
+
+#endif
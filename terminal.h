@@ -0,0 +1,9 @@
+#ifndef maman14_terminal_h
+#define maman14_terminal_h
+
+/* escape sequences that color the errors and warnings printed to a terminal. */
+#define TERMINAL_RED     "\x1b[31m"
+#define TERMINAL_YELLOW  "\x1b[33m"
+#define TERMINAL_RESET   "\x1b[0m"
+
+#endif
@@ -0,0 +1,262 @@
+/* clock_gettime is POSIX */
+#define _POSIX_C_SOURCE 199309L
+#include "../inc/trace.h"
+#include "../../mem/inc/mem.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef ASM_TRACE
+#include <pthread.h>
+
+/* spans kept per thread, older ones are overwritten. */
+#define TRACE_RING_SIZE 8192
+/* deepest nesting of spans on one thread, deeper spans are not recorded. */
+#define TRACE_DEPTH 32
+
+/* A recorded span. */
+struct trace_event {
+    const char     *name;
+    char            detail[TRACE_DETAIL_LEN];
+    unsigned long   start;      /* Nanoseconds since the trace started. */
+    unsigned long   duration;   /* Nanoseconds. */
+};
+
+/* The ring buffer of a thread, it keeps its track when a later thread reuses it. */
+struct trace_buffer {
+    struct trace_event      events[TRACE_RING_SIZE];
+    unsigned long           count;          /* Spans recorded so far, the last TRACE_RING_SIZE of them are kept. */
+    unsigned int            tid;            /* The track. */
+    const char             *thread_name;
+    struct trace_buffer    *next;           /* The next buffer of the trace. */
+    struct trace_buffer    *next_free;      /* The next released buffer. */
+};
+
+/* A span that did not end yet. */
+struct trace_open_span {
+    const char     *name;
+    const char     *detail;
+    unsigned long   start;
+};
+
+static pthread_mutex_t trace_lock = PTHREAD_MUTEX_INITIALIZER;
+static FILE *trace_file;
+static int trace_on;
+static int trace_at_exit;
+static struct timespec trace_epoch;
+static unsigned int trace_tids;
+static struct trace_buffer *trace_buffers;
+static struct trace_buffer *trace_free;
+
+static __thread struct trace_buffer *trace_local;
+static __thread struct trace_open_span trace_stack[TRACE_DEPTH];
+static __thread int trace_depth;
+
+/**
+ * @brief Returns the time since the trace started.
+ *
+ * @return unsigned long Nanoseconds
+ */
+static unsigned long trace_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return (unsigned long)(ts.tv_sec - trace_epoch.tv_sec) * 1000000000UL + ts.tv_nsec - trace_epoch.tv_nsec;
+}
+
+/**
+ * @brief Returns the buffer of the calling thread, a released one if there is.
+ *
+ * @return struct trace_buffer* NULL on allocation failure
+ */
+static struct trace_buffer *trace_acquire(void) {
+    struct trace_buffer *buffer;
+    pthread_mutex_lock(&trace_lock);
+    buffer = trace_free;
+    if(buffer) {
+        trace_free = buffer->next_free;
+    }else if((buffer = mem_calloc(mem_tag_trace,1,sizeof(struct trace_buffer)))) {
+        buffer->tid = ++trace_tids;
+        buffer->next = trace_buffers;
+        trace_buffers = buffer;
+    }
+    pthread_mutex_unlock(&trace_lock);
+    return buffer;
+}
+
+/**
+ * @brief Prints a string as a JSON string.
+ *
+ * @param out The stream
+ * @param string The string
+ */
+static void trace_print_json_string(FILE *out,const char *string) {
+    fputc('"',out);
+    for(;*string;string++) {
+        if(*string == '"' || *string == '\\')
+            fprintf(out,"\\%c",*string);
+        else if((unsigned char)*string < 0x20)
+            fprintf(out,"\\u%04x",(unsigned char)*string);
+        else
+            fputc(*string,out);
+    }
+    fputc('"',out);
+}
+#endif
+
+/**
+ * @brief Starts tracing.
+ *
+ * @param file_name The trace file
+ * @return int 0 on success
+ */
+int trace_start(const char *file_name) {
+#ifdef ASM_TRACE
+    int ret = 0;
+    pthread_mutex_lock(&trace_lock);
+    if(!trace_file) {
+        trace_file = fopen(file_name,"w");
+        if(!trace_file) {
+            ret = -1;
+        }else {
+            clock_gettime(CLOCK_MONOTONIC,&trace_epoch);
+            if(!trace_at_exit)
+                trace_at_exit = atexit(trace_stop) == 0;
+            __atomic_store_n(&trace_on,1,__ATOMIC_RELEASE);
+        }
+    }
+    pthread_mutex_unlock(&trace_lock);
+    return ret;
+#else
+    (void)file_name;
+    return -1;
+#endif
+}
+
+/**
+ * @brief Writes the spans and stops tracing.
+ */
+void trace_stop(void) {
+#ifdef ASM_TRACE
+    struct trace_buffer *buffer;
+    const struct trace_event *event;
+    unsigned long i, dropped = 0;
+    int first = 1;
+    pthread_mutex_lock(&trace_lock);
+    if(trace_file) {
+        __atomic_store_n(&trace_on,0,__ATOMIC_RELEASE);
+        fprintf(trace_file,"{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+        while((buffer = trace_buffers)) {
+            if(buffer->thread_name) {
+                fprintf(trace_file,"%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":",first ? "" : ",",buffer->tid);
+                trace_print_json_string(trace_file,buffer->thread_name);
+                fprintf(trace_file,"}}");
+                first = 0;
+            }
+            /* the oldest kept span first */
+            i = buffer->count > TRACE_RING_SIZE ? buffer->count - TRACE_RING_SIZE : 0;
+            dropped += i;
+            for(;i<buffer->count;i++) {
+                event = &buffer->events[i % TRACE_RING_SIZE];
+                fprintf(trace_file,"%s\n{\"name\":",first ? "" : ",");
+                trace_print_json_string(trace_file,event->name);
+                fprintf(trace_file,",\"cat\":\"asm\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%lu.%03lu,\"dur\":%lu.%03lu",
+                        buffer->tid,event->start / 1000,event->start % 1000,event->duration / 1000,event->duration % 1000);
+                if(event->detail[0]) {
+                    fprintf(trace_file,",\"args\":{\"detail\":");
+                    trace_print_json_string(trace_file,event->detail);
+                    fprintf(trace_file,"}");
+                }
+                fprintf(trace_file,"}");
+                first = 0;
+            }
+            trace_buffers = buffer->next;
+            mem_free(buffer);
+        }
+        fprintf(trace_file,"\n],\"otherData\":{\"dropped\":%lu}}\n",dropped);
+        fclose(trace_file);
+        trace_file = NULL;
+        trace_free = NULL;
+        trace_tids = 0;
+    }
+    trace_local = NULL;
+    trace_depth = 0;
+    pthread_mutex_unlock(&trace_lock);
+#endif
+}
+
+/**
+ * @brief Begins a span.
+ *
+ * @param name The name
+ * @param detail The detail, may be NULL
+ */
+void trace_begin(const char *name,const char *detail) {
+#ifdef ASM_TRACE
+    if(!__atomic_load_n(&trace_on,__ATOMIC_ACQUIRE))
+        return;
+    if(trace_depth < TRACE_DEPTH) {
+        trace_stack[trace_depth].name   = name;
+        trace_stack[trace_depth].detail = detail;
+        trace_stack[trace_depth].start  = trace_now();
+    }
+    trace_depth++;
+#else
+    (void)name;
+    (void)detail;
+#endif
+}
+
+/**
+ * @brief Ends the innermost span.
+ */
+void trace_end(void) {
+#ifdef ASM_TRACE
+    const struct trace_open_span *span;
+    struct trace_event *event;
+    if(trace_depth == 0 || --trace_depth >= TRACE_DEPTH)
+        return;
+    if(!trace_local && !(trace_local = trace_acquire()))
+        return;
+    span  = &trace_stack[trace_depth];
+    event = &trace_local->events[trace_local->count++ % TRACE_RING_SIZE];
+    event->name     = span->name;
+    event->start    = span->start;
+    event->duration = trace_now() - span->start;
+    event->detail[0] = '\0';
+    if(span->detail)
+        strncat(event->detail,span->detail,TRACE_DETAIL_LEN - 1);
+#endif
+}
+
+/**
+ * @brief Names the track of the calling thread.
+ *
+ * @param name The name
+ */
+void trace_thread(const char *name) {
+#ifdef ASM_TRACE
+    if(!__atomic_load_n(&trace_on,__ATOMIC_ACQUIRE))
+        return;
+    if(!trace_local && !(trace_local = trace_acquire()))
+        return;
+    trace_local->thread_name = name;
+#else
+    (void)name;
+#endif
+}
+
+/**
+ * @brief Hands the buffer of the calling thread back.
+ */
+void trace_release(void) {
+#ifdef ASM_TRACE
+    if(!trace_local)
+        return;
+    pthread_mutex_lock(&trace_lock);
+    trace_local->next_free = trace_free;
+    trace_free = trace_local;
+    pthread_mutex_unlock(&trace_lock);
+    trace_local = NULL;
+    trace_depth = 0;
+#endif
+}
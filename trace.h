@@ -0,0 +1,69 @@
+#ifndef maman14_trace_h
+#define maman14_trace_h
+
+/*
+ * Spans in the Chrome trace event format, loadable in Perfetto or chrome://tracing, built only when ASM_TRACE is
+ * defined. without it every TRACE_ macro expands to nothing.
+ * every thread records its spans into its own ring buffer without any synchronization, the oldest spans are
+ * overwritten when it is full. the buffers are written out by trace_stop, which trace_start arranges to run at exit.
+ */
+
+/* the longest detail kept with a span, longer details are cut. */
+#define TRACE_DETAIL_LEN 48
+
+#ifdef ASM_TRACE
+/* begins a span on the calling thread, name must be a string literal. detail may be NULL. */
+#define TRACE_BEGIN(name,detail) trace_begin(name,detail)
+/* ends the innermost span of the calling thread. */
+#define TRACE_END() trace_end()
+/* names the track of the calling thread, name must be a string literal. */
+#define TRACE_THREAD(name) trace_thread(name)
+/* hands the ring buffer of the calling thread back, every thread that traces calls it before it ends. */
+#define TRACE_RELEASE() trace_release()
+#else
+#define TRACE_BEGIN(name,detail) ((void)0)
+#define TRACE_END() ((void)0)
+#define TRACE_THREAD(name) ((void)0)
+#define TRACE_RELEASE() ((void)0)
+#endif
+
+/**
+ * @brief starts tracing into file_name, and arranges trace_stop to run at exit. does nothing if tracing already started.
+ *
+ * @param file_name
+ * @return int 0 on success, -1 if the file cannot be created or the build has no ASM_TRACE.
+ */
+int trace_start(const char *file_name);
+
+/**
+ * @brief writes every recorded span to the trace file and stops tracing. every thread that traced must have ended
+ * or must not trace anymore.
+ */
+void trace_stop(void);
+
+/**
+ * @brief begins a span.
+ *
+ * @param name
+ * @param detail copied when the span ends, may be NULL.
+ */
+void trace_begin(const char *name,const char *detail);
+
+/**
+ * @brief ends the innermost span.
+ */
+void trace_end(void);
+
+/**
+ * @brief names the track of the calling thread.
+ *
+ * @param name
+ */
+void trace_thread(const char *name);
+
+/**
+ * @brief hands the ring buffer of the calling thread back to be reused by the next thread, its spans are kept.
+ */
+void trace_release(void);
+
+#endif
@@ -1,11 +1,14 @@
 #ifndef TU_H
 #define TU_H
 #include "../../utilities/generic-dynamic-array/inc/gda.h"
+#include "../../utilities/string-pool/inc/str-pool.h"
+#include "../../utilities/stats/inc/stats.h"
+#include <stdio.h>
 
 
 
 struct symbol {
-    char            symbol_name[32 + 1];
+    str_handle      symbol_name;
     unsigned int    addr;
     enum {
         sym_type_data,
@@ -13,9 +16,12 @@ struct symbol {
         sym_type_extern,
         sym_type_entry,
         sym_type_code_entry,
-        sym_type_data_entry
+        sym_type_data_entry,
+        sym_type_unresolved
     }sym_type;
     int line_def;
+    unsigned int id;
+    struct extern_call * usage;
 };
 
 /**
@@ -24,22 +30,34 @@ struct symbol {
  * @param addresses array of unsigned shorts representing addresses that calls this symbol.
  */
 struct extern_call {
-    char symbol_name[32 + 1];
+    str_handle symbol_name;
     gda  addresses;
 };
 
 /**
  * @brief contains a translation of the as file.
+ * @param names the interned symbol and macro names of this file, every name is stored once.
  * @param symbol_table an array of struct symbol.
+ * @param symbol_ids array of struct symbol pointers indexed by symbol id, symbols are never deleted so the id is the insertion order.
+ * @param symbol_refs array of unsigned ints, the id of every symbol operand in order of appearance.
+ * @param symbol_fixups array of unsigned ints, the bmc_code index of every symbol operand, parallel to symbol_refs.
  * @param bmc_code array of unsigned shorts for code section in memory.
  * @param bmc_data array of unsigned shorts for data section in memory.
  * @param extern_usage array of struct extern_call.
+ * @param diagnostics where the errors and warnings of the file are printed.
+ * @param stats phase timings and counters of the file, collected only with ASM_STATS. the member is there in every build so the layout does not depend on it.
  */
 struct translation_unit {
+    str_pool names;
     gda symbol_table;
+    gda symbol_ids;
+    gda symbol_refs;
+    gda symbol_fixups;
     gda bmc_code;
     gda bmc_data;
     gda extern_usage;
+    FILE *diagnostics;
+    struct stats stats;
 };
 
 